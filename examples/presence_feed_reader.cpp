@@ -0,0 +1,54 @@
+// prints the presence gdrpc publishes whenever it changes
+// build with: g++ -std=c++17 -I../src presence_feed_reader.cpp -o reader
+// (older glibc needs -lrt for shm_open)
+#include "presence_feed.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+int main() {
+  int fd = shm_open(PRESENCE_FEED_NAME, O_RDONLY, 0);
+  if (fd == -1) {
+    std::perror("shm_open, is gdrpc running with presence_feed = true?");
+    return 1;
+  }
+
+  auto mapped = mmap(nullptr, sizeof(Presence_Feed_Segment), PROT_READ,
+                     MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    std::perror("mmap");
+    return 1;
+  }
+
+  const auto &segment = *static_cast<const Presence_Feed_Segment *>(mapped);
+  if (segment.magic != PRESENCE_FEED_MAGIC ||
+      segment.version != PRESENCE_FEED_VERSION ||
+      segment.snapshot_size != sizeof(Presence_Snapshot)) {
+    std::fprintf(stderr, "feed is from a different version of gdrpc\n");
+    return 1;
+  }
+
+  // an overlay would do this once a frame, it never blocks the game
+  uint32_t last_sequence = 0;
+  while (true) {
+    Presence_Snapshot snapshot;
+    uint32_t sequence;
+    if (read_presence_feed(segment, snapshot, sequence) &&
+        sequence != last_sequence) {
+      last_sequence = sequence;
+      std::printf("%s | %s | %s (id %d, best %d%%, %d attempts, rank %d)\n",
+                  snapshot.details, snapshot.state_text, snapshot.level_name,
+                  snapshot.level_id, snapshot.best, snapshot.attempts,
+                  snapshot.rank);
+      std::fflush(stdout);
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(16));
+  }
+}
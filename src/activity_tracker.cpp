@@ -0,0 +1,57 @@
+#include "activity_tracker.hpp"
+
+#include <algorithm>
+
+Activity_Tracker::Activity_Tracker()
+    : focused(true), in_menu(true), last_activity(clock::now().time_since_epoch().count()),
+      stretched(false), interval(ACTIVE_INTERVAL), idle_after(0) {}
+
+Activity_Tracker::clock::duration
+Activity_Tracker::since_activity(clock::time_point now) const {
+  auto last = clock::time_point(
+      clock::duration(last_activity.load(std::memory_order_relaxed)));
+  return now - last;
+}
+
+bool Activity_Tracker::record_activity(clock::time_point now) {
+  // this comes in for every mouse move, so keep it to two atomics
+  last_activity.store(now.time_since_epoch().count(),
+                      std::memory_order_relaxed);
+  return stretched.load(std::memory_order_relaxed) &&
+         stretched.exchange(false, std::memory_order_relaxed);
+}
+
+bool Activity_Tracker::record_focus(bool n_focused, clock::time_point now) {
+  focused.store(n_focused, std::memory_order_relaxed);
+  if (n_focused) {
+    return record_activity(now);
+  }
+  return false;
+}
+
+bool Activity_Tracker::record_state(bool n_in_menu, clock::time_point now) {
+  in_menu.store(n_in_menu, std::memory_order_relaxed);
+  return record_activity(now);
+}
+
+void Activity_Tracker::set_idle_after(std::chrono::seconds n_idle_after) {
+  idle_after = n_idle_after;
+}
+
+bool Activity_Tracker::is_away(clock::time_point now) const {
+  return idle_after.count() != 0 && since_activity(now) >= idle_after;
+}
+
+std::chrono::milliseconds
+Activity_Tracker::next_interval(clock::time_point now) {
+  if (focused.load(std::memory_order_relaxed) &&
+      (!in_menu.load(std::memory_order_relaxed) ||
+       since_activity(now) < ACTIVE_WINDOW)) {
+    interval = ACTIVE_INTERVAL;
+  } else {
+    interval = std::min(interval * 2, MAX_INTERVAL);
+  }
+
+  stretched.store(interval > ACTIVE_INTERVAL, std::memory_order_relaxed);
+  return interval;
+}
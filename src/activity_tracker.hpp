@@ -0,0 +1,71 @@
+#pragma once
+#ifndef ACTIVITY_TRACKER_HPP
+#define ACTIVITY_TRACKER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// decides how long the loop can sleep for
+// while the player is doing something it runs every second, once they stop
+// (or tab out) the interval doubles each time up to MAX_INTERVAL, and any
+// input brings it straight back
+// only time in the menu counts as idle, a level or the editor keeps
+// changing what's shown without any input, so those stay at ACTIVE_INTERVAL
+// for as long as the game has focus
+// the record_ functions are called from the window procedure, everything
+// else from the loop thread
+class Activity_Tracker {
+public:
+  typedef std::chrono::steady_clock clock;
+
+private:
+  static constexpr std::chrono::milliseconds ACTIVE_INTERVAL{1000};
+  static constexpr std::chrono::milliseconds MAX_INTERVAL{15000};
+
+  // how long after the last input the player still counts as active
+  static constexpr std::chrono::seconds ACTIVE_WINDOW{10};
+
+  std::atomic<bool> focused;
+  std::atomic<bool> in_menu;
+  // clock::rep so it can be atomic
+  std::atomic<clock::rep> last_activity;
+  // set while the loop is sleeping longer than ACTIVE_INTERVAL
+  std::atomic<bool> stretched;
+
+  std::chrono::milliseconds interval;
+  std::chrono::seconds idle_after;
+
+  clock::duration since_activity(clock::time_point now) const;
+
+public:
+  Activity_Tracker();
+
+  // these return true if the loop is in a long sleep and should be woken
+  // the now overloads are for replaying a timeline, the others use the clock
+  bool record_activity() { return record_activity(clock::now()); }
+  bool record_activity(clock::time_point now);
+  bool record_focus(bool focused) {
+    return record_focus(focused, clock::now());
+  }
+  bool record_focus(bool focused, clock::time_point now);
+  // entering the menu counts as input, so the idle time starts from there
+  bool record_state(bool in_menu) {
+    return record_state(in_menu, clock::now());
+  }
+  bool record_state(bool in_menu, clock::time_point now);
+
+  // 0 never counts the player as away
+  void set_idle_after(std::chrono::seconds idle_after);
+
+  // nothing has happened for idle_after
+  bool is_away() const { return is_away(clock::now()); }
+  bool is_away(clock::time_point now) const;
+
+  std::chrono::milliseconds next_interval() {
+    return next_interval(clock::now());
+  }
+  std::chrono::milliseconds next_interval(clock::time_point now);
+};
+
+#endif
@@ -0,0 +1,200 @@
+#include "author_cache.hpp"
+
+#include <fstream>
+
+Author_Cache::Author_Cache(std::string filename)
+    : filename(filename), recent_changed(false), running(false),
+      client(nullptr) {}
+
+uint64_t Author_Cache::author_key(int userID, int accountID) {
+  if (accountID > 0) {
+    return static_cast<uint64_t>(static_cast<uint32_t>(accountID));
+  }
+  return (uint64_t(1) << 32) | static_cast<uint32_t>(userID);
+}
+
+void Author_Cache::load_recent() {
+  std::ifstream recent_file(filename);
+  Author author;
+
+  while (recent_file >> author.userID >> author.accountID) {
+    recent.push_back(author);
+  }
+
+  while (recent.size() > MAX_RECENT) {
+    recent.pop_front();
+  }
+}
+
+void Author_Cache::save_recent(const std::deque<Author> &authors) {
+  std::ofstream recent_file(filename, std::ios::trunc);
+  for (const auto &author : authors) {
+    recent_file << author.userID << '\t' << author.accountID << '\n';
+  }
+}
+
+void Author_Cache::start(std::shared_ptr<GD_Client> n_client,
+                         std::function<void()> n_on_resolved) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (running) {
+    return;
+  }
+
+  load_recent();
+
+  client = n_client;
+  on_resolved = n_on_resolved;
+  running = true;
+
+  // most recent first, that's the likeliest to be played again
+  for (auto it = recent.rbegin(); it != recent.rend(); ++it) {
+    queue_fetch(*it);
+  }
+
+  worker.start([this](Stop_Token) { worker_loop(); });
+}
+
+void Author_Cache::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    running = false;
+  }
+  queue_cv.notify_all();
+
+  worker.request_stop();
+  worker.join_for(STOP_TIMEOUT);
+}
+
+void Author_Cache::queue_fetch(const Author &author) {
+  if (pending.insert(author_key(author.userID, author.accountID)).second) {
+    queue.push_back(author);
+    queue_cv.notify_one();
+  }
+}
+
+void Author_Cache::remember(const Author &author) {
+  auto key = author_key(author.userID, author.accountID);
+  if (!recent.empty() &&
+      author_key(recent.back().userID, recent.back().accountID) == key) {
+    return;
+  }
+
+  for (auto it = recent.begin(); it != recent.end(); ++it) {
+    if (author_key(it->userID, it->accountID) == key) {
+      recent.erase(it);
+      break;
+    }
+  }
+
+  recent.push_back(author);
+  if (recent.size() > MAX_RECENT) {
+    recent.pop_front();
+  }
+
+  // written by the worker, this runs on the loop with the lock held
+  recent_changed = true;
+  queue_cv.notify_one();
+}
+
+void Author_Cache::evict_oldest() {
+  auto oldest = authors.end();
+  for (auto it = authors.begin(); it != authors.end(); ++it) {
+    if (oldest == authors.end() ||
+        it->second.fetched < oldest->second.fetched) {
+      oldest = it;
+    }
+  }
+
+  if (oldest != authors.end()) {
+    authors.erase(oldest);
+  }
+}
+
+bool Author_Cache::lookup(int userID, int accountID, GDuser &user) {
+  if (userID <= 0 && accountID <= 0) {
+    // official levels, nothing to look up
+    user = GDuser();
+    return true;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  remember({userID, accountID});
+
+  auto cached = authors.find(author_key(userID, accountID));
+  bool fresh = false;
+
+  if (cached != authors.end()) {
+    user = cached->second.user;
+    fresh = clock::now() - cached->second.fetched < TTL;
+  } else {
+    user = GDuser();
+  }
+
+  if (!fresh && running) {
+    queue_fetch({userID, accountID});
+  }
+  return cached != authors.end();
+}
+
+void Author_Cache::worker_loop() {
+  while (true) {
+    Author author;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      queue_cv.wait(lock, [this]() {
+        return !running || !queue.empty() || recent_changed;
+      });
+
+      if (recent_changed) {
+        // saved from a copy, so lookups don't wait on the disk
+        auto authors_to_save = recent;
+        recent_changed = false;
+        lock.unlock();
+        save_recent(authors_to_save);
+        continue;
+      }
+
+      if (!running) {
+        return;
+      }
+
+      author = queue.front();
+      queue.pop_front();
+    }
+
+    GDuser user;
+    bool resolved = true;
+    try {
+      // only accounts have a rank
+      if (author.accountID > 0) {
+        client->get_user_info(author.accountID, user);
+      } else {
+        client->get_player_info(author.userID, user);
+      }
+    } catch (const Not_Found_Error &) {
+      // deleted or banned, keep the empty profile so it isn't asked again
+      user = GDuser();
+    } catch (const std::exception &) {
+      // network issue or a garbled response, allow a retry on the next lookup
+      resolved = false;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      auto key = author_key(author.userID, author.accountID);
+      pending.erase(key);
+      if (!resolved) {
+        continue;
+      }
+
+      if (authors.size() >= MAX_ENTRIES && !authors.count(key)) {
+        evict_oldest();
+      }
+      authors[key] = {user, clock::now()};
+    }
+
+    if (on_resolved) {
+      on_resolved();
+    }
+  }
+}
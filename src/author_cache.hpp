@@ -0,0 +1,84 @@
+#pragma once
+#ifndef AUTHOR_CACHE_HPP
+#define AUTHOR_CACHE_HPP
+#include "gdapi.hpp"
+#include "worker_thread.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+// stars, creator points and rank of level authors
+// profiles change, so unlike songs they're only kept in memory for a while
+// expired entries are still returned while a fresh copy is fetched
+class Author_Cache {
+private:
+  typedef std::chrono::steady_clock clock;
+
+  static constexpr std::chrono::minutes TTL{10};
+  static constexpr size_t MAX_ENTRIES = 256;
+  static constexpr size_t MAX_RECENT = 16;
+  static constexpr std::chrono::milliseconds STOP_TIMEOUT{250};
+
+  struct Author {
+    int userID;
+    int accountID;
+  };
+
+  struct Entry {
+    GDuser user;
+    clock::time_point fetched;
+  };
+
+  std::string filename;
+
+  std::unordered_map<uint64_t, Entry> authors;
+  std::unordered_set<uint64_t> pending;
+  std::deque<Author> queue;
+
+  // authors of recently played levels, saved so they can be fetched early
+  // next time
+  std::deque<Author> recent;
+  // set when recent needs to be written out by the worker
+  bool recent_changed;
+
+  std::mutex mutex;
+  std::condition_variable queue_cv;
+  Worker_Thread worker;
+  bool running;
+
+  std::shared_ptr<GD_Client> client;
+  std::function<void()> on_resolved;
+
+  // accounts and green users (no account) share the map
+  static uint64_t author_key(int userID, int accountID);
+
+  void queue_fetch(const Author &author);
+  // moves the author to the end of recent, queueing a save if that changed it
+  void remember(const Author &author);
+  void evict_oldest();
+  void load_recent();
+  void save_recent(const std::deque<Author> &authors);
+  void worker_loop();
+
+public:
+  Author_Cache(std::string filename = "gdrpc_authors.txt");
+
+  // starts fetching the recently played authors straight away
+  void start(std::shared_ptr<GD_Client> client,
+             std::function<void()> on_resolved);
+  void stop();
+
+  // never blocks on the network, returns false and queues a lookup if the
+  // profile is missing or old
+  bool lookup(int userID, int accountID, GDuser &user);
+};
+
+#endif
@@ -0,0 +1,149 @@
+#include "config_cache.hpp"
+
+#include <filesystem>
+#include <fstream>
+
+constexpr char SNAPSHOT_MAGIC[8] = {'G', 'D', 'R', 'P', 'C', 'C', 'F', 'G'};
+
+// bump whenever the snapshot layout or Config_Format changes
+constexpr uint32_t SNAPSHOT_VERSION = 8;
+
+struct Snapshot_Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t config_version;
+  uint64_t toml_size;
+  int64_t toml_mtime;
+  uint64_t toml_hash;
+  uint64_t payload_size;
+  uint64_t payload_hash;
+};
+
+struct Toml_Identity {
+  uint64_t size = 0;
+  int64_t mtime = 0;
+  uint64_t hash = 0;
+};
+
+std::string snapshot_filename(const std::string &toml_filename) {
+  return toml_filename + ".cache";
+}
+
+bool identify_toml(const std::string &toml_filename, Toml_Identity &identity) {
+  std::error_code error;
+  auto size = std::filesystem::file_size(toml_filename, error);
+  if (error) {
+    return false;
+  }
+  auto mtime = std::filesystem::last_write_time(toml_filename, error);
+  if (error) {
+    return false;
+  }
+
+  identity.size = static_cast<uint64_t>(size);
+  identity.mtime = static_cast<int64_t>(mtime.time_since_epoch().count());
+  return true;
+}
+
+bool hash_toml(const std::string &toml_filename, Toml_Identity &identity) {
+  // mapping is cheaper than parsing, this is only here because mtime alone
+  // can be fooled by tools that preserve it
+  Mapped_File toml;
+  if (!toml.open(toml_filename) || toml.size() != identity.size) {
+    return false;
+  }
+
+  identity.hash = fnv1a(toml.data(), toml.size());
+  return true;
+}
+
+bool load_config_snapshot(const std::string &toml_filename,
+                          Config::Config_Format &config) {
+  Toml_Identity identity;
+  if (!identify_toml(toml_filename, identity)) {
+    return false;
+  }
+
+  Mapped_File snapshot;
+  if (!snapshot.open(snapshot_filename(toml_filename)) ||
+      snapshot.size() < sizeof(Snapshot_Header)) {
+    return false;
+  }
+
+  Snapshot_Header header;
+  std::memcpy(&header, snapshot.data(), sizeof(header));
+
+  if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 ||
+      header.version != SNAPSHOT_VERSION ||
+      header.config_version != Config::LATEST_VERSION ||
+      header.toml_size != identity.size || header.toml_mtime != identity.mtime) {
+    return false;
+  }
+
+  if (!hash_toml(toml_filename, identity) || header.toml_hash != identity.hash) {
+    return false;
+  }
+
+  auto payload = snapshot.data() + sizeof(header);
+  auto payload_size = snapshot.size() - sizeof(header);
+  if (header.payload_size != payload_size ||
+      header.payload_hash != fnv1a(payload, payload_size)) {
+    return false;
+  }
+
+  // parse into a copy, so a bad snapshot can't leave the config half loaded
+  try {
+    Config::Config_Format loaded;
+    Snapshot_Reader reader(payload, payload_size);
+    loaded.from_snapshot(reader);
+    if (!reader.at_end()) {
+      return false;
+    }
+
+    config = std::move(loaded);
+  } catch (const std::exception &) {
+    return false;
+  }
+
+  return true;
+}
+
+bool save_config_snapshot(const std::string &toml_filename,
+                          const Config::Config_Format &config) {
+  Toml_Identity identity;
+  if (!identify_toml(toml_filename, identity) ||
+      !hash_toml(toml_filename, identity)) {
+    return false;
+  }
+
+  Snapshot_Writer writer;
+  config.into_snapshot(writer);
+  const auto &payload = writer.data();
+
+  Snapshot_Header header;
+  std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+  header.version = SNAPSHOT_VERSION;
+  header.config_version = Config::LATEST_VERSION;
+  header.toml_size = identity.size;
+  header.toml_mtime = identity.mtime;
+  header.toml_hash = identity.hash;
+  header.payload_size = payload.size();
+  header.payload_hash = fnv1a(payload.data(), payload.size());
+
+  // written to the side first so a crash never leaves half a snapshot
+  auto filename = snapshot_filename(toml_filename);
+  auto temporary_filename = filename + ".tmp";
+  {
+    std::ofstream snapshot(temporary_filename,
+                           std::ios::binary | std::ios::trunc);
+    snapshot.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    snapshot.write(payload.data(), payload.size());
+    if (!snapshot) {
+      return false;
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::rename(temporary_filename, filename, error);
+  return !error;
+}
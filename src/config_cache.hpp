@@ -0,0 +1,21 @@
+#pragma once
+#ifndef CONFIG_CACHE_HPP
+#define CONFIG_CACHE_HPP
+#include "config_defaults.hpp"
+#include "mapped_file.hpp"
+#include "snapshot_io.hpp"
+
+#include <string>
+
+// the parsed config is kept in a binary file next to the toml, so launches
+// where the toml hasn't changed can skip parsing it
+
+// returns false if there is no snapshot matching the current toml
+bool load_config_snapshot(const std::string &toml_filename,
+                          Config::Config_Format &config);
+
+// returns false if the snapshot couldn't be written, which is fine
+bool save_config_snapshot(const std::string &toml_filename,
+                          const Config::Config_Format &config);
+
+#endif
@@ -2,6 +2,10 @@
 #ifndef CONFIG_DEFAULTS_HPP
 #define CONFIG_DEFAULTS_HPP
 
+#include "snapshot_io.hpp"
+
+#include <climits>
+#include <map>
 #include <toml.hpp>
 
 namespace Config {
@@ -29,6 +33,53 @@ struct Presence {
                        {"state", this->state},
                        {"smalltext", this->smalltext}};
   }
+
+  void from_snapshot(Snapshot_Reader &reader) {
+    this->detail = reader.read_string();
+    this->state = reader.read_string();
+    this->smalltext = reader.read_string();
+  }
+
+  void into_snapshot(Snapshot_Writer &writer) const {
+    writer.write(this->detail);
+    writer.write(this->state);
+    writer.write(this->smalltext);
+  }
+};
+
+// a byte pattern locating something in the game, see signature_scanner.hpp
+struct Signature {
+  std::string pattern;
+  // if set, the match holds an absolute address this many bytes in, and
+  // that address is what's wanted instead of the match itself
+  int read = -1;
+
+  void from_toml(const toml::value &value) {
+    if (value.is_string()) {
+      this->pattern = toml::get<std::string>(value);
+      this->read = -1;
+    } else {
+      this->pattern = toml::find<std::string>(value, "pattern");
+      this->read = toml::find_or<int>(value, "read", -1);
+    }
+  }
+
+  toml::value into_toml() const {
+    if (this->read == -1) {
+      return toml::value(this->pattern);
+    }
+    return toml::table{{"pattern", this->pattern}, {"read", this->read}};
+  }
+
+  void from_snapshot(Snapshot_Reader &reader) {
+    this->pattern = reader.read_string();
+    this->read = reader.read<int32_t>();
+  }
+
+  void into_snapshot(Snapshot_Writer &writer) const {
+    writer.write(this->pattern);
+    writer.write(static_cast<int32_t>(this->read));
+  }
 };
 
 struct Config_Format {
@@ -45,6 +96,16 @@ struct Config_Format {
       return toml::table{{"saved", this->saved},
                          {"playtesting", this->playtesting}};
     }
+
+    void from_snapshot(Snapshot_Reader &reader) {
+      this->saved.from_snapshot(reader);
+      this->playtesting.from_snapshot(reader);
+    }
+
+    void into_snapshot(Snapshot_Writer &writer) const {
+      this->saved.into_snapshot(writer);
+      this->playtesting.into_snapshot(writer);
+    }
   };
 
   struct Editor : Config::Presence {
@@ -64,54 +125,205 @@ struct Config_Format {
                          {"smalltext", this->smalltext},
                          {"reset_timestamp", this->reset_timestamp}};
     }
+
+    void from_snapshot(Snapshot_Reader &reader) {
+      Config::Presence::from_snapshot(reader);
+      this->reset_timestamp = reader.read_bool();
+    }
+
+    void into_snapshot(Snapshot_Writer &writer) const {
+      Config::Presence::into_snapshot(writer);
+      writer.write(this->reset_timestamp);
+    }
+  };
+
+  // matched against the level being played before the folder presences
+  // empty lists match anything
+  struct Rule : Config::Presence {
+    int id_min = 0;
+    int id_max = INT_MAX;
+    int stars_min = 0;
+    int stars_max = INT_MAX;
+    std::vector<std::string> difficulty;
+    std::vector<std::string> level_type;
+    std::vector<std::string> author;
+
+    void from_toml(const toml::value &table) {
+      Config::Presence::from_toml(table);
+      this->id_min = toml::find_or<int>(table, "id_min", 0);
+      this->id_max = toml::find_or<int>(table, "id_max", INT_MAX);
+      this->stars_min = toml::find_or<int>(table, "stars_min", 0);
+      this->stars_max = toml::find_or<int>(table, "stars_max", INT_MAX);
+      typedef std::vector<std::string> Names;
+      const Names any;
+      this->difficulty = toml::find_or<Names>(table, "difficulty", any);
+      this->level_type = toml::find_or<Names>(table, "level_type", any);
+      this->author = toml::find_or<Names>(table, "author", any);
+    }
+
+    toml::value into_toml() const {
+      return toml::table{{"detail", this->detail},
+                         {"state", this->state},
+                         {"smalltext", this->smalltext},
+                         {"id_min", this->id_min},
+                         {"id_max", this->id_max},
+                         {"stars_min", this->stars_min},
+                         {"stars_max", this->stars_max},
+                         {"difficulty", this->difficulty},
+                         {"level_type", this->level_type},
+                         {"author", this->author}};
+    }
+
+    void from_snapshot(Snapshot_Reader &reader) {
+      Config::Presence::from_snapshot(reader);
+      this->id_min = reader.read<int32_t>();
+      this->id_max = reader.read<int32_t>();
+      this->stars_min = reader.read<int32_t>();
+      this->stars_max = reader.read<int32_t>();
+      this->difficulty = reader.read_strings();
+      this->level_type = reader.read_strings();
+      this->author = reader.read_strings();
+    }
+
+    void into_snapshot(Snapshot_Writer &writer) const {
+      Config::Presence::into_snapshot(writer);
+      writer.write(static_cast<int32_t>(this->id_min));
+      writer.write(static_cast<int32_t>(this->id_max));
+      writer.write(static_cast<int32_t>(this->stars_min));
+      writer.write(static_cast<int32_t>(this->stars_max));
+      writer.write(this->difficulty);
+      writer.write(this->level_type);
+      writer.write(this->author);
+    }
   };
 
   struct User {
     std::string ranked;
-    std::string default;
+    std::string default_text;
     bool get_rank;
 
     void from_toml(const toml::value &table) {
       this->ranked = toml::find<std::string>(table, "ranked");
-      this->default = toml::find<std::string>(table, "default");
+      this->default_text = toml::find<std::string>(table, "default");
       this->get_rank = toml::find<bool>(table, "get_rank");
     }
 
     toml::value into_toml() const {
       return toml::table{{"ranked", this->ranked},
-                         {"default", this->default},
+                         {"default", this->default_text},
                          {"get_rank", this->get_rank}};
     }
+
+    void from_snapshot(Snapshot_Reader &reader) {
+      this->ranked = reader.read_string();
+      this->default_text = reader.read_string();
+      this->get_rank = reader.read_bool();
+    }
+
+    void into_snapshot(Snapshot_Writer &writer) const {
+      writer.write(this->ranked);
+      writer.write(this->default_text);
+      writer.write(this->get_rank);
+    }
   };
 
   struct Settings {
     int file_version;
     bool logging;
     std::string executable_name;
-    std::string base_url;
+    std::vector<std::string> base_url;
     std::string url_prefix;
     std::string application_id;
+    int metrics_port = 0;
+    bool low_priority_threads = true;
+    int64_t worker_affinity = 0;
+    int idle_after = 300;
+    bool presence_feed = false;
+    int feed_port = 0;
+    bool override_server = false;
 
     void from_toml(const toml::value &table) {
       this->file_version = toml::find<int>(table, "file_version");
       this->logging = toml::find<bool>(table, "logging");
       this->executable_name = toml::find_or<std::string>(
           table, "executable_name", DEFAULT_EXECUTABLE);
-      this->base_url =
-          toml::find_or<std::string>(table, "base_url", DEFAULT_URL);
+      // either a single url or a list of mirrors
+      if (table.contains("base_url") &&
+          table.at("base_url").type() == toml::value_t::array) {
+        this->base_url =
+            toml::find<std::vector<std::string>>(table, "base_url");
+      } else {
+        this->base_url = {
+            toml::find_or<std::string>(table, "base_url", DEFAULT_URL)};
+      }
       this->url_prefix =
           toml::find_or<std::string>(table, "url_prefix", DEFAULT_PREFIX);
       this->application_id = toml::find_or<std::string>(table, "application_id",
                                                         DEFAULT_APPLICATION_ID);
+      this->metrics_port = toml::find_or<int>(table, "metrics_port", 0);
+      this->low_priority_threads =
+          toml::find_or<bool>(table, "low_priority_threads", true);
+      this->worker_affinity =
+          toml::find_or<int64_t>(table, "worker_affinity", 0);
+      this->idle_after = toml::find_or<int>(table, "idle_after", 300);
+      this->presence_feed = toml::find_or<bool>(table, "presence_feed", false);
+      this->feed_port = toml::find_or<int>(table, "feed_port", 0);
+      this->override_server =
+          toml::find_or<bool>(table, "override_server", false);
     }
 
     toml::value into_toml() const {
       return toml::table{{"file_version", this->file_version},
                          {"logging", this->logging},
                          {"executable_name", this->executable_name},
-                         {"base_url", this->base_url},
+                         {"base_url", this->base_url.size() == 1
+                                          ? toml::value(this->base_url.at(0))
+                                          : toml::value(this->base_url)},
                          {"url_prefix", this->url_prefix},
-                         {"application_id", this->application_id}};
+                         {"application_id", this->application_id},
+                         {"metrics_port", this->metrics_port},
+                         {"low_priority_threads", this->low_priority_threads},
+                         {"worker_affinity", this->worker_affinity},
+                         {"idle_after", this->idle_after},
+                         {"presence_feed", this->presence_feed},
+                         {"feed_port", this->feed_port},
+                         {"override_server", this->override_server}};
+    }
+
+    void from_snapshot(Snapshot_Reader &reader) {
+      this->file_version = reader.read<int32_t>();
+      this->logging = reader.read_bool();
+      this->executable_name = reader.read_string();
+
+      this->base_url = reader.read_strings();
+
+      this->url_prefix = reader.read_string();
+      this->application_id = reader.read_string();
+      this->metrics_port = reader.read<int32_t>();
+      this->low_priority_threads = reader.read_bool();
+      this->worker_affinity = reader.read<int64_t>();
+      this->idle_after = reader.read<int32_t>();
+      this->presence_feed = reader.read_bool();
+      this->feed_port = reader.read<int32_t>();
+      this->override_server = reader.read_bool();
+    }
+
+    void into_snapshot(Snapshot_Writer &writer) const {
+      writer.write(static_cast<int32_t>(this->file_version));
+      writer.write(this->logging);
+      writer.write(this->executable_name);
+
+      writer.write(this->base_url);
+
+      writer.write(this->url_prefix);
+      writer.write(this->application_id);
+      writer.write(static_cast<int32_t>(this->metrics_port));
+      writer.write(this->low_priority_threads);
+      writer.write(this->worker_affinity);
+      writer.write(static_cast<int32_t>(this->idle_after));
+      writer.write(this->presence_feed);
+      writer.write(static_cast<int32_t>(this->feed_port));
+      writer.write(this->override_server);
     }
   };
 
@@ -132,19 +344,91 @@ struct Config_Format {
 
     this->user = toml::find<Config_Format::User>(table, "user");
     this->menu = toml::find<Config::Presence>(table, "menu");
+    if (table.contains("away")) {
+      this->away = toml::find<Config::Presence>(table, "away");
+    }
+
+    if (table.contains("rule")) {
+      this->rule = toml::find<std::vector<Config_Format::Rule>>(table, "rule");
+    }
 
     if (table.contains("settings")) {
       // this table is still optional due to previous versions not containing it
       this->settings = toml::find<Config_Format::Settings>(table, "settings");
     }
+
+    if (table.contains("signatures")) {
+      for (const auto &[name, value] : table.at("signatures").as_table()) {
+        this->signatures[name].from_toml(value);
+      }
+    }
+  }
+
+  void from_snapshot(Snapshot_Reader &reader) {
+    this->level.resize(reader.read<uint32_t>());
+    for (auto &level : this->level) {
+      level.from_snapshot(reader);
+    }
+
+    this->editor.resize(reader.read<uint32_t>());
+    for (auto &editor : this->editor) {
+      editor.from_snapshot(reader);
+    }
+
+    this->rule.resize(reader.read<uint32_t>());
+    for (auto &rule : this->rule) {
+      rule.from_snapshot(reader);
+    }
+
+    this->user.from_snapshot(reader);
+    this->menu.from_snapshot(reader);
+    this->away.from_snapshot(reader);
+    this->settings.from_snapshot(reader);
+
+    this->signatures.clear();
+    for (auto count = reader.read<uint32_t>(); count != 0; count--) {
+      auto name = reader.read_string();
+      this->signatures[name].from_snapshot(reader);
+    }
+  }
+
+  void into_snapshot(Snapshot_Writer &writer) const {
+    writer.write(static_cast<uint32_t>(this->level.size()));
+    for (const auto &level : this->level) {
+      level.into_snapshot(writer);
+    }
+
+    writer.write(static_cast<uint32_t>(this->editor.size()));
+    for (const auto &editor : this->editor) {
+      editor.into_snapshot(writer);
+    }
+
+    writer.write(static_cast<uint32_t>(this->rule.size()));
+    for (const auto &rule : this->rule) {
+      rule.into_snapshot(writer);
+    }
+
+    this->user.into_snapshot(writer);
+    this->menu.into_snapshot(writer);
+    this->away.into_snapshot(writer);
+    this->settings.into_snapshot(writer);
+
+    writer.write(static_cast<uint32_t>(this->signatures.size()));
+    for (const auto &[name, signature] : this->signatures) {
+      writer.write(name);
+      signature.into_snapshot(writer);
+    }
   }
 
   toml::value into_toml() const {
     return toml::table{{"level", this->level},
                        {"editor", this->editor},
+                       {"rule", this->rule},
                        {"user", this->user},
                        {"menu", this->menu},
-                       {"settings", this->settings}};
+                       {"away", this->away},
+                       {"settings", this->settings},
+                       {"signatures", this->signatures}};
   }
 
   std::vector<Level> level{
@@ -152,12 +436,17 @@ struct Config_Format {
        {"Playtesting a level", "", ""}}};
   std::vector<Editor> editor{
       {{"Editing a level", "{objects} objects", ""}, false}};
+  std::vector<Rule> rule;
   User user = {"{name} [Rank #{rank}]", "", true};
   Config::Presence menu = {"Idle", "", ""};
+  Config::Presence away = {"Away", "", ""};
+
+  // by name, anything not listed uses the built in SilvrPS.exe addresses
+  std::map<std::string, Config::Signature> signatures;
 
   Settings settings = {
       Config::LATEST_VERSION,     false,
-      Config::DEFAULT_EXECUTABLE, Config::DEFAULT_URL,
+      Config::DEFAULT_EXECUTABLE, {Config::DEFAULT_URL},
       Config::DEFAULT_PREFIX,     Config::DEFAULT_APPLICATION_ID};
 };
 } // namespace Config
@@ -0,0 +1,293 @@
+#include "discord_ipc.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+Discord_Ipc::Discord_Ipc()
+    :
+#ifdef _WIN32
+      pipe(INVALID_HANDLE_VALUE),
+#else
+      socket_fd(-1),
+#endif
+      write_offset(0), read_offset(0) {
+}
+
+Discord_Ipc::~Discord_Ipc() { disconnect(); }
+
+#ifdef _WIN32
+bool Discord_Ipc::open_pipe(int index) {
+  auto pipe_name = L"\\\\?\\pipe\\discord-ipc-" + std::to_wstring(index);
+
+  pipe = CreateFileW(pipe_name.c_str(), GENERIC_READ | GENERIC_WRITE, 0,
+                     nullptr, OPEN_EXISTING, 0, nullptr);
+  if (pipe == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+
+  // with PIPE_NOWAIT writes only take what fits in the pipe buffer
+  DWORD mode = PIPE_READMODE_BYTE | PIPE_NOWAIT;
+  if (!SetNamedPipeHandleState(pipe, &mode, nullptr, nullptr)) {
+    CloseHandle(pipe);
+    pipe = INVALID_HANDLE_VALUE;
+    return false;
+  }
+
+  return true;
+}
+
+void Discord_Ipc::disconnect() {
+  if (pipe != INVALID_HANDLE_VALUE) {
+    CloseHandle(pipe);
+    pipe = INVALID_HANDLE_VALUE;
+  }
+  write_buffer.clear();
+  write_offset = 0;
+  read_buffer.clear();
+  read_offset = 0;
+}
+
+bool Discord_Ipc::is_connected() const { return pipe != INVALID_HANDLE_VALUE; }
+
+long Discord_Ipc::write_some(const char *data, size_t size) {
+  DWORD written = 0;
+  if (!WriteFile(pipe, data, static_cast<DWORD>(size), &written, nullptr)) {
+    return -1;
+  }
+  return static_cast<long>(written);
+}
+
+long Discord_Ipc::read_some(char *data, size_t size) {
+  DWORD available = 0;
+  if (!PeekNamedPipe(pipe, nullptr, 0, nullptr, &available, nullptr)) {
+    return -1;
+  }
+
+  if (available == 0) {
+    return 0;
+  }
+
+  DWORD read = 0;
+  auto to_read = available < size ? available : static_cast<DWORD>(size);
+  if (!ReadFile(pipe, data, to_read, &read, nullptr)) {
+    return -1;
+  }
+  return static_cast<long>(read);
+}
+#else
+bool Discord_Ipc::open_pipe(int index) {
+  const char *directory = nullptr;
+  for (auto variable : {"XDG_RUNTIME_DIR", "TMPDIR", "TMP", "TEMP"}) {
+    if ((directory = std::getenv(variable))) {
+      break;
+    }
+  }
+
+  auto path = std::string(directory ? directory : "/tmp") + "/discord-ipc-" +
+              std::to_string(index);
+
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path)) {
+    return false;
+  }
+  std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+  socket_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (socket_fd == -1) {
+    return false;
+  }
+
+  if (::connect(socket_fd, reinterpret_cast<sockaddr *>(&address),
+                sizeof(address)) == -1 ||
+      fcntl(socket_fd, F_SETFL, O_NONBLOCK) == -1) {
+    ::close(socket_fd);
+    socket_fd = -1;
+    return false;
+  }
+
+  return true;
+}
+
+void Discord_Ipc::disconnect() {
+  if (socket_fd != -1) {
+    ::close(socket_fd);
+    socket_fd = -1;
+  }
+  write_buffer.clear();
+  write_offset = 0;
+  read_buffer.clear();
+  read_offset = 0;
+}
+
+bool Discord_Ipc::is_connected() const { return socket_fd != -1; }
+
+long Discord_Ipc::write_some(const char *data, size_t size) {
+#ifdef MSG_NOSIGNAL
+  auto written = ::send(socket_fd, data, size, MSG_NOSIGNAL);
+#else
+  auto written = ::send(socket_fd, data, size, 0);
+#endif
+  if (written == -1) {
+    return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+  }
+  return static_cast<long>(written);
+}
+
+long Discord_Ipc::read_some(char *data, size_t size) {
+  auto read = ::recv(socket_fd, data, size, 0);
+  if (read == -1) {
+    return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+  }
+  if (read == 0) {
+    // other side hung up
+    return -1;
+  }
+  return static_cast<long>(read);
+}
+#endif
+
+bool Discord_Ipc::connect() {
+  disconnect();
+
+  for (int i = 0; i < 10; i++) {
+    if (open_pipe(i)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool Discord_Ipc::send(Ipc_Opcode opcode, const std::string &payload) {
+  if (!is_connected()) {
+    return false;
+  }
+
+  // frames are little endian, same as every platform this runs on
+  uint32_t header[2] = {static_cast<uint32_t>(opcode),
+                        static_cast<uint32_t>(payload.size())};
+  write_buffer.append(reinterpret_cast<const char *>(header), HEADER_SIZE);
+  write_buffer.append(payload);
+
+  return flush();
+}
+
+bool Discord_Ipc::flush() {
+  while (write_offset < write_buffer.size()) {
+    auto written = write_some(write_buffer.data() + write_offset,
+                              write_buffer.size() - write_offset);
+    if (written < 0) {
+      disconnect();
+      return false;
+    }
+
+    if (written == 0) {
+      // pipe is full, try again next time
+      return true;
+    }
+
+    write_offset += static_cast<size_t>(written);
+  }
+
+  // clear keeps the capacity around for the next frame
+  write_buffer.clear();
+  write_offset = 0;
+  return true;
+}
+
+bool Discord_Ipc::receive(Ipc_Opcode &opcode, std::string &payload) {
+  if (!is_connected()) {
+    return false;
+  }
+
+  char chunk[4096];
+  while (true) {
+    auto read = read_some(chunk, sizeof(chunk));
+    if (read < 0) {
+      disconnect();
+      throw std::runtime_error("discord pipe closed");
+    }
+    if (read == 0) {
+      break;
+    }
+    read_buffer.append(chunk, static_cast<size_t>(read));
+  }
+
+  if (read_offset != 0 && read_buffer.size() - read_offset < HEADER_SIZE) {
+    // keep the start of the next frame at the front
+    read_buffer.erase(0, read_offset);
+    read_offset = 0;
+  }
+
+  if (read_buffer.size() - read_offset < HEADER_SIZE) {
+    return false;
+  }
+
+  uint32_t header[2];
+  std::memcpy(header, read_buffer.data() + read_offset, HEADER_SIZE);
+  if (header[1] > MAX_FRAME_SIZE) {
+    disconnect();
+    throw std::runtime_error("discord sent an oversized frame");
+  }
+
+  if (read_buffer.size() - read_offset < HEADER_SIZE + header[1]) {
+    return false;
+  }
+
+  opcode = static_cast<Ipc_Opcode>(header[0]);
+  payload.assign(read_buffer, read_offset + HEADER_SIZE, header[1]);
+  read_offset += HEADER_SIZE + header[1];
+
+  if (read_offset == read_buffer.size()) {
+    read_buffer.clear();
+    read_offset = 0;
+  }
+
+  return true;
+}
+
+void append_json_string(std::string &out, const char *text) {
+  constexpr char hex[] = "0123456789abcdef";
+
+  out.push_back('"');
+  for (auto c = text; *c != '\0'; c++) {
+    auto byte = static_cast<unsigned char>(*c);
+    switch (byte) {
+    case '"':
+      out.append("\\\"");
+      break;
+    case '\\':
+      out.append("\\\\");
+      break;
+    case '\n':
+      out.append("\\n");
+      break;
+    case '\r':
+      out.append("\\r");
+      break;
+    case '\t':
+      out.append("\\t");
+      break;
+    default:
+      if (byte < 0x20) {
+        out.append("\\u00");
+        out.push_back(hex[byte >> 4]);
+        out.push_back(hex[byte & 0xF]);
+      } else {
+        out.push_back(*c);
+      }
+      break;
+    }
+  }
+  out.push_back('"');
+}
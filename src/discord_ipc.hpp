@@ -0,0 +1,89 @@
+#pragma once
+#ifndef DISCORD_IPC_HPP
+#define DISCORD_IPC_HPP
+
+#include <cstdint>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// see https://github.com/discord/discord-rpc/blob/master/documentation/hard-mode.md
+enum class Ipc_Opcode : uint32_t {
+  handshake = 0,
+  frame = 1,
+  close = 2,
+  ping = 3,
+  pong = 4
+};
+
+// how Discord_Presence reaches discord, so the connection logic can run
+// against something other than a real pipe
+class Ipc_Transport {
+public:
+  virtual ~Ipc_Transport() = default;
+
+  virtual bool connect() = 0;
+  virtual void disconnect() = 0;
+  virtual bool is_connected() const = 0;
+
+  virtual bool send(Ipc_Opcode opcode, const std::string &payload) = 0;
+  virtual bool flush() = 0;
+  virtual bool receive(Ipc_Opcode &opcode, std::string &payload) = 0;
+};
+
+// a connection to the discord client over its local pipe
+// (\\?\pipe\discord-ipc-N on windows, $XDG_RUNTIME_DIR/discord-ipc-N elsewhere)
+// nothing here ever blocks, frames that can't be written yet are kept for
+// the next flush
+class Discord_Ipc : public Ipc_Transport {
+private:
+  static constexpr uint32_t MAX_FRAME_SIZE = 64 * 1024;
+  static constexpr size_t HEADER_SIZE = sizeof(uint32_t) * 2;
+
+#ifdef _WIN32
+  HANDLE pipe;
+#else
+  int socket_fd;
+#endif
+
+  std::string write_buffer;
+  size_t write_offset;
+
+  std::string read_buffer;
+  size_t read_offset;
+
+  bool open_pipe(int index);
+
+  // raw transport, these return -1 on a broken connection
+  long write_some(const char *data, size_t size);
+  long read_some(char *data, size_t size);
+
+public:
+  Discord_Ipc();
+  ~Discord_Ipc();
+
+  Discord_Ipc(const Discord_Ipc &) = delete;
+  Discord_Ipc &operator=(const Discord_Ipc &) = delete;
+
+  // tries each of the pipes discord may be listening on
+  bool connect() override;
+  void disconnect() override;
+  bool is_connected() const override;
+
+  // queues a frame and tries to send it right away
+  // returns false if the connection broke
+  bool send(Ipc_Opcode opcode, const std::string &payload) override;
+  bool flush() override;
+
+  // returns true if a full frame was read, false if there isn't one yet
+  // payload is reused between calls, so keep passing the same string
+  // throws std::runtime_error if the connection broke or sent garbage
+  bool receive(Ipc_Opcode &opcode, std::string &payload) override;
+};
+
+// escapes text into a json string, quotes included
+void append_json_string(std::string &out, const char *text);
+
+#endif
@@ -0,0 +1,62 @@
+#pragma once
+#ifndef FORM_BODY_HPP
+#define FORM_BODY_HPP
+
+#include <charconv>
+#include <string>
+
+// builds an application/x-www-form-urlencoded body in place
+// the buffer keeps its capacity between requests, so once it has grown to
+// fit the largest one nothing gets allocated
+class Form_Body {
+private:
+  std::string buffer;
+
+  void append_key(const char *key) {
+    if (!buffer.empty()) {
+      buffer.push_back('&');
+    }
+    buffer.append(key);
+    buffer.push_back('=');
+  }
+
+public:
+  // starts over from fields that were encoded ahead of time
+  void reset(const std::string &encoded) { buffer.assign(encoded); }
+
+  Form_Body &add(const char *key, const char *value) {
+    constexpr char hex[] = "0123456789ABCDEF";
+
+    append_key(key);
+    for (auto c = value; *c != '\0'; c++) {
+      auto byte = static_cast<unsigned char>(*c);
+      if ((byte >= 'a' && byte <= 'z') || (byte >= 'A' && byte <= 'Z') ||
+          (byte >= '0' && byte <= '9') || byte == '-' || byte == '.' ||
+          byte == '_' || byte == '~') {
+        buffer.push_back(*c);
+      } else {
+        buffer.push_back('%');
+        buffer.push_back(hex[byte >> 4]);
+        buffer.push_back(hex[byte & 0xF]);
+      }
+    }
+    return *this;
+  }
+
+  Form_Body &add(const char *key, const std::string &value) {
+    return add(key, value.c_str());
+  }
+
+  Form_Body &add(const char *key, int value) {
+    char digits[16];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+
+    append_key(key);
+    buffer.append(digits, result.ptr);
+    return *this;
+  }
+
+  const std::string &str() const { return buffer; }
+};
+
+#endif
@@ -0,0 +1,126 @@
+#include "game_addresses.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+Game_Addresses::Game_Addresses(std::string cache_filename)
+    : cache_filename(cache_filename) {
+  for (const auto &[name, offset] : DEFAULT_ADDRESSES) {
+    offsets[name] = offset;
+  }
+}
+
+uint64_t Game_Addresses::build_key(const Image_Info &info,
+                                   const Signatures &signatures) {
+  uint32_t header[] = {info.timestamp, info.image_size, info.checksum,
+                       info.text_size};
+  auto key = fnv1a(reinterpret_cast<const char *>(header), sizeof(header));
+
+  for (const auto &[name, signature] : signatures) {
+    auto entry = name + '=' + signature.pattern + '@' +
+                 std::to_string(signature.read) + ';';
+    key = fnv1a(entry.data(), entry.size(), key);
+  }
+  return key;
+}
+
+bool Game_Addresses::load_cache(uint64_t key) {
+  std::ifstream cache_file(cache_filename);
+  uint64_t cached_key;
+  if (!(cache_file >> std::hex >> cached_key) || cached_key != key) {
+    return false;
+  }
+
+  std::string name;
+  uintptr_t offset;
+  while (cache_file >> name >> offset) {
+    offsets[name] = offset;
+  }
+  return true;
+}
+
+void Game_Addresses::save_cache(uint64_t key) {
+  std::ofstream cache_file(cache_filename, std::ios::trunc);
+  cache_file << std::hex << key << '\n';
+  for (const auto &[name, offset] : offsets) {
+    cache_file << name << ' ' << offset << '\n';
+  }
+}
+
+void Game_Addresses::resolve(const uint8_t *base, const Signatures &signatures,
+                             std::shared_ptr<spdlog::logger> logger) {
+  if (signatures.empty()) {
+    return;
+  }
+
+  Image_Info info;
+  if (!read_image_info(base, info)) {
+    if (logger) {
+      logger->warn("could not read the executable's headers, using the "
+                   "built in addresses");
+    }
+    return;
+  }
+
+  auto key = build_key(info, signatures);
+  if (load_cache(key)) {
+    if (logger) {
+      logger->debug("signatures loaded from cache");
+    }
+    return;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  auto text = base + info.text_rva;
+
+  for (const auto &[name, config] : signatures) {
+    try {
+      Signature signature(config.pattern);
+
+      auto match = find_signature(text, info.text_size, signature);
+      if (match == NO_MATCH) {
+        throw std::runtime_error("no match");
+      }
+
+      uintptr_t offset = info.text_rva + match;
+      if (config.read >= 0) {
+        if (match + config.read + sizeof(uint32_t) > info.text_size) {
+          throw std::runtime_error("read goes past the end of .text");
+        }
+
+        // an absolute address, turn it back into an offset
+        uint32_t address;
+        std::memcpy(&address, text + match + config.read, sizeof(address));
+        offset = address - reinterpret_cast<uintptr_t>(base);
+        if (offset >= info.image_size) {
+          throw std::runtime_error("read address is outside the image");
+        }
+      }
+
+      offsets[name] = offset;
+      if (logger) {
+        logger->debug("signature {} found at {:#x}", name, offset);
+      }
+    } catch (const std::exception &e) {
+      if (logger) {
+        logger->warn("signature {} failed ({}), using the built in address",
+                     name, e.what());
+      }
+    }
+  }
+
+  if (logger) {
+    logger->info("scanned {} signatures in {:.2f}ms", signatures.size(),
+                 std::chrono::duration<double, std::milli>(
+                     std::chrono::steady_clock::now() - start)
+                     .count());
+  }
+
+  save_cache(key);
+}
+
+uintptr_t Game_Addresses::get(const std::string &name) const {
+  auto offset = offsets.find(name);
+  return offset != offsets.end() ? offset->second : 0;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#ifndef GAME_ADDRESSES_HPP
+#define GAME_ADDRESSES_HPP
+#include "config_defaults.hpp"
+#include "signature_scanner.hpp"
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include <spdlog/spdlog.h>
+
+// offsets from the module base in SilvrPS.exe, the build gdrpc targets
+// other builds can override any of these with a signature in the config
+constexpr std::array<std::pair<const char *, uintptr_t>, 7> DEFAULT_ADDRESSES{{
+    {"MenuLayer_init", 0x18D1EC},
+    {"PlayLayer_create", 0x83930},
+    {"PlayLayer_onQuit", 0x17EE20},
+    {"PlayLayer_showNewBest", 0x16D898},
+    {"EditorPauseLayer_onExitEditor", 0x93B01},
+    {"LevelEditorLayer_create", 0x15C21D},
+    // static pointer to the GameManager
+    {"game_manager", 0x3222D8},
+}};
+
+// where each function/global lives in the running executable
+// signatures are only scanned for once per build, the results are kept in
+// a file keyed by the executable's pe header
+class Game_Addresses {
+private:
+  typedef std::map<std::string, Config::Signature> Signatures;
+
+  std::string cache_filename;
+  std::unordered_map<std::string, uintptr_t> offsets;
+
+  // also covers the signatures, so editing them forces a scan
+  static uint64_t build_key(const Image_Info &info,
+                            const Signatures &signatures);
+
+  bool load_cache(uint64_t key);
+  void save_cache(uint64_t key);
+
+public:
+  Game_Addresses(std::string cache_filename = "gdrpc_signatures.cache");
+
+  // base is the module as loaded in memory
+  void resolve(const uint8_t *base, const Signatures &signatures,
+               std::shared_ptr<spdlog::logger> logger);
+
+  // offset from the module base, 0 if nothing by that name is known
+  uintptr_t get(const std::string &name) const;
+};
+
+#endif
@@ -12,31 +12,33 @@ LRESULT CALLBACK nWindowProc(HWND hwnd, UINT msg, WPARAM wparam,
     // idk what the correct function for this is tbh
     get_game_loop()->close();
     break;
+  case WM_ACTIVATEAPP:
+    get_game_loop()->on_focus(wparam != FALSE);
+    break;
+  case WM_KEYDOWN:
+  case WM_LBUTTONDOWN:
+  case WM_RBUTTONDOWN:
+  case WM_MOUSEMOVE:
+  case WM_MOUSEWHEEL:
+    get_game_loop()->on_input();
+    break;
   }
   return CallWindowProc((WNDPROC)oWindowProc, hwnd, msg, wparam, lparam);
 }
 
-HMODULE GetCurrentModule() {
-  HMODULE hModule = NULL;
-  GetModuleHandleEx(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS |
-                        GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
-                    (LPCTSTR)GetCurrentModule, &hModule);
-
-  return hModule;
-}
-
 template <typename T> T *offset_from_base(void *struct_ptr, int addr) {
   return reinterpret_cast<T *>(reinterpret_cast<uintptr_t>(struct_ptr) + addr);
 }
 
 int(__thiscall *MenuLayer_init_O)(void *menuLayer);
 int __fastcall MenuLayer_init_H(void *menuLayer) {
+  get_metrics()->count_hook(Hook_Id::MenuLayer_init);
   if (!setupDone) {
     if (auto logger = get_game_loop()->get_logger()) {
       logger->trace(FMT_STRING("menu layer setup called"));
     }
 
-    CreateThread(NULL, 0, mainThread, GetCurrentModule(), 0, NULL);
+    get_game_loop()->start();
     setupDone = true;
   }
   return MenuLayer_init_O(menuLayer);
@@ -44,6 +46,7 @@ int __fastcall MenuLayer_init_H(void *menuLayer) {
 
 void *(__fastcall *PlayLayer_create_O)(GJGameLevel *gameLevel);
 void *__fastcall PlayLayer_create_H(GJGameLevel *gameLevel) {
+  get_metrics()->count_hook(Hook_Id::PlayLayer_create);
   int levelID = gameLevel->levelID;
 
   Game_Loop *game_loop = get_game_loop();
@@ -68,6 +71,7 @@ levelID: {} @ {:#x}"),
 
 void(__fastcall *PlayLayer_onQuit_O)(void *playLayer);
 void __fastcall PlayLayer_onQuit_H(void *playLayer) {
+  get_metrics()->count_hook(Hook_Id::PlayLayer_onQuit);
   Game_Loop *game_loop = get_game_loop();
 
   if (auto logger = game_loop->get_logger()) {
@@ -86,7 +90,7 @@ void *(__thiscall *PlayLayer_showNewBest_O)(void *playLayer, char, float, int,
 void *__fastcall PlayLayer_showNewBest_H(void *playLayer, void *_edx, char p1,
                                          float p2, int p3, char p4, char p5,
                                          char p6) {
-
+  get_metrics()->count_hook(Hook_Id::PlayLayer_showNewBest);
   Game_Loop *game_loop = get_game_loop();
 
   auto current_gamelevel = game_loop->get_gamelevel();
@@ -109,6 +113,7 @@ void(__thiscall *EditorPauseLayer_onExitEditor_O)(void *editorPauseLayer,
                                                   void *);
 void __fastcall EditorPauseLayer_onExitEditor_H(void *editorPauseLayer,
                                                 void *_edx, void *p1) {
+  get_metrics()->count_hook(Hook_Id::EditorPauseLayer_onExitEditor);
   Game_Loop *game_loop = get_game_loop();
 
   if (auto logger = game_loop->get_logger()) {
@@ -124,6 +129,7 @@ void __fastcall EditorPauseLayer_onExitEditor_H(void *editorPauseLayer,
 
 void *(__fastcall *LevelEditorLayer_create_O)(GJGameLevel *gameLevel);
 void *__fastcall LevelEditorLayer_create_H(GJGameLevel *gameLevel) {
+  get_metrics()->count_hook(Hook_Id::LevelEditorLayer_create);
   Game_Loop *game_loop = get_game_loop();
 
   int levelID = gameLevel->levelID;
@@ -163,6 +169,7 @@ void(__thiscall *LevelEditorLayer_addSpecial_O)(void *LevelEditorLayer,
 
 void __fastcall LevelEditorLayer_addSpecial_H(void *self, void *_edx,
                                               void *object) {
+  get_metrics()->count_hook(Hook_Id::LevelEditorLayer_addSpecial);
   LevelEditorLayer_addSpecial_O(self, object);
 
   Game_Loop *game_loop = get_game_loop();
@@ -189,6 +196,7 @@ void(__thiscall *LevelEditorLayer_removeSpecial_O)(void *LevelEditorLayer,
                                                    void *object);
 void __fastcall LevelEditorLayer_removeSpecial_H(void *self, void *_edx,
                                                  void *object) {
+  get_metrics()->count_hook(Hook_Id::LevelEditorLayer_removeSpecial);
   LevelEditorLayer_removeSpecial_O(self, object);
 
   Game_Loop *game_loop = get_game_loop();
@@ -213,6 +221,7 @@ void __fastcall LevelEditorLayer_removeSpecial_H(void *self, void *_edx,
 
 void(__thiscall *CCDirector_end_O)(void *CCDirector);
 void __fastcall CCDirector_end_H(void *CCDirector) {
+  get_metrics()->count_hook(Hook_Id::CCDirector_end);
   Game_Loop *game_loop = get_game_loop();
 
   if (auto logger = game_loop->get_logger()) {
@@ -224,21 +233,10 @@ void __fastcall CCDirector_end_H(void *CCDirector) {
   CCDirector_end_O(CCDirector);
 }
 
-// no need to export this, not putting in .h
-struct game_hook {
-  void *orig_addr;
-  void *hook_fn;
-  void **orig_fn;
-};
-
-#define CREATE_HOOK(ADDRESS, NAME)                                             \
-  {                                                                            \
-    reinterpret_cast<void *>(ADDRESS), reinterpret_cast<void *>(&(NAME##_H)),  \
-        reinterpret_cast<void **>(&(NAME##_O))                                 \
-  }
-
-#define CREATE_GD_HOOK(ADDRESS, NAME)                                          \
-  CREATE_HOOK(offset_from_base<void>(gd_handle, ADDRESS), NAME)
+#define GD_HOOK(NAME)                                                          \
+  #NAME, [&]() { return gd_target(#NAME); },                                   \
+      reinterpret_cast<void *>(&(NAME##_H)),                                   \
+      reinterpret_cast<void **>(&(NAME##_O))
 
 void doTheHook() {
   Game_Loop *game_loop = get_game_loop();
@@ -288,29 +286,46 @@ void doTheHook() {
   oWindowProc = SetWindowLongPtrA(GetForegroundWindow(), GWL_WNDPROC,
                                   (LONG_PTR)nWindowProc);
 
+  game_loop->resolve_addresses(reinterpret_cast<const uint8_t *>(gd_handle));
+
+  auto gd_target = [&](const char *name) -> void * {
+    auto offset = game_loop->get_game_address(name);
+    return offset ? offset_from_base<void>(gd_handle, static_cast<int>(offset))
+                  : nullptr;
+  };
+
+  // the object count only changes in the editor through these
+  auto wants_objects = [&]() { return game_loop->editor_uses("objects"); };
+
   // wall of hooks
-  std::array<game_hook, 9> hooks{{
-      CREATE_GD_HOOK(0x18D1EC, MenuLayer_init),
-      CREATE_GD_HOOK(0x83930, PlayLayer_create),
-      CREATE_GD_HOOK(0x17EE20, PlayLayer_onQuit),
-      CREATE_GD_HOOK(0x16D898, PlayLayer_showNewBest),
-      CREATE_GD_HOOK(0x93B01, EditorPauseLayer_onExitEditor),
-      CREATE_GD_HOOK(0x15C21D, LevelEditorLayer_create),
-      CREATE_HOOK(
-        GetProcAddress(cocos_handle, "?end@CCDirector@cocos2d@@QAEXXZ"),
-        CCDirector_end)
-  }};
-
-  for (const auto &hook : hooks) {
-    MH_CreateHook(hook.orig_addr, hook.hook_fn, hook.orig_fn);
-    if (auto status = MH_EnableHook(hook.orig_addr); status != MH_OK) {
-      auto message = fmt::format(
-          FMT_STRING("error hooking function with code {}"), status);
-      game_loop->display_error(message);
-    }
+  Hook_Registry hooks;
+  hooks.add({GD_HOOK(MenuLayer_init)});
+  hooks.add({GD_HOOK(PlayLayer_create)});
+  hooks.add({GD_HOOK(PlayLayer_onQuit)});
+  hooks.add({GD_HOOK(PlayLayer_showNewBest)});
+  hooks.add({GD_HOOK(EditorPauseLayer_onExitEditor)});
+  hooks.add({GD_HOOK(LevelEditorLayer_create)});
+  // no built in address, these need a signature
+  hooks.add({GD_HOOK(LevelEditorLayer_addSpecial), true, wants_objects});
+  hooks.add({GD_HOOK(LevelEditorLayer_removeSpecial), true, wants_objects});
+  hooks.add({"CCDirector_end",
+             [&]() -> void * {
+               return reinterpret_cast<void *>(GetProcAddress(
+                   cocos_handle, "?end@CCDirector@cocos2d@@QAEXXZ"));
+             },
+             reinterpret_cast<void *>(&CCDirector_end_H),
+             reinterpret_cast<void **>(&CCDirector_end_O)});
+
+  try {
+    hooks.install(logger);
+  } catch (const std::exception &e) {
+    auto message =
+        fmt::format(FMT_STRING("Failed to hook the game\n{}."), e.what());
+    game_loop->display_error(message);
+    return;
   }
 
   if (logger) {
-    logger->debug("hooks setup");
+    logger->info("hooks setup\n{}", hooks.report());
   }
-}
\ No newline at end of file
+}
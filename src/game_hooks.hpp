@@ -1,6 +1,7 @@
 #pragma once
 #include "game_loop.hpp"
 #include "gjgamelevel.hpp"
+#include "hook_registry.hpp"
 
 #include <windows.h>
 #include <array>
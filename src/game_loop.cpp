@@ -1,4 +1,5 @@
 #include "game_loop.hpp"
+#include "text_encoding.hpp"
 
 Game_Loop game_loop = Game_Loop();
 
@@ -33,65 +34,219 @@ std::string getTextFromKey(std::string key) {
   return key;
 }
 
-std::string formatWithLevel(std::string &s, GDlevel &level,
-                            GJGameLevel *in_memory) {
-  std::string f;
+void formatWithLevel(Presence_Field &out, const std::string &s,
+                     GDlevel &level, GJGameLevel *in_memory) {
   try {
-    f = fmt::format(
+    out.format(
         s, fmt::arg("id", level.levelID), fmt::arg("name", level.name),
         fmt::arg("best", in_memory->normalPercent),
         fmt::arg("diff", getTextFromKey(getDifficultyName(level))),
         fmt::arg("author", level.author), fmt::arg("stars", level.stars),
         fmt::arg("objects", in_memory->objectCount), fmt::arg("attempts", in_memory->attempts),
         fmt::arg("jumps", in_memory->jumps), fmt::arg("clicks", in_memory->clicks),
-        fmt::arg("best_percent", in_memory->normalPercent));
+        fmt::arg("best_percent", in_memory->normalPercent),
+        fmt::arg("song", level.song.name), fmt::arg("artist", level.song.artist),
+        fmt::arg("length", level.stats.length),
+        fmt::arg("triggers", level.stats.triggers),
+        fmt::arg("decorations", level.stats.decorations),
+        fmt::arg("hazards", level.stats.hazards),
+        fmt::arg("speed_portals", level.stats.speed_portals),
+        fmt::arg("author_stars", level.author_info.stars),
+        fmt::arg("author_cp", level.author_info.creator_points),
+        fmt::arg("author_rank", std::max(level.author_info.rank, 0)),
+        fmt::arg("sessions", level.sessions),
+        fmt::arg("total_time", format_play_time(level.time_played)));
   } catch (const fmt::format_error &e) {
     std::string error_string =
         fmt::format("Error found while parsing {}\n{}", s, e.what());
 
     get_game_loop()->display_error(error_string);
-    f = s;
+    out.assign(s);
   }
-  return f;
+}
+
+// which level fields each placeholder in formatWithLevel reads
+constexpr std::pair<const char *, Level_Field> LEVEL_PLACEHOLDERS[] = {
+    {"id", Level_Field::id},
+    {"name", Level_Field::name},
+    {"best", Level_Field::progress},
+    {"diff", Level_Field::rating},
+    {"author", Level_Field::author},
+    {"stars", Level_Field::rating},
+    {"objects", Level_Field::objects},
+    {"attempts", Level_Field::progress},
+    {"jumps", Level_Field::progress},
+    {"clicks", Level_Field::progress},
+    {"best_percent", Level_Field::progress},
+    {"song", Level_Field::song},
+    {"artist", Level_Field::song},
+    {"length", Level_Field::stats},
+    {"triggers", Level_Field::stats},
+    {"decorations", Level_Field::stats},
+    {"hazards", Level_Field::stats},
+    {"speed_portals", Level_Field::stats},
+    {"author_stars", Level_Field::profile},
+    {"author_cp", Level_Field::profile},
+    {"author_rank", Level_Field::profile},
+    {"sessions", Level_Field::history},
+    {"total_time", Level_Field::history},
+};
+
+uint32_t level_placeholder_mask(const std::string &s) {
+  uint32_t mask = 0;
+
+  for (size_t i = 0; i < s.size(); i++) {
+    if (s[i] != '{') {
+      continue;
+    }
+    if (i + 1 < s.size() && s[i + 1] == '{') {
+      // escaped brace
+      i++;
+      continue;
+    }
+
+    auto end = s.find_first_of(":}", i + 1);
+    if (end == std::string::npos) {
+      break;
+    }
+
+    auto name = s.substr(i + 1, end - i - 1);
+    auto placeholder = std::find_if(
+        std::begin(LEVEL_PLACEHOLDERS), std::end(LEVEL_PLACEHOLDERS),
+        [&name](const auto &entry) { return name == entry.first; });
+
+    // anything unknown fails to format, so try again every time
+    mask |= placeholder != std::end(LEVEL_PLACEHOLDERS)
+                ? level_field_bit(placeholder->second)
+                : ALL_LEVEL_FIELDS;
+    i = end;
+  }
+
+  return mask;
 }
 
 Game_Loop *get_game_loop() { return &game_loop; }
 
-void Game_Loop::update_presence_w(std::string &details, std::string &largeText,
-                                  std::string &smallText, std::string &state,
-                                  std::string &smallImage) {
+void Game_Loop::refresh_level() {
+  parseGJGameLevel(gamelevel, level);
+
+  songs.lookup(level.audioTrack, level.songID, level.song);
+  level.mark(Level_Field::song,
+             fingerprint_text(level.song.artist,
+                              fingerprint_text(level.song.name)));
+
+  authors.lookup(level.authorID, level.authorAccountID, level.author_info);
+  level.mark(Level_Field::profile, fingerprint(level.author_info.stars,
+                                               level.author_info.creator_points,
+                                               level.author_info.rank));
+
+  decoder.lookup(gamelevel, level.stats);
+  const auto &stats = level.stats;
+  level.mark(Level_Field::stats,
+             fingerprint(stats.length, stats.triggers, stats.decorations,
+                         stats.hazards, stats.speed_portals));
+
+  Play_Stats play;
+  history.lookup(level.levelID, play);
+  level.sessions = static_cast<int>(play.sessions);
+  level.time_played = play.seconds;
+  level.mark(Level_Field::history,
+             fingerprint(level.sessions, level.time_played));
+}
 
-  if (logger) {
-    logger->info("setting presence:\n\
-details: `{}` | state: `{}`\n\
-small_text: `{}` | large_text: `{}`\n\
-timestamp_update: {}",
-                 details, state, smallText, largeText, update_timestamp);
+void Game_Loop::render_level_field(Rendered_Template &cached,
+                                   const std::string &s, Presence_Field &out) {
+  if (cached.source != &s) {
+    cached.source = &s;
+    cached.fields = level_placeholder_mask(s);
+    formatWithLevel(cached.text, s, level, gamelevel);
+  } else if ((cached.fields & level.dirty) != 0) {
+    formatWithLevel(cached.text, s, level, gamelevel);
   }
 
+  out = cached.text;
+}
+
+void Game_Loop::update_presence_w(PresenceFrame &frame) {
   if (update_timestamp) {
     time(&current_timestamp);
     update_timestamp = false;
   }
-  discord->update(details.c_str(), largeText.c_str(), smallText.c_str(),
-                  state.c_str(), smallImage.c_str(), current_timestamp);
+  frame.timestamp = current_timestamp;
+
+  // the back frame is now complete, so it becomes the one being sent
+  front_frame = 1 - front_frame;
+  auto &front = frames.at(front_frame);
+  if (front == frames.at(1 - front_frame)) {
+    get_metrics()->presence_coalesced.fetch_add(1, std::memory_order_relaxed);
+    if (logger) {
+      logger->debug("presence unchanged, skipping update");
+    }
+    return;
+  }
+
+  if (logger) {
+    logger->info("setting presence:\n\
+details: `{}` | state: `{}`\n\
+small_text: `{}` | large_text: `{}`\n\
+timestamp: {}",
+                 front.details.c_str(), front.state.c_str(),
+                 front.small_text.c_str(), front.large_text.c_str(),
+                 front.timestamp);
+  }
+
+  get_metrics()->presence_sent.fetch_add(1, std::memory_order_relaxed);
+  discord->update(front.details.c_str(), front.large_text.c_str(),
+                  front.small_text.c_str(), front.state.c_str(),
+                  front.small_image.c_str(), front.timestamp);
 }
 
 void Game_Loop::close() {
+  if (closed.exchange(true)) {
+    return;
+  }
+
   if (logger) {
     logger->warn("shutdown called!");
+    logger->info("request telemetry:\n{}", get_metrics()->summary());
+  }
+
+  loop_thread.request_stop();
+  bool loop_stopped = loop_thread.join_for(LOOP_STOP_TIMEOUT);
+
+  // unblocks the workers below if they're waiting on the server
+  if (client) {
+    client->stop();
+  }
+
+  songs.stop();
+  authors.stop();
+  decoder.stop();
+  metrics_server.stop();
+  feed.close();
+  override_server.stop();
+
+  if (loop_stopped) {
+    history.stopped();
+    discord->shutdown();
+  } else if (logger) {
+    // it may be in the middle of an update, the pipe closes with the process
+    logger->warn("loop did not stop in time, leaving discord connected");
   }
-  discord->shutdown();
 }
 
 Game_Loop::Game_Loop()
     : player_state(playerState::menu), current_timestamp(time(nullptr)),
       gamelevel(nullptr), update_presence(false), update_timestamp(false),
-      discord(get_discord()), logger(nullptr) {
+      discord(get_discord()), discord_state(Discord_State::disconnected),
+      client(nullptr), logger(nullptr),
+      front_frame(0), closed(false), away(false), feed_enabled(false),
+      rank(-1) {
 }
 
 void Game_Loop::initialize_config() {
   // config time!
+  bool from_snapshot = false;
   try {
     const std::string filename = "gdrpc.toml";
     if (!std::ifstream(filename)) {
@@ -101,9 +256,22 @@ void Game_Loop::initialize_config() {
                   << this->config.into_toml() << std::endl;
     }
 
-    const toml::value config = toml::parse(filename);
-    this->config.from_toml(config);
+    from_snapshot = load_config_snapshot(filename, this->config);
+    if (!from_snapshot) {
+      const toml::value config = toml::parse(filename);
+      this->config.from_toml(config);
+      save_config_snapshot(filename, this->config);
+    }
+
+    this->rules.compile(this->config.rule);
 
+    activity.set_idle_after(
+        std::chrono::seconds(this->config.settings.idle_after));
+
+    auto &thread_options = worker_thread_options();
+    thread_options.low_priority = this->config.settings.low_priority_threads;
+    thread_options.affinity_mask =
+        static_cast<uint64_t>(this->config.settings.worker_affinity);
   } catch (const std::exception &e) {
     auto message = fmt::format(
         FMT_STRING("Error found while trying to load config:\n{}"), e.what());
@@ -116,6 +284,8 @@ void Game_Loop::initialize_config() {
     logger->set_level(spdlog::level::trace);
     logger->flush_on(spdlog::level::debug);
     logger->info("gdrpc v{}", Config::LATEST_VERSION);
+    logger->debug("config loaded from {}",
+                  from_snapshot ? "snapshot" : "toml");
   }
 }
 
@@ -130,24 +300,84 @@ void Game_Loop::initialize_loop() {
     logger->trace("discord initialized");
   }
 
-  large_text = this->config.user.default;
+  if (auto port = this->config.settings.metrics_port; port != 0) {
+    try {
+      metrics_server.start(port);
+      if (logger) {
+        logger->info("serving metrics on http://127.0.0.1:{}/metrics", port);
+      }
+    } catch (const std::exception &e) {
+      if (logger) {
+        logger->warn("failed to start metrics endpoint\n{}", e.what());
+      }
+    }
+  }
+
+  feed_enabled = this->config.settings.presence_feed ||
+                 this->config.settings.feed_port != 0;
+  try {
+    if (this->config.settings.presence_feed) {
+      feed.open();
+    }
+    if (auto port = this->config.settings.feed_port; port != 0) {
+      feed.start_stream(port);
+      if (logger) {
+        logger->info("streaming presence on http://127.0.0.1:{}/presence",
+                     port);
+      }
+    }
+  } catch (const std::exception &e) {
+    if (logger) {
+      logger->warn("failed to start presence feed\n{}", e.what());
+    }
+  }
+
+  if (this->config.settings.override_server) {
+    try {
+      override_server.start(overrides, [this]() {
+        set_update_presence(true);
+        loop_thread.wake();
+      });
+      if (logger) {
+        logger->info("accepting presence overrides on {}",
+                     override_server_path());
+      }
+    } catch (const std::exception &e) {
+      if (logger) {
+        logger->warn("failed to start override server\n{}", e.what());
+      }
+    }
+  }
+
+  large_text = this->config.user.default_text;
 
   int *gd_base =
       (int *)GetModuleHandleA(this->config.settings.executable_name.c_str());
-  int *accountID = get_address(gd_base, {0x3222D8, 0x120});
+  auto game_manager = static_cast<int>(addresses.get("game_manager"));
+  int *accountID = get_address(gd_base, {game_manager, 0x120});
+
+  client = std::make_shared<GD_Client>(this->config.settings.base_url,
+                                       this->config.settings.url_prefix);
+
+  // song and author lookups only trigger a refresh, the loop picks the
+  // result up
+  songs.start(client, [this]() { set_update_presence(true); });
+  authors.start(client, [this]() { set_update_presence(true); });
+  history.open();
+  decoder.start([this]() { set_update_presence(true); },
+                [this](const std::string &error) {
+                  if (logger) {
+                    logger->warn("failed to decode level string\n{}", error);
+                  }
+                });
 
   GDuser user;
   if (this->config.user.get_rank) {
-    GD_Client client = GD_Client(this->config.settings.base_url,
-                                 this->config.settings.url_prefix);
     if (logger) {
       logger->debug("getting infomation for user {}", *accountID);
     }
     try {
-      bool userInfoSuccess = client.get_user_info(*accountID, user);
-      if (userInfoSuccess) {
-        client.get_user_rank(user);
-      }
+      client->get_ranked_user(*accountID, user);
     } catch (const std::exception &e) {
       if (logger) {
         logger->warn("failed to get user info or rank\n{}", e.what());
@@ -155,13 +385,31 @@ void Game_Loop::initialize_loop() {
     }
   }
 
+  rank = user.rank;
   if (user.rank != -1) {
-    large_text =
-        fmt::format(this->config.user.ranked, fmt::arg("name", user.name),
-                    fmt::arg("rank", user.rank));
+    auto now = std::time(nullptr);
+    rank_history.open(now);
+    if (!rank_history.append({now, *accountID, user.rank, user.stars}) &&
+        logger) {
+      logger->warn("failed to save rank history");
+    }
+
+    int day_change = 0, week_change = 0;
+    bool day_known = rank_history.rank_change(
+        *accountID, std::chrono::hours(24), now, day_change);
+    bool week_known = rank_history.rank_change(
+        *accountID, std::chrono::hours(24 * 7), now, week_change);
+
+    large_text = fmt::format(
+        this->config.user.ranked, fmt::arg("name", user.name),
+        fmt::arg("rank", user.rank),
+        fmt::arg("rank_delta_day", format_rank_change(day_known, day_change)),
+        fmt::arg("rank_delta_week",
+                 format_rank_change(week_known, week_change)));
   } else {
-    char *username = (char *)(get_address(gd_base, {0x3222D8, 0x108}));
+    char *username = (char *)(get_address(gd_base, {game_manager, 0x108}));
     large_text = std::string(username); // hopeful fallback
+    normalize_text(large_text);
   }
 
   update_presence = true;
@@ -170,14 +418,48 @@ void Game_Loop::initialize_loop() {
 
 void Game_Loop::on_loop() {
   discord->run_callbacks();
-  if (update_presence) {
-    // we don't need to keep this in the class, every time presence updates it
-    // gets remade anyways
-    std::string details, state, small_text, small_image;
+  get_metrics()->discord_status.store(discord->get_status(),
+                                      std::memory_order_relaxed);
+
+  if (auto state = discord->get_state(); state != discord_state) {
+    if (logger) {
+      logger->info("discord {} (status {})", discord_state_name(state),
+                   discord->get_status());
+    }
+    discord_state = state;
+    get_metrics()->discord_state.store(static_cast<int>(state),
+                                       std::memory_order_relaxed);
+  }
+
+  if (auto now_away = activity.is_away(); now_away != away) {
+    if (logger) {
+      logger->debug(now_away ? "player went away" : "player is back");
+    }
+    away = now_away;
+    update_presence = true;
+  }
+
+  if (overrides.expire(std::chrono::steady_clock::now())) {
+    update_presence = true;
+  }
+
+  if (player_state == playerState::level && gamelevel) {
+    history.playing(gamelevel->levelID, gamelevel->attempts,
+                    gamelevel->normalPercent);
+  } else {
+    history.stopped();
+  }
 
-    switch (player_state) {
+  // cleared before rendering, so a worker setting it mid-render isn't lost
+  if (update_presence.exchange(false)) {
+    // render into the back frame, fields are fixed size so nothing allocates
+    auto &frame = frames.at(1 - front_frame);
+    frame.large_text.assign(large_text);
+
+    auto state = away ? playerState::away : player_state;
+    switch (state) {
     case playerState::level: {
-      parseGJGameLevel(gamelevel, level);
+      refresh_level();
 
       auto level_location = gamelevel->levelType;
 
@@ -191,56 +473,124 @@ void Game_Loop::on_loop() {
                       folder);
       }
 
-      if (level_location == GJLevelType::Editor) {
-        auto playtesting = this->config.level.at(folder).playtesting;
-
-        details = formatWithLevel(playtesting.detail, level, this->gamelevel);
-        state = formatWithLevel(playtesting.state, level, this->gamelevel);
-        small_text =
-            formatWithLevel(playtesting.smalltext, level, this->gamelevel);
-        small_image = "creator_point";
+      auto rule = this->rules.match(level, level_location);
+      const Config::Presence *presence;
+      if (rule != -1) {
+        presence = &this->config.rule.at(rule);
+      } else if (level_location == GJLevelType::Editor) {
+        presence = &this->config.level.at(folder).playtesting;
       } else {
-        auto saved = this->config.level.at(folder).saved;
+        presence = &this->config.level.at(folder).saved;
+      }
 
-        details = formatWithLevel(saved.detail, level, this->gamelevel);
-        state = formatWithLevel(saved.state, level, this->gamelevel);
-        small_text = formatWithLevel(saved.smalltext, level, this->gamelevel);
-        small_image = getDifficultyName(level);
+      if (logger && rule != -1) {
+        logger->debug("level matched rule {}", rule + 1);
+      }
+
+      render_level_field(rendered.at(0), presence->detail, frame.details);
+      render_level_field(rendered.at(1), presence->state, frame.state);
+      render_level_field(rendered.at(2), presence->smalltext,
+                         frame.small_text);
+      level.dirty = 0;
+
+      if (level_location == GJLevelType::Editor) {
+        frame.small_image.assign("creator_point");
+      } else {
+        frame.small_image.assign(getDifficultyName(level));
       }
       break;
     }
     case playerState::editor: {
-      parseGJGameLevel(gamelevel, level);
+      refresh_level();
 
       auto folder = static_cast<size_t>(gamelevel->levelFolder);
       if (folder >= this->config.editor.size())
         folder = 0;
 
-      auto editor = this->config.editor.at(folder);
+      const auto &editor = this->config.editor.at(folder);
 
-      details = formatWithLevel(editor.detail, level, this->gamelevel);
-      state = formatWithLevel(editor.state, level, this->gamelevel);
-      small_text = formatWithLevel(editor.smalltext, level, this->gamelevel);
-      small_image = "creator_point";
+      render_level_field(rendered.at(0), editor.detail, frame.details);
+      render_level_field(rendered.at(1), editor.state, frame.state);
+      render_level_field(rendered.at(2), editor.smalltext, frame.small_text);
+      level.dirty = 0;
+      frame.small_image.assign("creator_point");
       break;
     }
     case playerState::menu: {
-      auto menu = this->config.menu;
+      const auto &menu = this->config.menu;
+
+      frame.details.assign(menu.detail);
+      frame.state.assign(menu.state);
+      frame.small_text.assign(menu.smalltext);
+      frame.small_image.assign("", 0);
+      break;
+    }
+    case playerState::away: {
+      const auto &away_presence = this->config.away;
 
-      details = menu.detail;
-      state = menu.state;
-      small_text = menu.smalltext;
-      small_image = "";
+      frame.details.assign(away_presence.detail);
+      frame.state.assign(away_presence.state);
+      frame.small_text.assign(away_presence.smalltext);
+      frame.small_image.assign("", 0);
       break;
     }
     }
-    update_presence_w(details, large_text, small_text, state, small_image);
-    update_presence = false;
+    overrides.apply(frame);
+    update_presence_w(frame);
+  }
+
+  if (feed_enabled) {
+    publish_feed();
+  }
+}
+
+void Game_Loop::publish_feed() {
+  Presence_Snapshot snapshot;
+  std::memset(&snapshot, 0, sizeof(snapshot));
+
+  switch (away ? playerState::away : player_state) {
+  case playerState::level:
+    snapshot.state = Feed_State::level;
+    break;
+  case playerState::editor:
+    snapshot.state = Feed_State::editor;
+    break;
+  case playerState::menu:
+    snapshot.state = Feed_State::menu;
+    break;
+  case playerState::away:
+    snapshot.state = Feed_State::away;
+    break;
+  }
+
+  // level is only parsed while in a level or the editor
+  if (player_state != playerState::menu && gamelevel) {
+    snapshot.level_id = gamelevel->levelID;
+    snapshot.best = gamelevel->normalPercent;
+    snapshot.attempts = gamelevel->attempts;
+    snapshot.stars = level.stars;
+    copy_feed_text(snapshot.level_name, level.name.data(), level.name.size());
+    copy_feed_text(snapshot.author, level.author.data(), level.author.size());
   }
+
+  snapshot.rank = rank;
+
+  const auto &front = frames.at(front_frame);
+  snapshot.timestamp = static_cast<int64_t>(front.timestamp);
+  auto text = [](char(&field)[FEED_TEXT_SIZE], const Presence_Field &from) {
+    copy_feed_text(field, from.c_str(), from.size());
+  };
+  text(snapshot.details, front.details);
+  text(snapshot.state_text, front.state);
+  text(snapshot.large_text, front.large_text);
+  text(snapshot.small_text, front.small_text);
+  text(snapshot.small_image, front.small_image);
+
+  feed.publish(snapshot);
 }
 
 void Game_Loop::set_update_presence(bool n_presence) {
-  update_presence = n_presence;
+  update_presence.store(n_presence);
 }
 
 void Game_Loop::set_update_timestamp(bool n_timestamp) {
@@ -253,7 +603,24 @@ void Game_Loop::set_gamelevel(GJGameLevel *n_gamelevel) {
 
 GJGameLevel *Game_Loop::get_gamelevel() { return gamelevel; }
 
-void Game_Loop::set_state(playerState n_state) { player_state = n_state; }
+void Game_Loop::set_state(playerState n_state) {
+  player_state = n_state;
+  if (activity.record_state(n_state == playerState::menu)) {
+    loop_thread.wake();
+  }
+}
+
+void Game_Loop::on_focus(bool focused) {
+  if (activity.record_focus(focused)) {
+    loop_thread.wake();
+  }
+}
+
+void Game_Loop::on_input() {
+  if (activity.record_activity()) {
+    loop_thread.wake();
+  }
+}
 
 playerState Game_Loop::get_state() { return player_state; }
 
@@ -268,6 +635,30 @@ std::string Game_Loop::get_executable_name() {
   return this->config.settings.executable_name;
 }
 
+void Game_Loop::resolve_addresses(const uint8_t *gd_base) {
+  addresses.resolve(gd_base, this->config.signatures, logger);
+}
+
+uintptr_t Game_Loop::get_game_address(const std::string &name) {
+  return addresses.get(name);
+}
+
+bool Game_Loop::editor_uses(const std::string &placeholder) {
+  // also catches format specs like {objects:>5}
+  auto plain = "{" + placeholder + "}";
+  auto with_spec = "{" + placeholder + ":";
+
+  for (const auto &editor : this->config.editor) {
+    for (const auto *text : {&editor.detail, &editor.state, &editor.smalltext}) {
+      if (text->find(plain) != std::string::npos ||
+          text->find(with_spec) != std::string::npos) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
 std::shared_ptr<spdlog::logger> Game_Loop::get_logger() { return logger; }
 
 void Game_Loop::display_error(std::string message) {
@@ -277,23 +668,45 @@ void Game_Loop::display_error(std::string message) {
   }
 }
 
-DWORD WINAPI mainThread(LPVOID lpParam) {
-  game_loop.initialize_loop();
-  while (true) {
+void Game_Loop::start() {
+  loop_thread.start([this](Stop_Token token) { run(token); });
+}
+
+void Game_Loop::run(Stop_Token token) {
+  initialize_loop();
+  while (!token.stop_requested()) {
+    auto loop_start = std::chrono::steady_clock::now();
     try {
-      game_loop.on_loop();
+      on_loop();
     } catch (const std::exception &e) {
-      if (auto logger = game_loop.get_logger()) {
+      if (logger) {
         logger->critical("unhandled exception thrown in loop\n{}", e.what());
       }
     } catch (...) {
-      if (auto logger = game_loop.get_logger()) {
+      if (logger) {
         logger->critical("unknown exception thrown");
       }
     }
-
-    Sleep(1000);
+    get_metrics()->loop_time.observe(std::chrono::duration<double>(
+                                         std::chrono::steady_clock::now() -
+                                         loop_start)
+                                         .count());
+
+    // wake up in time to take down an expiring override, or to reconnect
+    auto interval = activity.next_interval();
+    auto now = std::chrono::steady_clock::now();
+    auto until_expiry = overrides.until_next_expiry(now);
+    if (until_expiry < interval) {
+      interval = std::chrono::ceil<std::chrono::milliseconds>(until_expiry);
+    }
+    auto until_attempt = discord->until_next_attempt(now);
+    if (until_attempt < interval) {
+      interval = std::chrono::ceil<std::chrono::milliseconds>(until_attempt);
+    }
+    token.sleep_for(interval);
   }
 
-  return 0;
+  if (logger) {
+    logger->debug("loop stopped");
+  }
 }
@@ -1,12 +1,31 @@
 #pragma once
+#include "activity_tracker.hpp"
+#include "author_cache.hpp"
+#include "config_cache.hpp"
 #include "config_defaults.hpp"
+#include "game_addresses.hpp"
 #include "gdapi.hpp"
 #include "gjgamelevel.hpp"
+#include "metrics.hpp"
+#include "override_server.hpp"
+#include "play_history.hpp"
+#include "presence_feed.hpp"
+#include "presence_frame.hpp"
+#include "presence_overrides.hpp"
 #include "presence_wrapper.hpp"
+#include "rank_history.hpp"
+#include "rule_matcher.hpp"
+#include "song_cache.hpp"
+#include "worker_thread.hpp"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <ctime>
+#include <iterator>
 #include <cctype>
+#include <utility>
 #include <vector>
 
 #include <fstream>
@@ -22,6 +41,8 @@ enum class playerState {
   level,
   editor,
   menu,
+  // only used for rendering, the player is never set to this
+  away,
 };
 
 class Game_Loop {
@@ -32,18 +53,67 @@ private:
 
   std::shared_ptr<spdlog::logger> logger;
 
-  bool update_presence, update_timestamp;
+  // set from hooks and worker callbacks, taken by the loop before it renders
+  std::atomic<bool> update_presence;
+  bool update_timestamp;
   std::time_t current_timestamp;
 
   Discord_Presence *discord;
+  // last seen, so transitions get logged once
+  Discord_State discord_state;
+  std::shared_ptr<GD_Client> client;
+  Song_Cache songs;
+  Author_Cache authors;
+  Rank_History rank_history;
+  Play_History history;
+  Level_Decoder decoder;
+  Rule_Matcher rules;
+  Game_Addresses addresses;
+  Metrics_Server metrics_server;
+  Presence_Feed feed;
+  bool feed_enabled;
+  Presence_Overrides overrides;
+  Override_Server override_server;
+
+  // the loop itself, it gets this long to notice it should stop
+  Worker_Thread loop_thread;
+  static constexpr std::chrono::milliseconds LOOP_STOP_TIMEOUT{500};
+  std::atomic<bool> closed;
+
+  Activity_Tracker activity;
+  bool away;
 
   Config::Config_Format config;
 
   std::string large_text;
 
-  // wrapper to presence update that allows strings + debug messages
-  void update_presence_w(std::string &, std::string &, std::string &,
-                         std::string &, std::string &);
+  // rendered into the back frame, then swapped to the front and sent
+  std::array<PresenceFrame, 2> frames;
+  size_t front_frame;
+
+  // a level template as last formatted, kept until a field it shows changes
+  struct Rendered_Template {
+    const std::string *source = nullptr;
+    uint32_t fields = 0;
+    Presence_Field text;
+  };
+  // details, state and small text
+  std::array<Rendered_Template, 3> rendered;
+
+  // parses the level and fills in what the caches know about it
+  void refresh_level();
+  // formats s into out, unless it was the last template there and nothing it
+  // reads is dirty
+  void render_level_field(Rendered_Template &cached, const std::string &s,
+                          Presence_Field &out);
+
+  // swaps in the rendered frame and sends it if anything changed
+  void update_presence_w(PresenceFrame &);
+
+  // the player's rank, for the feed
+  int rank;
+  // what overlays see, published every loop
+  void publish_feed();
 
 public:
   Game_Loop();
@@ -54,6 +124,10 @@ public:
   GJGameLevel *get_gamelevel();
   void set_gamelevel(GJGameLevel *);
 
+  // from the window procedure, these wake the loop if it's sleeping long
+  void on_focus(bool focused);
+  void on_input();
+
   void set_update_presence(bool);
   void set_update_timestamp(bool);
 
@@ -61,6 +135,15 @@ public:
 
   std::string get_executable_name();
 
+  // scans for the configured signatures in the loaded executable
+  void resolve_addresses(const uint8_t *gd_base);
+  // offset of a hook target or global from the executable's base
+  // 0 if there's no known address for it
+  uintptr_t get_game_address(const std::string &name);
+
+  // whether any editor template shows {placeholder}
+  bool editor_uses(const std::string &placeholder);
+
   std::shared_ptr<spdlog::logger> get_logger();
 
   void on_loop();
@@ -68,12 +151,15 @@ public:
   void initialize_config();
   void initialize_loop();
 
+  // runs initialize_loop and then on_loop on a worker thread until closed
+  void start();
+  void run(Stop_Token token);
+
+  // safe to call more than once, only the first one does anything
   void close();
 
   void display_error(std::string message);
 };
 
-DWORD WINAPI mainThread(LPVOID lpParam);
-
 Game_Loop *get_game_loop();
 #endif
\ No newline at end of file
@@ -1,4 +1,10 @@
 #include "gdapi.hpp"
+#include "metrics.hpp"
+#include "text_encoding.hpp"
+#include "worker_thread.hpp"
+
+#include <condition_variable>
+#include <optional>
 
 Demon_Difficulty getDemonDiffValue(int diff) {
   switch (diff) {
@@ -61,30 +67,118 @@ std::string getDifficultyName(GDlevel &level) {
   }
 }
 
-GD_Client::GD_Client(std::string host, std::string prefix)
-    : game_version(21), secret("Wmfd2893gb7"), host(host), prefix(prefix) {
-  client = std::make_shared<httplib::Client>(host.c_str());
+GD_Client::GD_Client(std::vector<std::string> hosts, std::string prefix,
+                     std::chrono::milliseconds rejected_ttl)
+    : game_version(21), secret("Wmfd2893gb7"), prefix(prefix),
+      mirrors(std::make_shared<Mirror_Pool>(hosts)),
+      rejected_ttl(rejected_ttl) {
+  Form_Body common;
+  common.add("gameVersion", game_version).add("secret", secret);
+  common_fields = common.str();
 }
 
-std::string GD_Client::post_request(std::string url, Params &params) {
-  params.emplace("gameVersion", std::to_string(game_version));
-  params.emplace("secret", secret);
+std::string GD_Client::post_request(const std::string &url,
+                                    const std::string &body) {
+  // fields are always written in the same order, so the body is canonical
+  std::string key = url + '?' + body;
+
+  std::promise<std::string> promise;
+  std::shared_future<std::string> flight;
+  bool leader = false;
+  {
+    std::lock_guard<std::mutex> lock(flights_mutex);
+
+    if (auto found = rejected.find(key); found != rejected.end()) {
+      if (std::chrono::steady_clock::now() < found->second) {
+        throw Not_Found_Error("post request failure");
+      }
+      rejected.erase(found);
+    }
+
+    if (auto found = in_flight.find(key); found != in_flight.end()) {
+      flight = found->second;
+    } else {
+      flight = promise.get_future().share();
+      in_flight.emplace(key, flight);
+      leader = true;
+    }
+  }
+
+  if (!leader) {
+    // rethrows whatever the first caller got
+    return flight.get();
+  }
+
+  try {
+    auto response = send_request(url, body);
+
+    std::lock_guard<std::mutex> lock(flights_mutex);
+    in_flight.erase(key);
+    promise.set_value(response);
+    return response;
+  } catch (const Not_Found_Error &) {
+    std::lock_guard<std::mutex> lock(flights_mutex);
+    in_flight.erase(key);
+    promise.set_exception(std::current_exception());
+
+    // forget old rejections while we're here, so this can't grow forever
+    auto now = std::chrono::steady_clock::now();
+    for (auto it = rejected.begin(); it != rejected.end();) {
+      it = now < it->second ? std::next(it) : rejected.erase(it);
+    }
+    rejected[key] = now + rejected_ttl;
+    throw;
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(flights_mutex);
+    in_flight.erase(key);
+    promise.set_exception(std::current_exception());
+    throw;
+  }
+}
 
+std::string GD_Client::send_request(const std::string &url,
+                                    const std::string &form) {
   std::string full_url = prefix + url;
 
-  auto res = client.get()->Post(full_url.c_str(), params);
+  auto &endpoint = get_metrics()->endpoint(url);
+  Request_Timing timing;
+
+  std::string body;
+  try {
+    body = mirrors->post(full_url, form, timing);
+  } catch (const std::exception &) {
+    endpoint.record(timing);
+    throw;
+  }
+
+  bool not_found = body == "-1" || body == "-2";
+  if (not_found) {
+    timing.outcome = Request_Outcome::rejected;
+  }
+  endpoint.record(timing);
 
-  auto body = res->body;
-  if (body == "-1") {
-    throw std::logic_error("post request failure");
+  if (not_found) {
+    throw Not_Found_Error("post request failure");
   }
 
   return body;
 }
 
+// profile fields that not every gdps sends
+int find_robtop_int(Robtop_Map &map, int key, int fallback) {
+  auto found = map.find(key);
+  if (found == map.end()) {
+    return fallback;
+  }
+  try {
+    return std::stoi(found->second, nullptr);
+  } catch (const std::exception &) {
+    return fallback;
+  }
+}
+
 bool GD_Client::get_user_info(int &accID, GDuser &user) {
-  Params params({{"targetAccountID", std::to_string(accID)}});
-  auto user_string = post_request(urls.get_user_info, params);
+  auto user_string = post_request(User_Info_Request{accID});
 
   try {
     auto user_map = to_robtop(user_string);
@@ -92,17 +186,24 @@ bool GD_Client::get_user_info(int &accID, GDuser &user) {
     user.name = user_map.at(1);
     user.ID = std::stoi(user_map.at(2), nullptr);
     user.accID = std::stoi(user_map.at(16), nullptr);
+    user.stars = find_robtop_int(user_map, 3, 0);
+    user.creator_points = find_robtop_int(user_map, 8, 0);
+
+    // 0 means unranked
+    auto rank = find_robtop_int(user_map, 30, 0);
+    if (rank > 0) {
+      user.rank = rank;
+    }
     return true;
-  } catch (const std::exception &e) {
-    // throw the exceptions that will actually have a message
-    throw e;
+  } catch (const std::exception &) {
+    // rethrown as is, so callers can still tell what went wrong
+    throw;
   }
   return false;
 }
 
 bool GD_Client::get_player_info(int &playerID, GDuser &user) {
-  Params params({{"str", std::to_string(playerID)}});
-  auto player_string = post_request(urls.get_users, params);
+  auto player_string = post_request(Users_Request{playerID});
 
   try {
     auto user_map = to_robtop(player_string);
@@ -110,24 +211,25 @@ bool GD_Client::get_player_info(int &playerID, GDuser &user) {
     user.name = user_map.at(1);
     user.ID = std::stoi(user_map.at(2), nullptr);
     user.accID = std::stoi(user_map.at(16), nullptr);
+    user.stars = find_robtop_int(user_map, 3, 0);
+    user.creator_points = find_robtop_int(user_map, 8, 0);
     return true;
-  } catch (const std::exception &e) {
-    throw e;
+  } catch (const std::exception &) {
+    throw;
   }
   return false;
 }
 
 bool GD_Client::get_user_rank(GDuser &user) {
-  Params params(
-      {{"type", "relative"}, {"accountID", std::to_string(user.accID)}});
-  auto leaderboardString = post_request(urls.get_scores, params);
+  auto leaderboardString =
+      post_request(Scores_Request{"relative", user.accID});
 
   auto leaderboard_list = explode(leaderboardString, '|');
 
   bool found_user = false;
   Robtop_Map seglist;
 
-  if (leaderboard_list.size() >= 24) {
+  if (leaderboard_list.size() > 24) {
     seglist = to_robtop(leaderboard_list.at(24));
     found_user = (std::stoi(seglist.at(16), nullptr) == user.accID);
   }
@@ -152,44 +254,177 @@ bool GD_Client::get_user_rank(GDuser &user) {
   }
 
   user.rank = std::stoi(seglist.at(6), nullptr);
+
+  // the record is a full player entry, good enough for the presence
+  user.name = seglist.at(1);
+  user.ID = find_robtop_int(seglist, 2, user.ID);
+  user.stars = find_robtop_int(seglist, 3, user.stars);
+  return true;
+}
+
+void GD_Client::get_ranked_user(int accID, GDuser &user) {
+  // shared with the request threads, the slower one finishes on its own
+  struct Lookup {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::optional<GDuser> info;
+    std::optional<GDuser> leaderboard;
+    int running = 2;
+    std::string error;
+  };
+
+  auto lookup = std::make_shared<Lookup>();
+  auto self = shared_from_this();
+
+  auto run = [this, lookup](std::optional<GDuser> Lookup::*result,
+                            std::function<void(GDuser &)> request) {
+    auto body = [lookup, result, request](Stop_Token) {
+      GDuser found;
+      std::string error;
+      try {
+        request(found);
+      } catch (const std::exception &e) {
+        error = e.what();
+      }
+
+      std::lock_guard<std::mutex> lock(lookup->mutex);
+      if (error.empty()) {
+        (*lookup).*result = found;
+      } else {
+        lookup->error = error;
+      }
+      lookup->running--;
+      lookup->cv.notify_all();
+    };
+
+    try {
+      lookups.start(body);
+    } catch (const std::exception &e) {
+      // shutting down, count it as failed so the wait below still ends
+      std::lock_guard<std::mutex> lock(lookup->mutex);
+      lookup->error = e.what();
+      lookup->running--;
+    }
+  };
+
+  run(&Lookup::info, [self, accID](GDuser &found) {
+    auto id = accID;
+    self->get_user_info(id, found);
+  });
+  // the scores request only needs the account id
+  run(&Lookup::leaderboard, [self, accID](GDuser &found) {
+    found.accID = accID;
+    self->get_user_rank(found);
+  });
+
+  std::unique_lock<std::mutex> lock(lookup->mutex);
+  auto is_ranked = [](const std::optional<GDuser> &found) {
+    return found && found->rank != -1;
+  };
+  lookup->cv.wait(lock, [&]() {
+    return lookup->running == 0 || is_ranked(lookup->info) ||
+           is_ranked(lookup->leaderboard);
+  });
+
+  if (is_ranked(lookup->leaderboard)) {
+    user = *lookup->leaderboard;
+    if (lookup->info) {
+      // only the profile has these
+      user.creator_points = lookup->info->creator_points;
+    }
+  } else if (lookup->info) {
+    user = *lookup->info;
+  } else {
+    throw std::runtime_error(lookup->error);
+  }
+}
+
+bool GD_Client::get_song_info(int songID, GDsong &song) {
+  auto song_string = post_request(Song_Info_Request{songID});
+
+  auto song_map = to_robtop(song_string, "~|~");
+
+  song.ID = std::stoi(song_map.at(1), nullptr);
+  song.name = song_map.at(2);
+  song.artist = song_map.at(4);
   return true;
 }
 
 void GD_Client::set_urls(GDUrls new_urls) { urls = new_urls; }
 
+void GD_Client::stop() {
+  // the lookups are waiting on the mirrors, so those go first
+  mirrors->stop(STOP_TIMEOUT);
+  lookups.stop_all(STOP_TIMEOUT);
+}
+
 bool parseGJGameLevel(GJGameLevel *in_memory, GDlevel &level) {
-  auto newID = in_memory->levelID;
   auto levelLocation = in_memory->levelType;
+  // robtop's levels keep everything about the author empty
+  bool official = levelLocation == 1;
 
-  // don't calculate more than we have to, but the editor keeps id 0
-  if (newID == level.levelID && levelLocation != GJLevelType::Editor) {
-    return true;
+  if (level.mark(Level_Field::id, fingerprint(in_memory->levelID))) {
+    level.levelID = in_memory->levelID;
   }
 
-  level.levelID = newID;
-  level.stars = in_memory->stars;
-
-  level.name = in_memory->levelName;
-
-  // good robtop security
-  level.isDemon = static_cast<bool>(in_memory->demon);
-  level.isAuto = in_memory->autoLevel;
-
-  if (levelLocation == 1) {
-    level.author = "RobTop"; // author is "" on these
-    level.difficulty = static_cast<Difficulty>(in_memory->difficulty);
+  // the editor keeps id 0, so names have to be checked by what's in them
+  if (level.mark(Level_Field::name, fingerprint_text(in_memory->levelName))) {
+    level.name = in_memory->levelName;
+    normalize_text(level.name);
+  }
 
-    if (level.difficulty == Difficulty::Demon) {
-      level.demonDifficulty = Demon_Difficulty::Easy;
+  if (level.mark(Level_Field::author,
+                 fingerprint_text(in_memory->userName,
+                                  fingerprint(official, in_memory->userID,
+                                              in_memory->accountID)))) {
+    if (official) {
+      level.author = "RobTop"; // author is "" on these
+      level.authorID = -1;
+      level.authorAccountID = -1;
+    } else {
+      level.author = in_memory->userName;
+      normalize_text(level.author);
+      level.authorID = in_memory->userID;
+      level.authorAccountID = in_memory->accountID;
     }
-  } else {
-    level.author = in_memory->userName;
-    level.difficulty = static_cast<Difficulty>(in_memory->ratingsSum / 10);
+  }
 
-    if (level.isDemon) {
-      level.demonDifficulty = getDemonDiffValue(in_memory->demonDifficulty);
+  if (level.mark(Level_Field::rating,
+                 fingerprint(official, in_memory->stars, in_memory->demon,
+                             in_memory->autoLevel, in_memory->difficulty,
+                             in_memory->ratingsSum,
+                             in_memory->demonDifficulty))) {
+    level.stars = in_memory->stars;
+
+    // good robtop security
+    level.isDemon = static_cast<bool>(in_memory->demon);
+    level.isAuto = in_memory->autoLevel;
+    level.demonDifficulty = Demon_Difficulty::None;
+
+    if (official) {
+      level.difficulty = static_cast<Difficulty>(in_memory->difficulty);
+
+      if (level.difficulty == Difficulty::Demon) {
+        level.demonDifficulty = Demon_Difficulty::Easy;
+      }
+    } else {
+      level.difficulty = static_cast<Difficulty>(in_memory->ratingsSum / 10);
+
+      if (level.isDemon) {
+        level.demonDifficulty = getDemonDiffValue(in_memory->demonDifficulty);
+      }
     }
   }
+
+  // read straight from memory when formatting, only tracked here
+  level.mark(Level_Field::progress,
+             fingerprint(in_memory->normalPercent, in_memory->attempts,
+                         in_memory->jumps, in_memory->clicks));
+  level.mark(Level_Field::objects, fingerprint(in_memory->objectCount));
+
+  // the names come from the song cache, which marks the field itself
+  level.audioTrack = in_memory->audioTrack;
+  level.songID = in_memory->songID;
   return true;
 }
 
@@ -212,6 +447,20 @@ Robtop_Map to_robtop(std::string &string, char delimiter) {
   return robtop;
 }
 
+Robtop_Map to_robtop(std::string &string, const std::string &delimiter) {
+  Robtop_Map robtop;
+
+  auto split_string = explode(string, delimiter);
+
+  // trailing values without a key are ignored
+  for (size_t i = 0; i + 1 < split_string.size(); i += 2) {
+    robtop.emplace(std::stoi(split_string.at(i), nullptr),
+                   split_string.at(i + 1));
+  }
+
+  return robtop;
+}
+
 // helper function
 std::vector<std::string> explode(std::string &string, char separator) {
   std::stringstream segmentstream(string);
@@ -222,5 +471,21 @@ std::vector<std::string> explode(std::string &string, char separator) {
     splitlist.push_back(segmented);
   }
 
+  return splitlist;
+}
+
+std::vector<std::string> explode(std::string &string,
+                                 const std::string &separator) {
+  std::vector<std::string> splitlist;
+
+  size_t start = 0;
+  size_t found = string.find(separator);
+  while (found != std::string::npos) {
+    splitlist.push_back(string.substr(start, found - start));
+    start = found + separator.size();
+    found = string.find(separator, start);
+  }
+  splitlist.push_back(string.substr(start));
+
   return splitlist;
 }
\ No newline at end of file
@@ -1,12 +1,22 @@
 #pragma once
 #ifndef GDAPI_H
 #define GDAPI_H
+#include "form_body.hpp"
 #include "gjgamelevel.hpp"
+#include "level_decoder.hpp"
+#include "mirror_pool.hpp"
+#include "worker_thread.hpp"
 
 #include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
 #include <exception>
+#include <future>
 #include <httplib.h>
 #include <map>
+#include <mutex>
 #include <sstream>
 #include <stdexcept>
 #include <string>
@@ -25,72 +35,250 @@ enum class Difficulty {
 
 enum class Demon_Difficulty { None, Easy, Medium, Hard, Insane, Extreme };
 
+// the server answered -1 or -2, it has nothing for that request
+// anything else going wrong (network, a garbled response) is worth retrying
+class Not_Found_Error : public std::runtime_error {
+public:
+  using std::runtime_error::runtime_error;
+};
+
 // thinking about this a bit later
 // probably shouldn't have used structs lol
 
+struct GDsong {
+  int ID = -1;
+  std::string name = "-";
+  std::string artist = "-";
+};
+
+struct GDuser {
+  int ID = -1;
+  int accID = -1;
+  std::string name;
+  int rank = -1;
+  int stars = 0;
+  int creator_points = 0;
+};
+
+// the parts of a level that placeholders read, each tracked on its own so
+// only templates showing something that changed are formatted again
+enum class Level_Field {
+  id,
+  name,
+  author,
+  rating, // stars, difficulty, demon and auto
+  song,
+  progress, // best, attempts, jumps and clicks
+  objects,
+  stats,   // decoded from the level string
+  profile, // the author's stars, creator points and rank
+  history, // sessions and total time
+  count
+};
+
+constexpr uint32_t level_field_bit(Level_Field field) {
+  return 1u << static_cast<int>(field);
+}
+
+constexpr uint32_t ALL_LEVEL_FIELDS =
+    level_field_bit(Level_Field::count) - 1;
+
+// fnv1a a word at a time instead of a byte, these run on every update and
+// are only ever compared with each other
+// both steps can be undone, so changing a single word always changes it
+inline uint64_t fingerprint_mix(uint64_t hash, uint64_t word) {
+  return (hash ^ word) * 0x100000001b3ull;
+}
+
+// for GDlevel::mark, hashes a few numbers or a string
+template <typename... Values> uint64_t fingerprint(Values... values) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  ((hash = fingerprint_mix(hash, static_cast<int64_t>(values))), ...);
+  return hash;
+}
+
+inline uint64_t fingerprint_text(const std::string &text, uint64_t seed = 0) {
+  // the size goes in first so trailing zero bytes still count
+  auto hash = fingerprint_mix(seed ^ 0xcbf29ce484222325ull, text.size());
+
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= text.size(); i += sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, text.data() + i, sizeof(word));
+    hash = fingerprint_mix(hash, word);
+  }
+  if (i < text.size()) {
+    uint64_t word = 0;
+    std::memcpy(&word, text.data() + i, text.size() - i);
+    hash = fingerprint_mix(hash, word);
+  }
+  return hash;
+}
+
 struct GDlevel {
+  // level_field_bit of everything that changed since the last render
+  uint32_t dirty = ALL_LEVEL_FIELDS;
+  // what each field looked like the last time it was checked
+  std::array<uint64_t, static_cast<size_t>(Level_Field::count)> fingerprints{};
+
+  // marks field dirty if it doesn't match the last fingerprint
+  // returns whether it changed
+  bool mark(Level_Field field, uint64_t fingerprint) {
+    auto &seen = fingerprints.at(static_cast<size_t>(field));
+    if (seen == fingerprint && (dirty & level_field_bit(field)) == 0) {
+      return false;
+    }
+    seen = fingerprint;
+    dirty |= level_field_bit(field);
+    return true;
+  }
+
   int levelID = -1;
   std::string name;
   std::string author = "-";
   int authorID = -1;
+  int authorAccountID = -1;
   int stars = 0;
   Difficulty difficulty = Difficulty::Na;
   Demon_Difficulty demonDifficulty = Demon_Difficulty::None;
   bool isAuto = false;
   bool isDemon = false;
+  int audioTrack = 0;
+  int songID = 0;
+  GDsong song;
+  Level_Stats stats;
+  GDuser author_info;
+  // earlier sessions from the local play history
+  int sessions = 0;
+  uint64_t time_played = 0;
 }; // this is a really barebones struct btw
 
-struct GDuser {
-  int ID = -1;
-  int accID = -1;
-  std::string name;
-  int rank = -1;
-};
-
 struct GDUrls {
   std::string get_user_info = "getGJUserInfo20.php";
   std::string get_users = "getGJUsers20.php";
   std::string get_scores = "getGJScores20.php";
+  std::string get_song_info = "getGJSongInfo.php";
+};
+
+// one per endpoint, each knows where it goes and writes its own fields
+struct User_Info_Request {
+  static constexpr std::string GDUrls::*endpoint = &GDUrls::get_user_info;
+  int target_account_id;
+
+  void write(Form_Body &body) const {
+    body.add("targetAccountID", target_account_id);
+  }
+};
+
+struct Users_Request {
+  static constexpr std::string GDUrls::*endpoint = &GDUrls::get_users;
+  int player_id;
+
+  void write(Form_Body &body) const { body.add("str", player_id); }
+};
+
+struct Scores_Request {
+  static constexpr std::string GDUrls::*endpoint = &GDUrls::get_scores;
+  const char *type;
+  int account_id;
+
+  void write(Form_Body &body) const {
+    body.add("type", type).add("accountID", account_id);
+  }
+};
+
+struct Song_Info_Request {
+  static constexpr std::string GDUrls::*endpoint = &GDUrls::get_song_info;
+  int song_id;
+
+  void write(Form_Body &body) const { body.add("songID", song_id); }
 };
 
 Demon_Difficulty getDemonDiffValue(int diff);
 std::string getDifficultyName(GDlevel &level);
 
-typedef std::multimap<std::string, std::string> Params;
 typedef std::unordered_map<int, std::string> Robtop_Map;
 
-class GD_Client {
+class GD_Client : public std::enable_shared_from_this<GD_Client> {
 private:
-  std::string host;
   std::string prefix;
 
   const int game_version;
   const std::string secret;
 
+  // gameVersion and secret, encoded once and put in front of every body
+  std::string common_fields;
+
   GDUrls urls;
 
-  std::shared_ptr<httplib::Client> client;
+  std::shared_ptr<Mirror_Pool> mirrors;
+
+  // the two halves of get_ranked_user
+  Worker_Group lookups;
+
+  // how long stop waits for requests that are still out
+  static constexpr std::chrono::milliseconds STOP_TIMEOUT{250};
+
+  // identical requests made while one is already running wait on it
+  // instead of going out again, keyed by url and params
+  std::mutex flights_mutex;
+  std::unordered_map<std::string, std::shared_future<std::string>> in_flight;
+
+  // requests the server answered -1 to, they're not retried for a while
+  static constexpr std::chrono::seconds REJECTED_TTL{30};
+  const std::chrono::milliseconds rejected_ttl;
+  std::unordered_map<std::string, std::chrono::steady_clock::time_point>
+      rejected;
 
   // makes an internet post request to boomlings.com
-  std::string post_request(std::string, Params &);
+  template <typename Request> std::string post_request(const Request &request) {
+    // reused by every request made on this thread
+    thread_local Form_Body body;
+    body.reset(common_fields);
+    request.write(body);
+
+    return post_request(urls.*Request::endpoint, body.str());
+  }
+
+  std::string post_request(const std::string &url, const std::string &body);
+  std::string send_request(const std::string &url, const std::string &body);
 
 public:
-  GD_Client(std::string host = "http://silverragdps.mathieuar.fr",
-            std::string prefix = "/");
+  // rejected_ttl is only shortened by the tests
+  GD_Client(std::vector<std::string> hosts = {"http://silverragdps.mathieuar.fr"},
+            std::string prefix = "/",
+            std::chrono::milliseconds rejected_ttl = REJECTED_TTL);
 
   bool get_user_info(int &accID, GDuser &user);
   bool get_player_info(int &playerID, GDuser &user);
 
   bool get_user_rank(GDuser &user);
 
+  // asks for the profile and the leaderboard at the same time, returning
+  // as soon as one of them has both the name and the rank
+  // the rank is -1 if neither had it, throws if both requests failed
+  void get_ranked_user(int accID, GDuser &user);
+
+  bool get_song_info(int songID, GDsong &song);
+
   void set_urls(GDUrls);
+
+  // cancels the requests still running, so nothing touches the client once
+  // the dll is gone. every request after this throws
+  void stop();
 };
 
 Robtop_Map to_robtop(std::string &, char delimiter = ':');
+// song info uses ~|~ instead of a single character
+Robtop_Map to_robtop(std::string &, const std::string &delimiter);
 
 // splits a string by substring, much like in other languages
 std::vector<std::string> explode(std::string &string, char separator);
+std::vector<std::string> explode(std::string &string,
+                                 const std::string &separator);
 
+// cheap enough to run on every update, fields are only copied over (and
+// marked dirty) when their fingerprint changes
 bool parseGJGameLevel(GJGameLevel *in_memory, GDlevel &level);
 
 #endif // !GDAPI_H
\ No newline at end of file
@@ -0,0 +1,140 @@
+#include "hook_registry.hpp"
+
+#include <iterator>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+namespace {
+const char *status_name(Hook_Status status) {
+  switch (status) {
+  case Hook_Status::skipped:
+    return "skipped";
+  case Hook_Status::missing:
+    return "missing";
+  case Hook_Status::failed:
+    return "failed";
+  case Hook_Status::installed:
+    return "installed";
+  case Hook_Status::rolled_back:
+    return "rolled back";
+  }
+  return "unknown";
+}
+} // namespace
+
+void Hook_Registry::add(Hook_Definition definition) {
+  definitions.push_back(std::move(definition));
+}
+
+void Hook_Registry::roll_back() {
+  for (auto &record : records) {
+    if (record.status == Hook_Status::installed) {
+      MH_RemoveHook(record.target);
+      record.status = Hook_Status::rolled_back;
+    }
+  }
+}
+
+void Hook_Registry::install(std::shared_ptr<spdlog::logger> logger) {
+  typedef std::chrono::steady_clock clock;
+
+  records.clear();
+  records.reserve(definitions.size());
+
+  std::string required_error;
+
+  for (const auto &definition : definitions) {
+    auto start = clock::now();
+
+    Hook_Record record;
+    record.name = definition.name;
+
+    if (definition.wanted && !definition.wanted()) {
+      records.push_back(record);
+      continue;
+    }
+
+    record.target = definition.target();
+    if (!record.target) {
+      record.status = Hook_Status::missing;
+    } else if (auto status = MH_CreateHook(record.target, definition.detour,
+                                           definition.original);
+               status != MH_OK) {
+      record.status = Hook_Status::failed;
+      record.error = status;
+    } else if (auto status = MH_QueueEnableHook(record.target);
+               status != MH_OK) {
+      MH_RemoveHook(record.target);
+      record.status = Hook_Status::failed;
+      record.error = status;
+    } else {
+      // only really installed once the queue is applied
+      record.status = Hook_Status::installed;
+    }
+
+    record.setup_time = std::chrono::duration_cast<std::chrono::microseconds>(
+        clock::now() - start);
+
+    if (record.status != Hook_Status::installed) {
+      auto reason = record.status == Hook_Status::missing
+                        ? "not found"
+                        : MH_StatusToString(record.error);
+      if (!definition.optional) {
+        required_error =
+            fmt::format("could not hook {} ({})", definition.name, reason);
+      } else if (logger) {
+        logger->warn("optional hook {} is unavailable ({})", definition.name,
+                     reason);
+      }
+    }
+
+    records.push_back(record);
+
+    if (!required_error.empty()) {
+      break;
+    }
+  }
+
+  if (!required_error.empty()) {
+    roll_back();
+    throw std::runtime_error(required_error);
+  }
+
+  auto start = clock::now();
+  auto status = MH_ApplyQueued();
+  apply_time = std::chrono::duration_cast<std::chrono::microseconds>(
+      clock::now() - start);
+
+  if (status != MH_OK) {
+    roll_back();
+    throw std::runtime_error(fmt::format("enabling hooks failed ({})",
+                                         MH_StatusToString(status)));
+  }
+}
+
+const std::vector<Hook_Record> &Hook_Registry::get_records() const {
+  return records;
+}
+
+std::string Hook_Registry::report() const {
+  std::string out;
+  std::chrono::microseconds total = apply_time;
+
+  for (const auto &record : records) {
+    total += record.setup_time;
+    fmt::format_to(std::back_inserter(out), "  {:<32} {:<11} {:>6}us",
+                   record.name, status_name(record.status),
+                   record.setup_time.count());
+    if (record.status == Hook_Status::failed) {
+      fmt::format_to(std::back_inserter(out), " ({})",
+                     MH_StatusToString(record.error));
+    }
+    out.push_back('\n');
+  }
+
+  fmt::format_to(std::back_inserter(out),
+                 "  enabled together in {}us, {}us total", apply_time.count(),
+                 total.count());
+  return out;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#ifndef HOOK_REGISTRY_HPP
+#define HOOK_REGISTRY_HPP
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <MinHook.h>
+#include <spdlog/spdlog.h>
+
+struct Hook_Definition {
+  std::string name;
+  // the function to hook, nullptr if it can't be found in this build
+  std::function<void *()> target;
+  void *detour;
+  void **original;
+
+  // if an optional hook can't be installed the others still are
+  bool optional = false;
+  // checked at install, for hooks only some config features need
+  // nullptr means always wanted
+  std::function<bool()> wanted = nullptr;
+};
+
+enum class Hook_Status {
+  // not wanted by the config
+  skipped,
+  // no target in this build
+  missing,
+  failed,
+  installed,
+  // was created, but removed again since a required hook failed
+  rolled_back,
+};
+
+struct Hook_Record {
+  std::string name;
+  void *target = nullptr;
+  Hook_Status status = Hook_Status::skipped;
+  MH_STATUS error = MH_OK;
+  // resolving, creating and queueing the hook
+  std::chrono::microseconds setup_time{0};
+};
+
+// collects every hook and installs them together
+// minhook suspends the game's threads whenever hooks are enabled, so they
+// are queued and enabled with a single MH_ApplyQueued
+class Hook_Registry {
+private:
+  std::vector<Hook_Definition> definitions;
+  std::vector<Hook_Record> records;
+
+  // time spent in MH_ApplyQueued
+  std::chrono::microseconds apply_time{0};
+
+  // removes every hook created so far
+  void roll_back();
+
+public:
+  void add(Hook_Definition definition);
+
+  // MH_Initialize must have been called already
+  // throws std::runtime_error if a required hook couldn't be installed, in
+  // which case none of them are left installed
+  void install(std::shared_ptr<spdlog::logger> logger);
+
+  const std::vector<Hook_Record> &get_records() const;
+
+  // one line per hook with its status and timing
+  std::string report() const;
+};
+
+#endif
@@ -0,0 +1,355 @@
+#include "inflate_stream.hpp"
+
+// tables from rfc 1951
+constexpr std::array<uint16_t, 29> LENGTH_BASE{
+    3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+    31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+constexpr std::array<uint8_t, 29> LENGTH_EXTRA{0, 0, 0, 0, 0, 0, 0, 0, 1, 1,
+                                               1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+                                               4, 4, 4, 4, 5, 5, 5, 5, 0};
+constexpr std::array<uint16_t, 30> DISTANCE_BASE{
+    1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+    33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+    1025, 1537, 2049, 3073, 4097, 6145,  8193,  12289, 16385, 24577};
+constexpr std::array<uint8_t, 30> DISTANCE_EXTRA{
+    0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+    6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+constexpr std::array<uint8_t, 19> CODE_LENGTH_ORDER{
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+Inflate_Stream::Inflate_Stream(const uint8_t *data, size_t size, Sink sink)
+    : data(data), size(size), position(0), bit_buffer(0), bit_count(0),
+      window{}, window_position(0), produced(0), sink(sink) {}
+
+void Inflate_Stream::refill() {
+  while (bit_count <= 24 && position < size) {
+    bit_buffer |= static_cast<uint32_t>(data[position++]) << bit_count;
+    bit_count += 8;
+  }
+}
+
+uint32_t Inflate_Stream::bits(int count) {
+  while (bit_count < count) {
+    if (position >= size) {
+      throw std::runtime_error("deflate stream ended early");
+    }
+    bit_buffer |= static_cast<uint32_t>(data[position++]) << bit_count;
+    bit_count += 8;
+  }
+
+  auto value = bit_buffer & ((1u << count) - 1);
+  bit_buffer >>= count;
+  bit_count -= count;
+  return value;
+}
+
+void Inflate_Stream::skip_header() {
+  if (size >= 10 && data[0] == 0x1F && data[1] == 0x8B) {
+    // gzip, see rfc 1952
+    auto flags = data[3];
+    position = 10;
+
+    if (flags & 0x04) {
+      if (position + 2 > size) {
+        throw std::runtime_error("truncated gzip header");
+      }
+      position += 2 + (data[position] | (data[position + 1] << 8));
+    }
+
+    // name and comment are both null terminated
+    for (auto flag : {0x08, 0x10}) {
+      if (flags & flag) {
+        while (position < size && data[position] != 0) {
+          position++;
+        }
+        position++;
+      }
+    }
+
+    if (flags & 0x02) {
+      position += 2;
+    }
+
+    if (position > size) {
+      throw std::runtime_error("truncated gzip header");
+    }
+  } else if (size >= 2 && (data[0] & 0x0F) == 8 &&
+             ((data[0] << 8) | data[1]) % 31 == 0) {
+    // zlib, some older levels are stored like this
+    if (data[1] & 0x20) {
+      throw std::runtime_error("zlib dictionaries are not supported");
+    }
+    position = 2;
+  }
+}
+
+void Inflate_Stream::put(char byte) {
+  produced++;
+  window[window_position++] = byte;
+  if (window_position == WINDOW_SIZE) {
+    flush();
+    window_position = 0;
+  }
+}
+
+void Inflate_Stream::flush() {
+  if (window_position != 0) {
+    sink(window.data(), window_position);
+  }
+}
+
+void Inflate_Stream::build(Huffman &huffman, const uint8_t *lengths,
+                           size_t count) {
+  huffman.counts.fill(0);
+  for (size_t i = 0; i < count; i++) {
+    huffman.counts[lengths[i]]++;
+  }
+  huffman.counts[0] = 0;
+
+  std::array<uint16_t, 16> offsets{};
+  for (size_t i = 1; i < 15; i++) {
+    offsets[i + 1] = offsets[i] + huffman.counts[i];
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    if (lengths[i] != 0) {
+      huffman.symbols[offsets[lengths[i]]++] = static_cast<uint16_t>(i);
+    }
+  }
+
+  // canonical codes are handed out in symbol order within each length
+  // deflate sends them most significant bit first, so the index is reversed
+  huffman.fast.fill(0);
+  uint32_t code = 0;
+  size_t index = 0;
+  for (int length = 1; length <= FAST_BITS; length++) {
+    for (int i = 0; i < huffman.counts[length]; i++, index++, code++) {
+      if (code >= (1u << length)) {
+        // over-subscribed, the slow walk reports it
+        return;
+      }
+
+      uint32_t reversed = 0;
+      for (int bit = 0; bit < length; bit++) {
+        reversed |= ((code >> bit) & 1) << (length - 1 - bit);
+      }
+
+      auto entry = static_cast<uint16_t>((length << 9) | huffman.symbols[index]);
+      for (auto fill = reversed; fill < huffman.fast.size(); fill += 1u << length) {
+        huffman.fast[fill] = entry;
+      }
+    }
+    code <<= 1;
+  }
+}
+
+int Inflate_Stream::decode(const Huffman &huffman) {
+  refill();
+
+  // near the end of the data there may be fewer bits than FAST_BITS, the
+  // missing ones read as 0 so the entry only counts if it fits
+  auto entry = huffman.fast[bit_buffer & ((1u << FAST_BITS) - 1)];
+  auto fast_length = entry >> 9;
+  if (entry != 0 && fast_length <= bit_count) {
+    bit_buffer >>= fast_length;
+    bit_count -= fast_length;
+    return entry & 0x1FF;
+  }
+
+  // longer codes, walk one bit at a time (see zlib's puff.c)
+  int code = 0;
+  int first = 0;
+  int index = 0;
+
+  for (size_t length = 1; length < 16; length++) {
+    code |= bits(1);
+    int count = huffman.counts[length];
+    if (code - count < first) {
+      return huffman.symbols[index + (code - first)];
+    }
+    index += count;
+    first += count;
+    first <<= 1;
+    code <<= 1;
+  }
+
+  throw std::runtime_error("invalid huffman code");
+}
+
+void Inflate_Stream::stored_block() {
+  // whole bytes may already be in the bit buffer, give them back and drop
+  // what's left of the current one
+  position -= bit_count / 8;
+  bit_buffer = 0;
+  bit_count = 0;
+
+  if (position + 4 > size) {
+    throw std::runtime_error("truncated stored block");
+  }
+
+  auto length = data[position] | (data[position + 1] << 8);
+  auto inverse = data[position + 2] | (data[position + 3] << 8);
+  position += 4;
+
+  if (length != (~inverse & 0xFFFF) || position + length > size) {
+    throw std::runtime_error("invalid stored block");
+  }
+
+  for (int i = 0; i < length; i++) {
+    put(static_cast<char>(data[position++]));
+  }
+}
+
+void Inflate_Stream::fixed_block() {
+  static const auto tables = []() {
+    std::array<uint8_t, 288 + 30> lengths{};
+    std::fill(lengths.begin(), lengths.begin() + 144, 8);
+    std::fill(lengths.begin() + 144, lengths.begin() + 256, 9);
+    std::fill(lengths.begin() + 256, lengths.begin() + 280, 7);
+    std::fill(lengths.begin() + 280, lengths.begin() + 288, 8);
+    std::fill(lengths.begin() + 288, lengths.end(), 5);
+
+    std::array<Huffman, 2> huffman;
+    build(huffman[0], lengths.data(), 288);
+    build(huffman[1], lengths.data() + 288, 30);
+    return huffman;
+  }();
+
+  codes(tables[0], tables[1]);
+}
+
+void Inflate_Stream::dynamic_block() {
+  auto literal_count = bits(5) + 257;
+  auto distance_count = bits(5) + 1;
+  auto code_count = bits(4) + 4;
+
+  if (literal_count > 286 || distance_count > 30) {
+    throw std::runtime_error("invalid dynamic block counts");
+  }
+
+  std::array<uint8_t, 288 + 30> lengths{};
+  for (size_t i = 0; i < code_count; i++) {
+    lengths[CODE_LENGTH_ORDER[i]] = static_cast<uint8_t>(bits(3));
+  }
+
+  Huffman code_lengths;
+  build(code_lengths, lengths.data(), 19);
+  lengths.fill(0);
+
+  size_t index = 0;
+  while (index < literal_count + distance_count) {
+    auto symbol = decode(code_lengths);
+    if (symbol < 16) {
+      lengths[index++] = static_cast<uint8_t>(symbol);
+      continue;
+    }
+
+    uint8_t repeated = 0;
+    uint32_t repeat;
+    if (symbol == 16) {
+      if (index == 0) {
+        throw std::runtime_error("repeat with no previous length");
+      }
+      repeated = lengths[index - 1];
+      repeat = 3 + bits(2);
+    } else if (symbol == 17) {
+      repeat = 3 + bits(3);
+    } else {
+      repeat = 11 + bits(7);
+    }
+
+    if (index + repeat > literal_count + distance_count) {
+      throw std::runtime_error("too many code lengths");
+    }
+    while (repeat--) {
+      lengths[index++] = repeated;
+    }
+  }
+
+  if (lengths[256] == 0) {
+    throw std::runtime_error("missing end of block code");
+  }
+
+  Huffman literals, distances;
+  build(literals, lengths.data(), literal_count);
+  build(distances, lengths.data() + literal_count, distance_count);
+
+  codes(literals, distances);
+}
+
+void Inflate_Stream::codes(const Huffman &literals,
+                           const Huffman &distances) {
+  while (true) {
+    auto symbol = decode(literals);
+    if (symbol < 256) {
+      put(static_cast<char>(symbol));
+      continue;
+    }
+
+    if (symbol == 256) {
+      return;
+    }
+
+    symbol -= 257;
+    if (symbol >= 29) {
+      throw std::runtime_error("invalid length symbol");
+    }
+    auto length = LENGTH_BASE[symbol] + bits(LENGTH_EXTRA[symbol]);
+
+    auto distance_symbol = decode(distances);
+    if (distance_symbol >= 30) {
+      throw std::runtime_error("invalid distance symbol");
+    }
+    auto distance = DISTANCE_BASE[distance_symbol] +
+                    bits(DISTANCE_EXTRA[distance_symbol]);
+
+    // a bad stream could otherwise copy bytes that were never written
+    if (distance > produced) {
+      throw std::runtime_error("distance goes back past the start");
+    }
+
+    // the window is a ring, so anything within 32kb is still around
+    auto from = (window_position + WINDOW_SIZE - distance) % WINDOW_SIZE;
+    if (from < window_position && window_position + length < WINDOW_SIZE) {
+      // neither end wraps, the usual case, copied forwards a byte at a time
+      // since the source may overlap what's being written
+      auto out = window.data() + window_position;
+      auto in = window.data() + from;
+      for (size_t i = 0; i < length; i++) {
+        out[i] = in[i];
+      }
+      window_position += length;
+      produced += length;
+      continue;
+    }
+
+    while (length--) {
+      put(window[from]);
+      from = (from + 1) % WINDOW_SIZE;
+    }
+  }
+}
+
+void Inflate_Stream::run() {
+  skip_header();
+
+  bool last_block = false;
+  while (!last_block) {
+    last_block = bits(1);
+    switch (bits(2)) {
+    case 0:
+      stored_block();
+      break;
+    case 1:
+      fixed_block();
+      break;
+    case 2:
+      dynamic_block();
+      break;
+    default:
+      throw std::runtime_error("invalid block type");
+    }
+  }
+
+  flush();
+}
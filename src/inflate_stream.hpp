@@ -0,0 +1,69 @@
+#pragma once
+#ifndef INFLATE_STREAM_HPP
+#define INFLATE_STREAM_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+
+// small deflate decoder that never holds more than the 32kb window of output
+// the whole decompressed level never needs to exist in memory this way
+class Inflate_Stream {
+public:
+  using Sink = std::function<void(const char *, size_t)>;
+
+private:
+  // codes up to this long are decoded with a single table lookup
+  static constexpr int FAST_BITS = 9;
+
+  struct Huffman {
+    std::array<uint16_t, 16> counts;
+    std::array<uint16_t, 288> symbols;
+    // indexed by the next FAST_BITS bits of input, length << 9 | symbol
+    // 0 for codes that are longer, those take the bit at a time walk
+    std::array<uint16_t, 1 << FAST_BITS> fast;
+  };
+
+  static constexpr size_t WINDOW_SIZE = 32768;
+
+  const uint8_t *data;
+  size_t size;
+  size_t position;
+
+  uint32_t bit_buffer;
+  int bit_count;
+
+  std::array<char, WINDOW_SIZE> window;
+  size_t window_position;
+  // everything written so far, back references can't reach before it
+  uint64_t produced;
+
+  Sink sink;
+
+  uint32_t bits(int count);
+  // tops up bit_buffer without throwing at the end of the data
+  void refill();
+  void skip_header();
+
+  void put(char byte);
+  void flush();
+
+  static void build(Huffman &huffman, const uint8_t *lengths, size_t count);
+  int decode(const Huffman &huffman);
+
+  void stored_block();
+  void fixed_block();
+  void dynamic_block();
+  void codes(const Huffman &lengths, const Huffman &distances);
+
+public:
+  Inflate_Stream(const uint8_t *data, size_t size, Sink sink);
+
+  // accepts gzip, zlib or raw deflate data
+  // throws std::runtime_error if the data is malformed
+  void run();
+};
+
+#endif
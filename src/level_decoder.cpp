@@ -0,0 +1,503 @@
+#include "level_decoder.hpp"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define LEVEL_DECODER_SSE2
+#endif
+
+enum class Object_Kind : uint8_t {
+  other,
+  trigger,
+  decoration,
+  hazard,
+  speed_portal
+};
+
+struct Object_Range {
+  int first;
+  int last;
+  Object_Kind kind;
+};
+
+// approximate groupings by id, not every object in the game
+// anything missing just ends up as Object_Kind::other
+constexpr Object_Range OBJECT_RANGES[] = {
+    // triggers
+    {22, 30, Object_Kind::trigger},
+    {32, 33, Object_Kind::trigger},
+    {55, 59, Object_Kind::trigger},
+    {104, 105, Object_Kind::trigger},
+    {221, 221, Object_Kind::trigger},
+    {717, 718, Object_Kind::trigger},
+    {743, 744, Object_Kind::trigger},
+    {899, 901, Object_Kind::trigger},
+    {915, 915, Object_Kind::trigger},
+    {1006, 1007, Object_Kind::trigger},
+    {1049, 1049, Object_Kind::trigger},
+    {1268, 1268, Object_Kind::trigger},
+    {1346, 1347, Object_Kind::trigger},
+    {1520, 1520, Object_Kind::trigger},
+    {1585, 1585, Object_Kind::trigger},
+    {1595, 1595, Object_Kind::trigger},
+    {1611, 1613, Object_Kind::trigger},
+    {1616, 1616, Object_Kind::trigger},
+    {1811, 1812, Object_Kind::trigger},
+    {1814, 1815, Object_Kind::trigger},
+    {1817, 1819, Object_Kind::trigger},
+    {1912, 1912, Object_Kind::trigger},
+
+    // spikes and saws
+    {8, 9, Object_Kind::hazard},
+    {39, 39, Object_Kind::hazard},
+    {61, 61, Object_Kind::hazard},
+    {88, 89, Object_Kind::hazard},
+    {98, 98, Object_Kind::hazard},
+    {103, 103, Object_Kind::hazard},
+    {135, 135, Object_Kind::hazard},
+    {243, 244, Object_Kind::hazard},
+    {363, 368, Object_Kind::hazard},
+    {392, 392, Object_Kind::hazard},
+    {397, 399, Object_Kind::hazard},
+    {421, 422, Object_Kind::hazard},
+    {446, 447, Object_Kind::hazard},
+    {667, 667, Object_Kind::hazard},
+    {678, 680, Object_Kind::hazard},
+    {720, 720, Object_Kind::hazard},
+    {740, 742, Object_Kind::hazard},
+    {989, 989, Object_Kind::hazard},
+    {991, 991, Object_Kind::hazard},
+    {1619, 1620, Object_Kind::hazard},
+    {1705, 1710, Object_Kind::hazard},
+    {1734, 1736, Object_Kind::hazard},
+
+    // speed portals, 1334 being the 4x one
+    {200, 203, Object_Kind::speed_portal},
+    {1334, 1334, Object_Kind::speed_portal},
+
+    // grass, chains, clouds, lights and the like
+    {18, 21, Object_Kind::decoration},
+    {48, 54, Object_Kind::decoration},
+    {106, 107, Object_Kind::decoration},
+    {113, 115, Object_Kind::decoration},
+    {129, 134, Object_Kind::decoration},
+    {136, 139, Object_Kind::decoration},
+    {148, 149, Object_Kind::decoration},
+    {151, 158, Object_Kind::decoration},
+    {180, 190, Object_Kind::decoration},
+    {233, 242, Object_Kind::decoration},
+    {405, 420, Object_Kind::decoration},
+    {448, 466, Object_Kind::decoration},
+    {503, 510, Object_Kind::decoration},
+    {580, 590, Object_Kind::decoration},
+    {725, 730, Object_Kind::decoration},
+    {916, 936, Object_Kind::decoration},
+    {1011, 1030, Object_Kind::decoration},
+    {1055, 1060, Object_Kind::decoration},
+    {1122, 1134, Object_Kind::decoration},
+    {1227, 1265, Object_Kind::decoration},
+    {1350, 1370, Object_Kind::decoration},
+    {1419, 1460, Object_Kind::decoration},
+    {1516, 1519, Object_Kind::decoration},
+    {1521, 1584, Object_Kind::decoration},
+    {1586, 1594, Object_Kind::decoration},
+    {1757, 1810, Object_Kind::decoration},
+    {1820, 1910, Object_Kind::decoration},
+};
+
+constexpr size_t MAX_OBJECT_ID = 2048;
+
+Object_Kind classify_object(int id) {
+  static const auto kinds = []() {
+    std::array<Object_Kind, MAX_OBJECT_ID> kinds{};
+    for (const auto &range : OBJECT_RANGES) {
+      for (int i = range.first; i <= range.last; i++) {
+        kinds[i] = range.kind;
+      }
+    }
+    return kinds;
+  }();
+
+  if (id < 0 || static_cast<size_t>(id) >= MAX_OBJECT_ID) {
+    return Object_Kind::other;
+  }
+  return kinds[id];
+}
+
+// units per second for each speed, in the order used by the kA4 header key
+constexpr std::array<double, 5> SPEED_VALUES{311.58, 251.16, 387.42, 468.0,
+                                             576.0};
+
+int portal_speed(int id) {
+  switch (id) {
+  case 200:
+    return 1;
+  case 202:
+    return 2;
+  case 203:
+    return 3;
+  case 1334:
+    return 4;
+  case 201:
+  default:
+    return 0;
+  }
+}
+
+int8_t base64_value(unsigned char c) {
+  static const auto values = []() {
+    std::array<int8_t, 256> values;
+    values.fill(-1);
+    for (int i = 0; i < 26; i++) {
+      values['A' + i] = static_cast<int8_t>(i);
+      values['a' + i] = static_cast<int8_t>(26 + i);
+    }
+    for (int i = 0; i < 10; i++) {
+      values['0' + i] = static_cast<int8_t>(52 + i);
+    }
+    // robtop uses the url safe alphabet, but accept both
+    values['-'] = values['+'] = 62;
+    values['_'] = values['/'] = 63;
+    return values;
+  }();
+
+  return values[c];
+}
+
+#ifdef LEVEL_DECODER_SSE2
+// converts 16 characters to their 6 bit values at once
+// returns false if anything in the block needs the scalar path
+bool translate_base64_block(const char *in, uint8_t *out) {
+  auto chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in));
+
+  auto in_range = [&chars](char first, char last) {
+    return _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8(first - 1)),
+                         _mm_cmplt_epi8(chars, _mm_set1_epi8(last + 1)));
+  };
+  auto equals = [&chars](char c) {
+    return _mm_cmpeq_epi8(chars, _mm_set1_epi8(c));
+  };
+
+  auto upper = in_range('A', 'Z');
+  auto lower = in_range('a', 'z');
+  auto digit = in_range('0', '9');
+  auto minus = equals('-');
+  auto plus = equals('+');
+  auto underscore = equals('_');
+  auto slash = equals('/');
+
+  auto valid = _mm_or_si128(
+      _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, minus)),
+      _mm_or_si128(_mm_or_si128(plus, underscore), slash));
+  if (_mm_movemask_epi8(valid) != 0xFFFF) {
+    return false;
+  }
+
+  // each class is a constant offset away from its value
+  auto offsets = _mm_or_si128(
+      _mm_or_si128(_mm_and_si128(upper, _mm_set1_epi8(-'A')),
+                   _mm_and_si128(lower, _mm_set1_epi8(26 - 'a'))),
+      _mm_or_si128(_mm_and_si128(digit, _mm_set1_epi8(52 - '0')),
+                   _mm_and_si128(minus, _mm_set1_epi8(62 - '-'))));
+  offsets = _mm_or_si128(
+      offsets,
+      _mm_or_si128(_mm_or_si128(_mm_and_si128(plus, _mm_set1_epi8(62 - '+')),
+                                _mm_and_si128(underscore,
+                                              _mm_set1_epi8(63 - '_'))),
+                   _mm_and_si128(slash, _mm_set1_epi8(63 - '/'))));
+
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(out),
+                   _mm_add_epi8(chars, offsets));
+  return true;
+}
+#endif
+
+size_t decode_base64(char *data, size_t size) {
+  auto out = reinterpret_cast<uint8_t *>(data);
+  size_t in_position = 0;
+  size_t out_position = 0;
+
+#ifdef LEVEL_DECODER_SSE2
+  // output is always behind input, so decoding in place is safe
+  std::array<uint8_t, 16> values;
+  while (in_position + 16 <= size &&
+         translate_base64_block(data + in_position, values.data())) {
+    for (size_t i = 0; i < 16; i += 4) {
+      out[out_position++] = static_cast<uint8_t>((values[i] << 2) |
+                                                 (values[i + 1] >> 4));
+      out[out_position++] = static_cast<uint8_t>((values[i + 1] << 4) |
+                                                 (values[i + 2] >> 2));
+      out[out_position++] =
+          static_cast<uint8_t>((values[i + 2] << 6) | values[i + 3]);
+    }
+    in_position += 16;
+  }
+#endif
+
+  uint32_t accumulator = 0;
+  int accumulated_bits = 0;
+  for (; in_position < size; in_position++) {
+    auto c = static_cast<unsigned char>(data[in_position]);
+    if (c == '=') {
+      break;
+    }
+
+    auto value = base64_value(c);
+    if (value < 0) {
+      throw std::runtime_error("invalid base64 character in level string");
+    }
+
+    accumulator = (accumulator << 6) | static_cast<uint32_t>(value);
+    accumulated_bits += 6;
+    if (accumulated_bits >= 8) {
+      accumulated_bits -= 8;
+      out[out_position++] =
+          static_cast<uint8_t>((accumulator >> accumulated_bits) & 0xFF);
+    }
+  }
+
+  return out_position;
+}
+
+Level_Scanner::Level_Scanner()
+    : field(Field::key), in_header(true), object_id(0), object_x(0.0),
+      has_x(false), start_speed(0), last_x(0.0) {}
+
+void Level_Scanner::end_field() {
+  if (field == Field::key) {
+    field = Field::value;
+    return;
+  }
+
+  if (in_header) {
+    if (key == "kA4") {
+      start_speed = std::atoi(value.c_str());
+    }
+  } else if (key == "1") {
+    object_id = std::atoi(value.c_str());
+  } else if (key == "2") {
+    object_x = std::atof(value.c_str());
+    has_x = true;
+  }
+
+  key.clear();
+  value.clear();
+  field = Field::key;
+}
+
+void Level_Scanner::end_object() {
+  if (field == Field::value) {
+    end_field();
+  }
+  key.clear();
+  value.clear();
+  field = Field::key;
+
+  if (in_header) {
+    in_header = false;
+    return;
+  }
+
+  if (object_id == 0) {
+    return;
+  }
+
+  stats.objects++;
+  switch (classify_object(object_id)) {
+  case Object_Kind::trigger:
+    stats.triggers++;
+    break;
+  case Object_Kind::decoration:
+    stats.decorations++;
+    break;
+  case Object_Kind::hazard:
+    stats.hazards++;
+    break;
+  case Object_Kind::speed_portal:
+    stats.speed_portals++;
+    if (has_x) {
+      portals.emplace_back(object_x, portal_speed(object_id));
+    }
+    break;
+  case Object_Kind::other:
+    break;
+  }
+
+  // triggers don't count towards where the level ends
+  if (has_x && classify_object(object_id) != Object_Kind::trigger) {
+    last_x = std::max(last_x, object_x);
+  }
+
+  object_id = 0;
+  has_x = false;
+}
+
+void Level_Scanner::feed(const char *chunk, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    auto c = chunk[i];
+    switch (c) {
+    case ',':
+      end_field();
+      break;
+    case ';':
+      end_object();
+      break;
+    default:
+      // values we care about are short, text objects can be very long
+      if (field == Field::key) {
+        if (key.size() < 8) {
+          key.push_back(c);
+        }
+      } else if (value.size() < 32) {
+        value.push_back(c);
+      }
+      break;
+    }
+  }
+}
+
+Level_Stats Level_Scanner::finish() {
+  end_object();
+
+  std::sort(portals.begin(), portals.end());
+
+  double seconds = 0.0;
+  double x = 0.0;
+  int speed = (start_speed >= 0 &&
+               static_cast<size_t>(start_speed) < SPEED_VALUES.size())
+                  ? start_speed
+                  : 0;
+
+  for (const auto &portal : portals) {
+    if (portal.first >= last_x) {
+      break;
+    }
+    seconds += (portal.first - x) / SPEED_VALUES[speed];
+    x = std::max(x, portal.first);
+    speed = portal.second;
+  }
+  seconds += (last_x - x) / SPEED_VALUES[speed];
+
+  stats.length = static_cast<int>(seconds + 0.5);
+  return stats;
+}
+
+Level_Stats decode_level_string(std::string level_string) {
+  auto size = decode_base64(level_string.data(), level_string.size());
+
+  Level_Scanner scanner;
+  Inflate_Stream inflater(
+      reinterpret_cast<const uint8_t *>(level_string.data()), size,
+      [&scanner](const char *chunk, size_t chunk_size) {
+        scanner.feed(chunk, chunk_size);
+      });
+  inflater.run();
+
+  return scanner.finish();
+}
+
+// editor levels all share id 0, the string length tells those apart
+uint64_t level_key(GJGameLevel *level) {
+  auto id = static_cast<uint64_t>(static_cast<uint32_t>(level->levelID));
+  auto revision = static_cast<uint64_t>(static_cast<uint32_t>(level->levelRev));
+  auto length = static_cast<uint64_t>(level->levelString.size());
+  return (id << 32) ^ (revision << 24) ^ length;
+}
+
+Level_Decoder::Level_Decoder()
+    : has_job(false), current_key(0), running(false) {}
+
+void Level_Decoder::start(
+    std::function<void()> n_on_decoded,
+    std::function<void(const std::string &)> n_on_error) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (running) {
+    return;
+  }
+
+  on_decoded = n_on_decoded;
+  on_error = n_on_error;
+  running = true;
+  worker.start([this](Stop_Token) { worker_loop(); });
+}
+
+void Level_Decoder::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    running = false;
+  }
+  job_cv.notify_all();
+
+  // a huge level may still be decoding, it's left to finish if so
+  worker.request_stop();
+  worker.join_for(STOP_TIMEOUT);
+}
+
+bool Level_Decoder::lookup(GJGameLevel *level, Level_Stats &stats) {
+  if (level->levelString.empty()) {
+    stats = Level_Stats();
+    return true;
+  }
+
+  auto key = level_key(level);
+
+  std::lock_guard<std::mutex> lock(mutex);
+  if (auto cached = cache.find(key); cached != cache.end()) {
+    stats = cached->second;
+    return true;
+  }
+
+  stats = Level_Stats();
+  if (running && key != current_key &&
+      !(has_job && next_job.key == key)) {
+    // replaces whatever was waiting, that level isn't being shown anymore
+    next_job.key = key;
+    next_job.level_string = level->levelString;
+    has_job = true;
+    job_cv.notify_one();
+  }
+  return false;
+}
+
+void Level_Decoder::worker_loop() {
+  while (true) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      job_cv.wait(lock, [this]() { return !running || has_job; });
+      if (!running) {
+        return;
+      }
+
+      job = std::move(next_job);
+      next_job = Job();
+      has_job = false;
+      current_key = job.key;
+    }
+
+    Level_Stats stats;
+    try {
+      stats = decode_level_string(std::move(job.level_string));
+    } catch (const std::exception &e) {
+      // cache the empty result anyways, retrying won't fix a broken level
+      if (on_error) {
+        on_error(e.what());
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      current_key = 0;
+
+      cache[job.key] = stats;
+      cache_order.push_back(job.key);
+      if (cache_order.size() > MAX_CACHED) {
+        cache.erase(cache_order.front());
+        cache_order.pop_front();
+      }
+    }
+
+    if (on_decoded) {
+      on_decoded();
+    }
+  }
+}
@@ -0,0 +1,105 @@
+#pragma once
+#ifndef LEVEL_DECODER_HPP
+#define LEVEL_DECODER_HPP
+#include "gjgamelevel.hpp"
+#include "inflate_stream.hpp"
+#include "worker_thread.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct Level_Stats {
+  int length = 0; // seconds
+  int objects = 0;
+  int triggers = 0;
+  int decorations = 0;
+  int hazards = 0;
+  int speed_portals = 0;
+};
+
+// decodes url safe base64 in place, returning the decoded size
+// throws std::runtime_error on characters outside of the alphabet
+size_t decode_base64(char *data, size_t size);
+
+// walks the decompressed level one chunk at a time
+// only the speed portals are kept around, everything else is a counter
+class Level_Scanner {
+private:
+  enum class Field { key, value };
+
+  Field field;
+  bool in_header;
+
+  std::string key;
+  std::string value;
+
+  int object_id;
+  double object_x;
+  bool has_x;
+
+  int start_speed;
+  double last_x;
+  std::vector<std::pair<double, int>> portals;
+
+  Level_Stats stats;
+
+  void end_field();
+  void end_object();
+
+public:
+  Level_Scanner();
+
+  void feed(const char *chunk, size_t size);
+  Level_Stats finish();
+};
+
+// takes GJGameLevel::levelString and does the whole
+// base64 -> inflate -> scan pipeline
+Level_Stats decode_level_string(std::string level_string);
+
+class Level_Decoder {
+private:
+  struct Job {
+    uint64_t key;
+    std::string level_string;
+  };
+
+  static constexpr size_t MAX_CACHED = 64;
+
+  std::unordered_map<uint64_t, Level_Stats> cache;
+  std::deque<uint64_t> cache_order;
+
+  // only the newest level matters, so there is at most one job waiting
+  Job next_job;
+  bool has_job;
+  uint64_t current_key;
+
+  std::mutex mutex;
+  std::condition_variable job_cv;
+  Worker_Thread worker;
+  static constexpr std::chrono::milliseconds STOP_TIMEOUT{250};
+  bool running;
+
+  std::function<void(const std::string &)> on_error;
+  std::function<void()> on_decoded;
+
+  void worker_loop();
+
+public:
+  Level_Decoder();
+
+  void start(std::function<void()> on_decoded,
+             std::function<void(const std::string &)> on_error);
+  void stop();
+
+  // returns false and queues a decode if the level hasn't been seen yet
+  bool lookup(GJGameLevel *level, Level_Stats &stats);
+};
+
+#endif
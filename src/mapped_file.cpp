@@ -0,0 +1,198 @@
+#include "mapped_file.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+Mapped_File::Mapped_File()
+    : file(INVALID_HANDLE_VALUE), mapping(nullptr), view(nullptr), length(0) {}
+
+bool Mapped_File::open(const std::string &filename) {
+  close();
+
+  file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                     OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+    close();
+    return false;
+  }
+
+  mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping == nullptr) {
+    close();
+    return false;
+  }
+
+  view = static_cast<const char *>(
+      MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+  if (view == nullptr) {
+    close();
+    return false;
+  }
+
+  length = static_cast<size_t>(file_size.QuadPart);
+  return true;
+}
+
+void Mapped_File::close() {
+  if (view != nullptr) {
+    UnmapViewOfFile(view);
+    view = nullptr;
+  }
+  if (mapping != nullptr) {
+    CloseHandle(mapping);
+    mapping = nullptr;
+  }
+  if (file != INVALID_HANDLE_VALUE) {
+    CloseHandle(file);
+    file = INVALID_HANDLE_VALUE;
+  }
+  length = 0;
+}
+Writable_Mapped_File::Writable_Mapped_File()
+    : file(INVALID_HANDLE_VALUE), mapping(nullptr), view(nullptr), length(0) {}
+
+bool Writable_Mapped_File::open(const std::string &filename, size_t size) {
+  close();
+
+  file = CreateFileA(filename.c_str(), GENERIC_READ | GENERIC_WRITE,
+                     FILE_SHARE_READ, nullptr, OPEN_ALWAYS,
+                     FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE || size == 0) {
+    close();
+    return false;
+  }
+
+  LARGE_INTEGER file_size;
+  file_size.QuadPart = static_cast<LONGLONG>(size);
+  if (!SetFilePointerEx(file, file_size, nullptr, FILE_BEGIN) ||
+      !SetEndOfFile(file)) {
+    close();
+    return false;
+  }
+
+  mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, 0, 0, nullptr);
+  if (mapping == nullptr) {
+    close();
+    return false;
+  }
+
+  view = static_cast<char *>(MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, 0));
+  if (view == nullptr) {
+    close();
+    return false;
+  }
+
+  length = size;
+  return true;
+}
+
+void Writable_Mapped_File::close() {
+  if (view != nullptr) {
+    UnmapViewOfFile(view);
+    view = nullptr;
+  }
+  if (mapping != nullptr) {
+    CloseHandle(mapping);
+    mapping = nullptr;
+  }
+  if (file != INVALID_HANDLE_VALUE) {
+    CloseHandle(file);
+    file = INVALID_HANDLE_VALUE;
+  }
+  length = 0;
+}
+#else
+Mapped_File::Mapped_File() : file(-1), view(nullptr), length(0) {}
+
+bool Mapped_File::open(const std::string &filename) {
+  close();
+
+  file = ::open(filename.c_str(), O_RDONLY);
+  if (file == -1) {
+    return false;
+  }
+
+  struct stat file_stat;
+  if (fstat(file, &file_stat) == -1 || file_stat.st_size == 0) {
+    close();
+    return false;
+  }
+
+  auto mapped = mmap(nullptr, static_cast<size_t>(file_stat.st_size),
+                     PROT_READ, MAP_PRIVATE, file, 0);
+  if (mapped == MAP_FAILED) {
+    close();
+    return false;
+  }
+
+  view = static_cast<const char *>(mapped);
+  length = static_cast<size_t>(file_stat.st_size);
+  return true;
+}
+
+void Mapped_File::close() {
+  if (view != nullptr) {
+    munmap(const_cast<char *>(view), length);
+    view = nullptr;
+  }
+  if (file != -1) {
+    ::close(file);
+    file = -1;
+  }
+  length = 0;
+}
+
+Writable_Mapped_File::Writable_Mapped_File()
+    : file(-1), view(nullptr), length(0) {}
+
+bool Writable_Mapped_File::open(const std::string &filename, size_t size) {
+  close();
+
+  file = ::open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+  if (file == -1 || size == 0) {
+    close();
+    return false;
+  }
+
+  if (ftruncate(file, static_cast<off_t>(size)) == -1) {
+    close();
+    return false;
+  }
+
+  auto mapped =
+      mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+  if (mapped == MAP_FAILED) {
+    close();
+    return false;
+  }
+
+  view = static_cast<char *>(mapped);
+  length = size;
+  return true;
+}
+
+void Writable_Mapped_File::close() {
+  if (view != nullptr) {
+    munmap(view, length);
+    view = nullptr;
+  }
+  if (file != -1) {
+    ::close(file);
+    file = -1;
+  }
+  length = 0;
+}
+#endif
+
+Mapped_File::~Mapped_File() { close(); }
+Writable_Mapped_File::~Writable_Mapped_File() { close(); }
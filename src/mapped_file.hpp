@@ -0,0 +1,67 @@
+#pragma once
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// read only view of a whole file
+class Mapped_File {
+private:
+#ifdef _WIN32
+  HANDLE file;
+  HANDLE mapping;
+#else
+  int file;
+#endif
+  const char *view;
+  size_t length;
+
+public:
+  Mapped_File();
+  ~Mapped_File();
+
+  Mapped_File(const Mapped_File &) = delete;
+  Mapped_File &operator=(const Mapped_File &) = delete;
+
+  // returns false if the file couldn't be opened or is empty
+  bool open(const std::string &filename);
+  void close();
+
+  const char *data() const { return view; }
+  size_t size() const { return length; }
+};
+
+// read and write view of a whole file, changes go straight to the file
+class Writable_Mapped_File {
+private:
+#ifdef _WIN32
+  HANDLE file;
+  HANDLE mapping;
+#else
+  int file;
+#endif
+  char *view;
+  size_t length;
+
+public:
+  Writable_Mapped_File();
+  ~Writable_Mapped_File();
+
+  Writable_Mapped_File(const Writable_Mapped_File &) = delete;
+  Writable_Mapped_File &operator=(const Writable_Mapped_File &) = delete;
+
+  // creates the file if needed and grows or shrinks it to size first
+  // new bytes are zero
+  bool open(const std::string &filename, size_t size);
+  void close();
+
+  char *data() const { return view; }
+  size_t size() const { return length; }
+};
+
+#endif
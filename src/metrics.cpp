@@ -0,0 +1,305 @@
+#include "metrics.hpp"
+
+#include "gdapi.hpp"
+#include "worker_thread.hpp"
+
+#include <stdexcept>
+
+#include <fmt/format.h>
+#include <httplib.h>
+
+Metrics metrics = Metrics();
+
+Metrics *get_metrics() { return &metrics; }
+
+namespace {
+constexpr const char *HOOK_NAMES[] = {"MenuLayer::init",
+                                      "PlayLayer::create",
+                                      "PlayLayer::onQuit",
+                                      "PlayLayer::showNewBest",
+                                      "EditorPauseLayer::onExitEditor",
+                                      "LevelEditorLayer::create",
+                                      "LevelEditorLayer::addSpecial",
+                                      "LevelEditorLayer::removeSpecial",
+                                      "CCDirector::end"};
+static_assert(sizeof(HOOK_NAMES) / sizeof(HOOK_NAMES[0]) ==
+                  static_cast<size_t>(Hook_Id::count),
+              "every hook needs a name");
+
+// indices match Request_Outcome
+constexpr const char *OUTCOME_NAMES[] = {"ok", "rejected", "http_error",
+                                         "no_response"};
+static_assert(sizeof(OUTCOME_NAMES) / sizeof(OUTCOME_NAMES[0]) ==
+                  Endpoint_Metrics::OUTCOME_COUNT,
+              "every outcome needs a name");
+
+void write_header(std::string &out, const char *name, const char *type,
+                  const char *help) {
+  fmt::format_to(std::back_inserter(out), "# HELP {} {}\n# TYPE {} {}\n",
+                 name, help, name, type);
+}
+} // namespace
+
+void Histogram::observe(double seconds) {
+  size_t bucket = 0;
+  while (bucket < BOUNDS.size() && seconds > BOUNDS[bucket]) {
+    bucket++;
+  }
+
+  buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+  count.fetch_add(1, std::memory_order_relaxed);
+  sum_us.fetch_add(static_cast<uint64_t>(seconds * 1e6),
+                   std::memory_order_relaxed);
+}
+
+uint64_t Histogram::get_count() const {
+  return count.load(std::memory_order_relaxed);
+}
+
+double Histogram::get_sum() const {
+  return sum_us.load(std::memory_order_relaxed) / 1e6;
+}
+
+double Histogram::quantile(double q) const {
+  uint64_t total = 0;
+  for (const auto &bucket : buckets) {
+    total += bucket.load(std::memory_order_relaxed);
+  }
+  if (total == 0) {
+    return 0.0;
+  }
+
+  auto target = q * total;
+  uint64_t seen = 0;
+  for (size_t i = 0; i < BOUNDS.size(); i++) {
+    auto in_bucket = buckets[i].load(std::memory_order_relaxed);
+    if (in_bucket != 0 && seen + in_bucket >= target) {
+      auto lower = i == 0 ? 0.0 : BOUNDS[i - 1];
+      return lower + (BOUNDS[i] - lower) * (target - seen) / in_bucket;
+    }
+    seen += in_bucket;
+  }
+
+  // somewhere past the last bound
+  return BOUNDS.back();
+}
+
+void Histogram::write(std::string &out, const char *name,
+                      const std::string &labels) const {
+  auto separator = labels.empty() ? "" : ",";
+  auto out_it = std::back_inserter(out);
+
+  uint64_t cumulative = 0;
+  for (size_t i = 0; i < BOUNDS.size(); i++) {
+    cumulative += buckets[i].load(std::memory_order_relaxed);
+    fmt::format_to(out_it, "{}_bucket{{{}{}le=\"{}\"}} {}\n", name, labels,
+                   separator, BOUNDS[i], cumulative);
+  }
+  cumulative += buckets.back().load(std::memory_order_relaxed);
+  fmt::format_to(out_it, "{}_bucket{{{}{}le=\"+Inf\"}} {}\n", name, labels,
+                 separator, cumulative);
+
+  auto braced = labels.empty() ? labels : "{" + labels + "}";
+  fmt::format_to(out_it, "{}_sum{} {}\n{}_count{} {}\n", name, braced,
+                 get_sum(), name, braced, get_count());
+}
+
+void Endpoint_Metrics::record(const Request_Timing &timing) {
+  requests.fetch_add(1, std::memory_order_relaxed);
+  outcomes.at(static_cast<size_t>(timing.outcome))
+      .fetch_add(1, std::memory_order_relaxed);
+  bytes.fetch_add(timing.size, std::memory_order_relaxed);
+
+  if (timing.outcome == Request_Outcome::no_response) {
+    // timeouts would only drag the phases towards the timeout
+    return;
+  }
+
+  latency.observe(timing.total);
+  dns.observe(timing.dns);
+  first_byte.observe(timing.first_byte);
+  transfer.observe(timing.transfer);
+}
+
+Metrics::Metrics() {
+  GDUrls urls;
+  endpoints.at(0).name = urls.get_user_info;
+  endpoints.at(1).name = urls.get_users;
+  endpoints.at(2).name = urls.get_scores;
+  endpoints.at(3).name = urls.get_song_info;
+  endpoints.at(4).name = "other";
+}
+
+Endpoint_Metrics &Metrics::endpoint(const std::string &url) {
+  for (size_t i = 0; i < ENDPOINT_COUNT - 1; i++) {
+    if (endpoints[i].name == url) {
+      return endpoints[i];
+    }
+  }
+  return endpoints.back();
+}
+
+std::string Metrics::render() const {
+  std::string out;
+  auto out_it = std::back_inserter(out);
+
+  write_header(out, "gdrpc_presence_updates_total", "counter",
+               "Presence frames rendered, by whether they were sent");
+  fmt::format_to(out_it,
+                 "gdrpc_presence_updates_total{{result=\"sent\"}} {}\n"
+                 "gdrpc_presence_updates_total{{result=\"coalesced\"}} {}\n",
+                 presence_sent.load(std::memory_order_relaxed),
+                 presence_coalesced.load(std::memory_order_relaxed));
+
+  write_header(out, "gdrpc_hook_invocations_total", "counter",
+               "Calls into each game detour");
+  for (size_t i = 0; i < hook_calls.size(); i++) {
+    fmt::format_to(out_it, "gdrpc_hook_invocations_total{{hook=\"{}\"}} {}\n",
+                   HOOK_NAMES[i],
+                   hook_calls[i].load(std::memory_order_relaxed));
+  }
+
+  write_header(out, "gdrpc_request_duration_seconds", "histogram",
+               "Time taken by GD_Client requests, by endpoint");
+  for (const auto &endpoint : endpoints) {
+    endpoint.latency.write(out, "gdrpc_request_duration_seconds",
+                           "endpoint=\"" + endpoint.name + "\"");
+  }
+
+  write_header(out, "gdrpc_requests_total", "counter",
+               "GD_Client requests, by endpoint");
+  for (const auto &endpoint : endpoints) {
+    fmt::format_to(out_it, "gdrpc_requests_total{{endpoint=\"{}\"}} {}\n",
+                   endpoint.name,
+                   endpoint.requests.load(std::memory_order_relaxed));
+  }
+
+  write_header(out, "gdrpc_request_outcomes_total", "counter",
+               "GD_Client requests, by endpoint and how they ended");
+  for (const auto &endpoint : endpoints) {
+    for (size_t i = 0; i < Endpoint_Metrics::OUTCOME_COUNT; i++) {
+      fmt::format_to(out_it,
+                     "gdrpc_request_outcomes_total"
+                     "{{endpoint=\"{}\",outcome=\"{}\"}} {}\n",
+                     endpoint.name, OUTCOME_NAMES[i],
+          endpoint.outcomes[i].load(std::memory_order_relaxed));
+    }
+  }
+
+  write_header(out, "gdrpc_response_bytes_total", "counter",
+               "Response body bytes received, by endpoint");
+  for (const auto &endpoint : endpoints) {
+    fmt::format_to(out_it,
+                   "gdrpc_response_bytes_total{{endpoint=\"{}\"}} {}\n",
+                   endpoint.name,
+                   endpoint.bytes.load(std::memory_order_relaxed));
+  }
+
+  write_header(out, "gdrpc_request_phase_seconds", "histogram",
+               "Time spent in each part of a request, by endpoint");
+  for (const auto &endpoint : endpoints) {
+    auto labels = "endpoint=\"" + endpoint.name + "\",phase=";
+    endpoint.dns.write(out, "gdrpc_request_phase_seconds",
+                       labels + "\"dns\"");
+    endpoint.first_byte.write(out, "gdrpc_request_phase_seconds",
+                              labels + "\"first_byte\"");
+    endpoint.transfer.write(out, "gdrpc_request_phase_seconds",
+                            labels + "\"transfer\"");
+  }
+
+  write_header(out, "gdrpc_discord_status", "gauge",
+               "Discord_Presence status, 0 when connected");
+  fmt::format_to(out_it, "gdrpc_discord_status {}\n",
+                 discord_status.load(std::memory_order_relaxed));
+
+  write_header(out, "gdrpc_discord_state", "gauge",
+               "0 disconnected, 1 connecting, 2 ready, 3 errored");
+  fmt::format_to(out_it, "gdrpc_discord_state {}\n",
+                 discord_state.load(std::memory_order_relaxed));
+
+  write_header(out, "gdrpc_loop_duration_seconds", "histogram",
+               "Time spent in each iteration of the main loop");
+  loop_time.write(out, "gdrpc_loop_duration_seconds", "");
+
+  return out;
+}
+
+std::string Metrics::summary() const {
+  std::string out;
+  auto out_it = std::back_inserter(out);
+
+  for (const auto &endpoint : endpoints) {
+    auto requests = endpoint.requests.load(std::memory_order_relaxed);
+    if (requests == 0) {
+      continue;
+    }
+
+    fmt::format_to(out_it, "{}: {} requests,", endpoint.name, requests);
+    for (size_t i = 0; i < Endpoint_Metrics::OUTCOME_COUNT; i++) {
+      fmt::format_to(out_it, " {} {}",
+                     endpoint.outcomes[i].load(std::memory_order_relaxed),
+                     OUTCOME_NAMES[i]);
+    }
+    fmt::format_to(out_it, ", {} bytes\n",
+                   endpoint.bytes.load(std::memory_order_relaxed));
+
+    auto phase = [&out_it](const char *name, const Histogram &histogram) {
+      fmt::format_to(out_it, "  {:<10} p50 {:7.1f}ms  p95 {:7.1f}ms\n", name,
+                     histogram.quantile(0.5) * 1000.0,
+                     histogram.quantile(0.95) * 1000.0);
+    };
+    phase("dns", endpoint.dns);
+    phase("first byte", endpoint.first_byte);
+    phase("transfer", endpoint.transfer);
+    phase("total", endpoint.latency);
+  }
+
+  if (out.empty()) {
+    out = "no requests made\n";
+  }
+
+  return out;
+}
+
+Metrics_Server::Metrics_Server() = default;
+
+Metrics_Server::~Metrics_Server() { stop(); }
+
+void Metrics_Server::start(int port) {
+  stop();
+
+  server = std::make_unique<httplib::Server>();
+  server->Get("/metrics", [](const httplib::Request &, httplib::Response &res) {
+    res.set_content(get_metrics()->render(),
+                    "text/plain; version=0.0.4; charset=utf-8");
+  });
+  server->Get("/telemetry",
+              [](const httplib::Request &, httplib::Response &res) {
+                res.set_content(get_metrics()->summary(), "text/plain");
+              });
+
+  // localhost only, nothing here is meant for the network
+  if (!server->bind_to_port("127.0.0.1", port)) {
+    server.reset();
+    throw std::runtime_error("could not bind metrics endpoint to port " +
+                             std::to_string(port));
+  }
+
+  // the thread only knows the server, it may outlive this if it's stuck
+  auto listening = server.get();
+  listener.start([listening](Stop_Token) { listening->listen_after_bind(); });
+}
+
+void Metrics_Server::stop() {
+  if (!server) {
+    return;
+  }
+
+  server->stop();
+  if (!listener.join_for(STOP_TIMEOUT)) {
+    // still serving a scrape, the server goes with the process
+    server.release();
+    return;
+  }
+  server.reset();
+}
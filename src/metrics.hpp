@@ -0,0 +1,132 @@
+#pragma once
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include "mirror_pool.hpp"
+#include "worker_thread.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// latency histogram with fixed buckets, observing is a few relaxed atomic
+// adds so it can be called from hooks and request threads alike
+class Histogram {
+public:
+  // upper bounds in seconds
+  static constexpr std::array<double, 12> BOUNDS{
+      0.001, 0.0025, 0.005, 0.01, 0.025, 0.05,
+      0.1,   0.25,   0.5,   1.0,  2.5,   5.0};
+
+private:
+  // one extra for +Inf
+  std::array<std::atomic<uint64_t>, BOUNDS.size() + 1> buckets{};
+  std::atomic<uint64_t> count{0};
+  std::atomic<uint64_t> sum_us{0};
+
+public:
+  void observe(double seconds);
+
+  uint64_t get_count() const;
+  double get_sum() const;
+
+  // estimated from the buckets, assuming samples are spread evenly in them
+  double quantile(double q) const;
+
+  // appends _bucket, _sum and _count lines in the prometheus text format
+  void write(std::string &out, const char *name,
+             const std::string &labels) const;
+};
+
+enum class Hook_Id : size_t {
+  MenuLayer_init,
+  PlayLayer_create,
+  PlayLayer_onQuit,
+  PlayLayer_showNewBest,
+  EditorPauseLayer_onExitEditor,
+  LevelEditorLayer_create,
+  LevelEditorLayer_addSpecial,
+  LevelEditorLayer_removeSpecial,
+  CCDirector_end,
+  count
+};
+
+struct Endpoint_Metrics {
+  static constexpr size_t OUTCOME_COUNT = 4;
+
+  std::string name;
+  std::atomic<uint64_t> requests{0};
+  std::array<std::atomic<uint64_t>, OUTCOME_COUNT> outcomes{};
+  std::atomic<uint64_t> bytes{0};
+
+  Histogram latency;
+  Histogram dns;
+  Histogram first_byte;
+  Histogram transfer;
+
+  void record(const Request_Timing &timing);
+};
+
+// everything gdrpc counts about itself
+// all the members are safe to update from any thread without a lock,
+// rendering reads them with relaxed loads so a scrape may be slightly torn
+class Metrics {
+public:
+  // endpoints are known up front so lookups never have to insert
+  // the last one collects anything unexpected
+  static constexpr size_t ENDPOINT_COUNT = 5;
+
+private:
+  std::array<std::atomic<uint64_t>, static_cast<size_t>(Hook_Id::count)>
+      hook_calls{};
+  std::array<Endpoint_Metrics, ENDPOINT_COUNT> endpoints;
+
+public:
+  std::atomic<uint64_t> presence_sent{0};
+  std::atomic<uint64_t> presence_coalesced{0};
+  std::atomic<int> discord_status{-1};
+  std::atomic<int> discord_state{0};
+  Histogram loop_time;
+
+  Metrics();
+
+  void count_hook(Hook_Id id) {
+    hook_calls.at(static_cast<size_t>(id))
+        .fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // url is the endpoint file, ex. getGJUserInfo20.php
+  Endpoint_Metrics &endpoint(const std::string &url);
+  const std::array<Endpoint_Metrics, ENDPOINT_COUNT> &get_endpoints() const {
+    return endpoints;
+  }
+
+  std::string render() const;
+
+  // a readable per endpoint breakdown of request times, for the log
+  std::string summary() const;
+};
+
+Metrics *get_metrics();
+
+// serves /metrics on 127.0.0.1 for a scraper or curl
+class Metrics_Server {
+private:
+  static constexpr std::chrono::milliseconds STOP_TIMEOUT{250};
+
+  std::unique_ptr<httplib::Server> server;
+  Worker_Thread listener;
+
+public:
+  Metrics_Server();
+  ~Metrics_Server();
+
+  // throws std::runtime_error if the port can't be bound
+  void start(int port);
+  void stop();
+};
+
+#endif
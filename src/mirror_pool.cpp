@@ -0,0 +1,304 @@
+#include "mirror_pool.hpp"
+#include "worker_thread.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <stdexcept>
+
+// shared between the request threads of a single post
+struct Hedge_State {
+  std::mutex mutex;
+  std::condition_variable cv;
+
+  bool done = false;
+  int running = 0;
+
+  std::string body;
+  std::string error;
+  Request_Timing timing;
+
+  // clients still waiting on a response
+  std::vector<std::shared_ptr<httplib::Client>> clients;
+};
+
+Mirror_Pool::Mirror_Pool(std::vector<std::string> hosts,
+                         std::chrono::seconds timeout)
+    : timeout(timeout) {
+  for (const auto &host : hosts) {
+#ifndef CPPHTTPLIB_OPENSSL_SUPPORT
+    if (host.rfind("https://", 0) == 0) {
+      setup_error = "https mirror " + host + " needs a build with OpenSSL";
+      continue;
+    }
+#endif
+
+    Mirror mirror;
+    mirror.host = host;
+    mirrors.push_back(mirror);
+  }
+}
+
+std::vector<size_t> Mirror_Pool::ranked() {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  std::vector<size_t> order(mirrors.size());
+  for (size_t i = 0; i < order.size(); i++) {
+    order[i] = i;
+  }
+
+  // untested mirrors go last, in the order they were configured
+  std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+    const auto &first = mirrors.at(a);
+    const auto &second = mirrors.at(b);
+    if (first.has_samples != second.has_samples) {
+      return first.has_samples;
+    }
+    return first.has_samples && first.latency_ewma < second.latency_ewma;
+  });
+
+  return order;
+}
+
+std::chrono::milliseconds Mirror_Pool::hedge_delay(size_t index) {
+  std::lock_guard<std::mutex> lock(mutex);
+  const auto &mirror = mirrors.at(index);
+
+  if (mirror.sample_count < 5) {
+    return DEFAULT_HEDGE_DELAY;
+  }
+
+  std::array<double, 32> sorted = mirror.samples;
+  std::sort(sorted.begin(), sorted.begin() + mirror.sample_count);
+
+  auto p95_index = (mirror.sample_count * 95 + 99) / 100 - 1;
+  auto delay = std::chrono::milliseconds(
+      static_cast<long long>(sorted.at(p95_index)));
+
+  return std::clamp(delay, MIN_HEDGE_DELAY, MAX_HEDGE_DELAY);
+}
+
+void Mirror_Pool::record(size_t index, double latency_ms) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto &mirror = mirrors.at(index);
+
+  if (mirror.has_samples) {
+    mirror.latency_ewma =
+        EWMA_WEIGHT * latency_ms + (1.0 - EWMA_WEIGHT) * mirror.latency_ewma;
+  } else {
+    mirror.latency_ewma = latency_ms;
+    mirror.has_samples = true;
+  }
+
+  mirror.samples.at(mirror.next_sample) = latency_ms;
+  mirror.next_sample = (mirror.next_sample + 1) % mirror.samples.size();
+  mirror.sample_count = std::min(mirror.sample_count + 1, mirror.samples.size());
+}
+
+std::shared_ptr<httplib::Client> Mirror_Pool::take_client(size_t index) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto &mirror = mirrors.at(index);
+
+  if (!mirror.idle_clients.empty()) {
+    auto client = mirror.idle_clients.back();
+    mirror.idle_clients.pop_back();
+    return client;
+  }
+
+  auto client = std::make_shared<httplib::Client>(mirror.host);
+  client->set_connection_timeout(timeout.count());
+  client->set_read_timeout(timeout.count());
+  client->set_keep_alive(true);
+  client->set_decompress(true);
+  return client;
+}
+
+void Mirror_Pool::return_client(size_t index,
+                                std::shared_ptr<httplib::Client> client) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto &mirror = mirrors.at(index);
+
+  if (mirror.idle_clients.size() < MAX_IDLE_CLIENTS) {
+    mirror.idle_clients.push_back(client);
+  }
+}
+
+std::string Mirror_Pool::post(const std::string &path, const std::string &body,
+                              Request_Timing &timing) {
+  auto order = ranked();
+  auto state = std::make_shared<Hedge_State>();
+  state->error = setup_error.empty() ? "no mirrors configured" : setup_error;
+  auto self = shared_from_this();
+  auto timeout_ms =
+      std::chrono::duration<double, std::milli>(timeout).count();
+
+  auto launch = [&](size_t index) {
+    auto client = take_client(index);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (stopping) {
+        throw std::runtime_error("shutting down");
+      }
+      busy_clients.push_back(client);
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      state->clients.push_back(client);
+      state->running++;
+    }
+
+    auto request = [self, state, client, index, path, body,
+                    timeout_ms](Stop_Token) {
+#ifdef CPPHTTPLIB_ZLIB_SUPPORT
+      // decompressed by httplib as the body streams in
+      httplib::Headers headers{{"Accept-Encoding", "gzip, deflate"}};
+#else
+      httplib::Headers headers;
+#endif
+
+      typedef std::chrono::steady_clock clock;
+      auto seconds_since = [](clock::time_point point) {
+        return std::chrono::duration<double>(clock::now() - point).count();
+      };
+
+      Request_Timing timing;
+      auto start = clock::now();
+
+      // only called when a new socket is opened, right after the lookup
+      client->set_socket_options([&](httplib::socket_t) {
+        timing.dns = seconds_since(start);
+      });
+
+      httplib::Request req;
+      req.method = "POST";
+      req.path = path;
+      req.headers = headers;
+      req.body = body;
+      req.set_header("Content-Type", "application/x-www-form-urlencoded");
+
+      // the first call comes in once the headers have been read
+      bool headers_read = false;
+      req.progress = [&](uint64_t, uint64_t) {
+        if (!headers_read) {
+          timing.first_byte = seconds_since(start);
+          headers_read = true;
+        }
+        return true;
+      };
+
+      auto res = client->send(req);
+      client->set_socket_options(nullptr);
+
+      {
+        std::lock_guard<std::mutex> lock(self->mutex);
+        auto &busy = self->busy_clients;
+        busy.erase(std::find(busy.begin(), busy.end(), client));
+      }
+
+      timing.total = seconds_since(start);
+      if (!headers_read) {
+        timing.first_byte = timing.total;
+      }
+      timing.transfer = timing.total - timing.first_byte;
+      auto latency = timing.total * 1000.0;
+
+      if (res) {
+        timing.size = res->body.size();
+        timing.outcome = res->status == 200 ? Request_Outcome::ok
+                                            : Request_Outcome::http_error;
+      }
+
+      std::lock_guard<std::mutex> lock(state->mutex);
+      state->running--;
+      state->clients.erase(
+          std::find(state->clients.begin(), state->clients.end(), client));
+
+      if (res && res->status == 200) {
+        self->record(index, latency);
+        self->return_client(index, client);
+        if (!state->done) {
+          state->done = true;
+          state->body = res->body;
+          state->timing = timing;
+        }
+      } else if (!state->done) {
+        // cancelled requests don't count against the mirror
+        self->record(index, timeout_ms);
+        state->error = res ? "server returned status " +
+                                 std::to_string(res->status)
+                           : "no response from server";
+        state->timing = timing;
+      }
+
+      state->cv.notify_all();
+    };
+
+    try {
+      requests.start(request);
+    } catch (const std::exception &) {
+      // stopped between the check above and now
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        busy_clients.erase(
+            std::find(busy_clients.begin(), busy_clients.end(), client));
+      }
+      std::lock_guard<std::mutex> lock(state->mutex);
+      state->clients.erase(
+          std::find(state->clients.begin(), state->clients.end(), client));
+      state->running--;
+      throw;
+    }
+  };
+
+  size_t launched = 0;
+  if (!order.empty()) {
+    launch(order.at(launched++));
+  }
+
+  std::unique_lock<std::mutex> lock(state->mutex);
+  while (!state->done && (state->running != 0 || launched < order.size())) {
+    auto finished = [&state]() {
+      return state->done || state->running == 0;
+    };
+
+    if (launched < order.size()) {
+      auto delay = hedge_delay(order.at(launched - 1));
+      state->cv.wait_for(lock, delay, finished);
+      if (state->done) {
+        break;
+      }
+
+      // either the last one failed or it's taking too long, ask another
+      lock.unlock();
+      launch(order.at(launched++));
+      lock.lock();
+    } else {
+      state->cv.wait(lock, finished);
+    }
+  }
+
+  // whoever is still in flight won't be needed
+  for (auto &client : state->clients) {
+    client->stop();
+  }
+
+  timing = state->timing;
+  if (!state->done) {
+    throw std::runtime_error(state->error);
+  }
+
+  return state->body;
+}
+
+void Mirror_Pool::stop(std::chrono::milliseconds stop_timeout) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+    for (auto &client : busy_clients) {
+      client->stop();
+    }
+  }
+
+  requests.stop_all(stop_timeout);
+}
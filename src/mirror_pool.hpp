@@ -0,0 +1,97 @@
+#pragma once
+#ifndef MIRROR_POOL_HPP
+#define MIRROR_POOL_HPP
+#include "worker_thread.hpp"
+
+#include <array>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <httplib.h>
+
+enum class Request_Outcome { ok, rejected, http_error, no_response };
+
+// where the time of a single request went, all in seconds
+// httplib doesn't report when connect finishes, so that's part of first_byte
+struct Request_Timing {
+  // resolving the host, 0 if a kept alive connection was reused
+  double dns = 0.0;
+  // until the response headers were in
+  double first_byte = 0.0;
+  double transfer = 0.0;
+  double total = 0.0;
+
+  size_t size = 0;
+  Request_Outcome outcome = Request_Outcome::no_response;
+};
+
+// a set of servers hosting the same gdps
+// requests go to the fastest known mirror, and if it hasn't answered by the
+// time it usually would have (p95), the next mirror gets the same request
+class Mirror_Pool : public std::enable_shared_from_this<Mirror_Pool> {
+private:
+  struct Mirror {
+    std::string host;
+
+    // finished clients are kept so their connection (and tls session) can be
+    // used again, a stopped client has to be thrown away
+    std::vector<std::shared_ptr<httplib::Client>> idle_clients;
+
+    double latency_ewma = 0.0;
+    bool has_samples = false;
+
+    // recent latencies in ms, used for the hedge delay
+    std::array<double, 32> samples{};
+    size_t sample_count = 0;
+    size_t next_sample = 0;
+  };
+
+  static constexpr double EWMA_WEIGHT = 0.2;
+  static constexpr std::chrono::milliseconds DEFAULT_HEDGE_DELAY{500};
+  static constexpr std::chrono::milliseconds MIN_HEDGE_DELAY{50};
+  static constexpr std::chrono::milliseconds MAX_HEDGE_DELAY{2000};
+
+  static constexpr size_t MAX_IDLE_CLIENTS = 2;
+
+  std::vector<Mirror> mirrors;
+  std::mutex mutex;
+
+  // set if a mirror had to be skipped, reported when nothing else works
+  std::string setup_error;
+
+  std::chrono::seconds timeout;
+
+  // one worker per request sent, and the clients they're using right now
+  // so stop() can cut them short
+  Worker_Group requests;
+  std::vector<std::shared_ptr<httplib::Client>> busy_clients;
+  bool stopping = false;
+
+  // mirror indices, fastest first
+  std::vector<size_t> ranked();
+  std::chrono::milliseconds hedge_delay(size_t mirror);
+  void record(size_t mirror, double latency_ms);
+
+  std::shared_ptr<httplib::Client> take_client(size_t mirror);
+  void return_client(size_t mirror, std::shared_ptr<httplib::Client> client);
+
+public:
+  Mirror_Pool(std::vector<std::string> hosts,
+              std::chrono::seconds timeout = std::chrono::seconds(10));
+
+  // sends the request, returning the body of the first mirror to respond
+  // timing describes that response, or the last failure
+  // throws std::runtime_error if none of them did
+  // body is an already encoded form
+  std::string post(const std::string &path, const std::string &body,
+                   Request_Timing &timing);
+
+  // cancels whatever is in flight and waits up to timeout for the request
+  // threads, posting after this throws
+  void stop(std::chrono::milliseconds stop_timeout);
+};
+
+#endif
@@ -0,0 +1,300 @@
+#include "override_server.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <cstdlib>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+std::string override_server_path() {
+#ifdef _WIN32
+  return "\\\\.\\pipe\\gdrpc-overrides";
+#else
+  const char *directory = nullptr;
+  for (auto variable : {"XDG_RUNTIME_DIR", "TMPDIR", "TMP", "TEMP"}) {
+    if ((directory = std::getenv(variable))) {
+      break;
+    }
+  }
+
+  return std::string(directory ? directory : "/tmp") + "/gdrpc-overrides";
+#endif
+}
+
+Override_Server::Override_Server()
+    :
+#ifndef _WIN32
+      listen_fd(-1),
+#endif
+      overrides(nullptr) {
+}
+
+Override_Server::~Override_Server() { stop(); }
+
+bool Override_Server::consume(std::string &buffer) {
+  size_t offset = 0;
+  bool changed = false;
+
+  while (buffer.size() - offset >= sizeof(Override_Header)) {
+    Override_Header header;
+    std::memcpy(&header, buffer.data() + offset, sizeof(header));
+
+    if (header.field >= static_cast<uint8_t>(Override_Field::count) ||
+        header.size > MAX_OVERRIDE_SIZE) {
+      return false;
+    }
+
+    if (buffer.size() - offset < sizeof(header) + header.size) {
+      break;
+    }
+
+    auto text = buffer.data() + offset + sizeof(header);
+    changed |= overrides->set(static_cast<Override_Field>(header.field),
+                              header.priority,
+                              std::chrono::milliseconds(header.ttl_ms), text,
+                              header.size);
+    offset += sizeof(header) + header.size;
+  }
+
+  buffer.erase(0, offset);
+
+  // a burst of messages only asks for one update
+  if (changed && on_change) {
+    on_change();
+  }
+  return true;
+}
+
+#ifdef _WIN32
+bool Override_Server::listen(Pipe_Instance &instance) {
+  instance.connected = false;
+  instance.buffer.clear();
+
+  if (ConnectNamedPipe(instance.pipe, &instance.overlapped)) {
+    return false;
+  }
+
+  switch (GetLastError()) {
+  case ERROR_IO_PENDING:
+    instance.pending = true;
+    return true;
+  case ERROR_PIPE_CONNECTED:
+    // connected between creating the pipe and now, nothing to wait for
+    instance.pending = false;
+    instance.connected = true;
+    SetEvent(instance.overlapped.hEvent);
+    return true;
+  default:
+    return false;
+  }
+}
+
+void Override_Server::start(Presence_Overrides &overrides,
+                            std::function<void()> on_change) {
+  stop();
+  this->overrides = &overrides;
+  this->on_change = on_change;
+
+  auto path = override_server_path();
+  instances = std::vector<Pipe_Instance>(MAX_CLIENTS);
+  for (auto &instance : instances) {
+    instance.pipe = CreateNamedPipeA(
+        path.c_str(), PIPE_ACCESS_INBOUND | FILE_FLAG_OVERLAPPED,
+        PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT |
+            PIPE_REJECT_REMOTE_CLIENTS,
+        static_cast<DWORD>(MAX_CLIENTS), 0, sizeof(instance.chunk), 0,
+        nullptr);
+    instance.overlapped.hEvent = CreateEventA(nullptr, TRUE, TRUE, nullptr);
+
+    if (instance.pipe == INVALID_HANDLE_VALUE ||
+        instance.overlapped.hEvent == nullptr || !listen(instance)) {
+      stop();
+      throw std::runtime_error("could not create the override pipe");
+    }
+  }
+
+  worker.start([this](Stop_Token token) { serve(token); });
+}
+
+void Override_Server::serve(Stop_Token token) {
+  std::vector<HANDLE> events;
+  for (auto &instance : instances) {
+    events.push_back(instance.overlapped.hEvent);
+  }
+
+  while (!token.stop_requested()) {
+    auto result =
+        WaitForMultipleObjects(static_cast<DWORD>(events.size()),
+                               events.data(), FALSE,
+                               static_cast<DWORD>(POLL_INTERVAL.count()));
+    if (result == WAIT_TIMEOUT) {
+      continue;
+    }
+    if (result >= WAIT_OBJECT_0 + events.size()) {
+      break;
+    }
+
+    auto &instance = instances.at(result - WAIT_OBJECT_0);
+    bool ok = true;
+
+    if (instance.pending) {
+      instance.pending = false;
+
+      DWORD read = 0;
+      if (!GetOverlappedResult(instance.pipe, &instance.overlapped, &read,
+                               FALSE)) {
+        ok = false;
+      } else if (!instance.connected) {
+        instance.connected = true;
+      } else {
+        instance.buffer.append(instance.chunk, read);
+        ok = consume(instance.buffer);
+      }
+    }
+
+    if (ok) {
+      // completes through the event either way
+      if (ReadFile(instance.pipe, instance.chunk, sizeof(instance.chunk),
+                   nullptr, &instance.overlapped) ||
+          GetLastError() == ERROR_IO_PENDING) {
+        instance.pending = true;
+        continue;
+      }
+    }
+
+    // the client left or broke the protocol, wait for the next one
+    DisconnectNamedPipe(instance.pipe);
+    if (!listen(instance)) {
+      ResetEvent(instance.overlapped.hEvent);
+    }
+  }
+}
+
+void Override_Server::stop() {
+  worker.request_stop();
+  bool stopped = worker.join_for(STOP_TIMEOUT);
+
+  if (!stopped) {
+    // the thread still has the handles, they go with the process
+    instances.clear();
+    return;
+  }
+
+  for (auto &instance : instances) {
+    if (instance.pipe != INVALID_HANDLE_VALUE) {
+      CancelIo(instance.pipe);
+      CloseHandle(instance.pipe);
+    }
+    if (instance.overlapped.hEvent != nullptr) {
+      CloseHandle(instance.overlapped.hEvent);
+    }
+  }
+  instances.clear();
+}
+#else
+void Override_Server::start(Presence_Overrides &overrides,
+                            std::function<void()> on_change) {
+  stop();
+  this->overrides = &overrides;
+  this->on_change = on_change;
+
+  socket_path = override_server_path();
+
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (socket_path.size() >= sizeof(address.sun_path)) {
+    throw std::runtime_error("override socket path is too long");
+  }
+  std::strncpy(address.sun_path, socket_path.c_str(),
+               sizeof(address.sun_path) - 1);
+
+  // left behind if the game didn't close properly
+  ::unlink(socket_path.c_str());
+
+  listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listen_fd == -1 ||
+      bind(listen_fd, reinterpret_cast<sockaddr *>(&address),
+           sizeof(address)) == -1 ||
+      ::listen(listen_fd, static_cast<int>(MAX_CLIENTS)) == -1 ||
+      fcntl(listen_fd, F_SETFL, O_NONBLOCK) == -1) {
+    stop();
+    throw std::runtime_error("could not create the override socket");
+  }
+
+  worker.start([this](Stop_Token token) { serve(token); });
+}
+
+void Override_Server::serve(Stop_Token token) {
+  // the first entry is always the listening socket
+  std::vector<pollfd> fds{{listen_fd, POLLIN, 0}};
+  std::vector<std::string> buffers{std::string()};
+  char chunk[4096];
+
+  while (!token.stop_requested()) {
+    if (poll(fds.data(), fds.size(), static_cast<int>(POLL_INTERVAL.count())) <=
+        0) {
+      continue;
+    }
+
+    for (size_t i = fds.size() - 1; i > 0; i--) {
+      if (fds[i].revents == 0) {
+        continue;
+      }
+
+      bool ok = true;
+      while (true) {
+        auto read = ::recv(fds[i].fd, chunk, sizeof(chunk), 0);
+        if (read > 0) {
+          buffers[i].append(chunk, static_cast<size_t>(read));
+          continue;
+        }
+        // 0 is the client hanging up
+        ok = read == -1 && (errno == EAGAIN || errno == EWOULDBLOCK);
+        break;
+      }
+
+      // whatever arrived before a hang up still counts
+      if (!consume(buffers[i]) || !ok) {
+        ::close(fds[i].fd);
+        fds.erase(fds.begin() + i);
+        buffers.erase(buffers.begin() + i);
+      }
+    }
+
+    if (fds[0].revents & POLLIN) {
+      int client;
+      while ((client = accept(listen_fd, nullptr, nullptr)) != -1) {
+        if (fds.size() > MAX_CLIENTS ||
+            fcntl(client, F_SETFL, O_NONBLOCK) == -1) {
+          ::close(client);
+          continue;
+        }
+        fds.push_back({client, POLLIN, 0});
+        buffers.emplace_back();
+      }
+    }
+  }
+
+  for (size_t i = 1; i < fds.size(); i++) {
+    ::close(fds[i].fd);
+  }
+}
+
+void Override_Server::stop() {
+  worker.request_stop();
+  bool stopped = worker.join_for(STOP_TIMEOUT);
+
+  if (listen_fd != -1 && stopped) {
+    ::close(listen_fd);
+    listen_fd = -1;
+    ::unlink(socket_path.c_str());
+  }
+}
+#endif
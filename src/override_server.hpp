@@ -0,0 +1,72 @@
+#pragma once
+#ifndef OVERRIDE_SERVER_HPP
+#define OVERRIDE_SERVER_HPP
+#include "presence_overrides.hpp"
+#include "worker_thread.hpp"
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// where other mods connect to send Override_Header messages
+// \\.\pipe\gdrpc-overrides on windows, $XDG_RUNTIME_DIR/gdrpc-overrides
+// (or the first of TMPDIR, TMP, TEMP, /tmp) elsewhere, same as discord's
+std::string override_server_path();
+
+// accepts any number of local clients and feeds their messages into the
+// overrides, a client sending anything malformed is disconnected
+class Override_Server {
+private:
+  static constexpr size_t MAX_CLIENTS = 8;
+  // how often the thread looks for a stop request
+  static constexpr std::chrono::milliseconds POLL_INTERVAL{50};
+  static constexpr std::chrono::milliseconds STOP_TIMEOUT{250};
+
+  Worker_Thread worker;
+
+#ifdef _WIN32
+  struct Pipe_Instance {
+    HANDLE pipe = INVALID_HANDLE_VALUE;
+    OVERLAPPED overlapped{};
+    // an operation was started and its event hasn't been handled yet
+    bool pending = false;
+    bool connected = false;
+    char chunk[1024];
+    std::string buffer;
+  };
+
+  std::vector<Pipe_Instance> instances;
+
+  // starts waiting for the next client on this instance
+  bool listen(Pipe_Instance &instance);
+#else
+  int listen_fd;
+  std::string socket_path;
+#endif
+
+  Presence_Overrides *overrides;
+  std::function<void()> on_change;
+
+  // handles every complete message at the front of buffer, returns false
+  // on a malformed one
+  bool consume(std::string &buffer);
+
+  void serve(Stop_Token token);
+
+public:
+  Override_Server();
+  ~Override_Server();
+
+  // on_change is called from the server thread whenever a message changes
+  // what the presence shows
+  // throws std::runtime_error if the pipe or socket can't be created
+  void start(Presence_Overrides &overrides, std::function<void()> on_change);
+  void stop();
+};
+
+#endif
@@ -0,0 +1,323 @@
+#include "play_history.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+constexpr char LOG_MAGIC[8] = {'G', 'D', 'R', 'P', 'C', 'P', 'L', 'Y'};
+constexpr char INDEX_MAGIC[8] = {'G', 'D', 'R', 'P', 'C', 'I', 'D', 'X'};
+constexpr uint32_t PLAY_HISTORY_VERSION = 1;
+
+struct Log_Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size;
+};
+
+struct Log_Record {
+  int64_t ended;
+  int32_t levelID;
+  uint32_t seconds;
+  int32_t attempts;
+  int8_t best_before;
+  int8_t best_after;
+  uint16_t reserved;
+  // of everything above
+  uint64_t checksum;
+};
+
+static_assert(sizeof(Log_Record) == 32, "records are written as is");
+
+namespace {
+uint64_t record_checksum(const Log_Record &record) {
+  return fnv1a(reinterpret_cast<const char *>(&record),
+               offsetof(Log_Record, checksum));
+}
+
+Play_Session from_record(const Log_Record &record) {
+  return {record.ended,      record.levelID,     record.seconds,
+          record.attempts,   record.best_before, record.best_after};
+}
+
+// calls on_session for each valid record, returns the size of the valid
+// part of the log, 0 if it has no valid header
+template <typename F>
+uint64_t read_log(const std::string &filename, F on_session) {
+  Mapped_File log;
+  if (!log.open(filename) || log.size() < sizeof(Log_Header)) {
+    return 0;
+  }
+
+  Log_Header header;
+  std::memcpy(&header, log.data(), sizeof(header));
+  if (std::memcmp(header.magic, LOG_MAGIC, sizeof(LOG_MAGIC)) != 0 ||
+      header.version != PLAY_HISTORY_VERSION ||
+      header.record_size != sizeof(Log_Record)) {
+    return 0;
+  }
+
+  uint64_t valid_size = sizeof(header);
+  while (log.size() - valid_size >= sizeof(Log_Record)) {
+    Log_Record record;
+    std::memcpy(&record, log.data() + valid_size, sizeof(record));
+    if (record.checksum != record_checksum(record)) {
+      // a torn append, nothing valid comes after it
+      break;
+    }
+
+    on_session(from_record(record));
+    valid_size += sizeof(record);
+  }
+
+  return valid_size;
+}
+
+uint32_t slot_hash(int32_t levelID) {
+  return static_cast<uint32_t>(
+      (static_cast<uint64_t>(static_cast<uint32_t>(levelID)) *
+       0x9E3779B97F4A7C15ull) >>
+      32);
+}
+} // namespace
+
+Play_History::Play_History(std::string log_filename,
+                           std::string index_filename)
+    : log_filename(log_filename), index_filename(index_filename),
+      log_size(0), playing_level(false), current{}, attempts_at_start(0) {}
+
+Play_History::Index_Header &Play_History::header() const {
+  return *reinterpret_cast<Index_Header *>(index.data());
+}
+
+Play_History::Index_Slot *Play_History::slots() const {
+  return reinterpret_cast<Index_Slot *>(index.data() + sizeof(Index_Header));
+}
+
+Play_History::Index_Slot *Play_History::find_slot(int32_t levelID) const {
+  // capacity is a power of two and the table is never more than half full,
+  // so this always finds the level or an empty slot
+  auto mask = header().capacity - 1;
+  for (auto i = slot_hash(levelID) & mask;; i = (i + 1) & mask) {
+    auto slot = slots() + i;
+    if (slot->levelID == levelID || slot->levelID == 0) {
+      return slot;
+    }
+  }
+}
+
+bool Play_History::create_index(uint32_t capacity) {
+  auto size = sizeof(Index_Header) + capacity * sizeof(Index_Slot);
+  if (!index.open(index_filename, size)) {
+    return false;
+  }
+
+  std::memset(index.data(), 0, size);
+
+  auto &index_header = header();
+  std::memcpy(index_header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+  index_header.version = PLAY_HISTORY_VERSION;
+  index_header.capacity = capacity;
+  // covers nothing until it's filled in
+  index_header.log_size = 0;
+  return true;
+}
+
+bool Play_History::reserve_slot() {
+  auto capacity = header().capacity;
+  if ((header().count + 1) * 2 <= capacity) {
+    return true;
+  }
+
+  std::vector<Index_Slot> used;
+  used.reserve(header().count);
+  for (uint32_t i = 0; i < capacity; i++) {
+    if (slots()[i].levelID != 0) {
+      used.push_back(slots()[i]);
+    }
+  }
+
+  index.close();
+  if (!create_index(capacity * 2)) {
+    return false;
+  }
+
+  for (const auto &slot : used) {
+    *find_slot(slot.levelID) = slot;
+  }
+  header().count = static_cast<uint32_t>(used.size());
+  header().log_size = log_size;
+  return true;
+}
+
+void Play_History::add_to_index(const Play_Session &session) {
+  auto slot = find_slot(session.levelID);
+  if (slot->levelID == 0) {
+    slot->levelID = session.levelID;
+    header().count++;
+  }
+
+  slot->sessions++;
+  slot->seconds += session.seconds;
+}
+
+bool Play_History::rebuild_index() {
+  // every record could be a different level
+  auto records = (log_size - std::min<uint64_t>(log_size, sizeof(Log_Header))) /
+                 sizeof(Log_Record);
+  uint32_t capacity = MIN_CAPACITY;
+  while (capacity < records * 2) {
+    capacity *= 2;
+  }
+
+  if (!create_index(capacity)) {
+    return false;
+  }
+
+  read_log(log_filename,
+           [this](const Play_Session &session) { add_to_index(session); });
+  header().log_size = log_size;
+  return true;
+}
+
+void Play_History::open() {
+  index.close();
+
+  log_size = read_log(log_filename, [](const Play_Session &) {});
+
+  std::error_code error;
+  auto file_size = std::filesystem::file_size(log_filename, error);
+  if (!error && file_size != log_size) {
+    // cut off a torn append, or a log that isn't ours at all
+    std::filesystem::resize_file(log_filename, log_size, error);
+  }
+
+  auto index_size = std::filesystem::file_size(index_filename, error);
+  if (!error && index_size >= sizeof(Index_Header) &&
+      index.open(index_filename, index_size)) {
+    const auto &index_header = header();
+    auto capacity = index_header.capacity;
+    bool valid =
+        std::memcmp(index_header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) ==
+            0 &&
+        index_header.version == PLAY_HISTORY_VERSION && capacity != 0 &&
+        (capacity & (capacity - 1)) == 0 &&
+        index_size == sizeof(Index_Header) + capacity * sizeof(Index_Slot) &&
+        index_header.count * 2 <= capacity &&
+        index_header.log_size == log_size;
+
+    if (valid) {
+      return;
+    }
+  }
+
+  index.close();
+  rebuild_index();
+}
+
+bool Play_History::append(const Play_Session &session) {
+  std::ofstream log(log_filename, std::ios::binary | std::ios::app);
+
+  if (log_size == 0) {
+    Log_Header log_header;
+    std::memcpy(log_header.magic, LOG_MAGIC, sizeof(LOG_MAGIC));
+    log_header.version = PLAY_HISTORY_VERSION;
+    log_header.record_size = sizeof(Log_Record);
+    log.write(reinterpret_cast<const char *>(&log_header), sizeof(log_header));
+  }
+
+  Log_Record record{};
+  record.ended = session.ended;
+  record.levelID = session.levelID;
+  record.seconds = session.seconds;
+  record.attempts = session.attempts;
+  record.best_before = session.best_before;
+  record.best_after = session.best_after;
+  record.checksum = record_checksum(record);
+  log.write(reinterpret_cast<const char *>(&record), sizeof(record));
+  log.flush();
+
+  if (!log) {
+    return false;
+  }
+
+  log_size = (log_size == 0 ? sizeof(Log_Header) : log_size) + sizeof(record);
+  return true;
+}
+
+void Play_History::playing(int levelID, int attempts, int best) {
+  if (levelID <= 0) {
+    stopped();
+    return;
+  }
+
+  if (playing_level && current.levelID != levelID) {
+    stopped();
+  }
+
+  auto now = clock::now();
+  if (!playing_level) {
+    playing_level = true;
+    started = now;
+    attempts_at_start = attempts;
+    current = {};
+    current.levelID = levelID;
+    current.best_before = static_cast<int8_t>(best);
+  }
+
+  last_seen = now;
+  current.attempts = attempts - attempts_at_start;
+  current.best_after = static_cast<int8_t>(best);
+}
+
+void Play_History::stopped() {
+  if (!playing_level) {
+    return;
+  }
+  playing_level = false;
+
+  current.seconds = static_cast<uint32_t>(
+      std::chrono::duration_cast<std::chrono::seconds>(last_seen - started)
+          .count());
+  current.ended = static_cast<int64_t>(std::time(nullptr));
+
+  if (!append(current) || !index.data()) {
+    return;
+  }
+
+  // the table only counts as up to date once log_size matches again
+  if (reserve_slot()) {
+    add_to_index(current);
+    header().log_size = log_size;
+  }
+}
+
+bool Play_History::lookup(int levelID, Play_Stats &stats) const {
+  if (levelID <= 0 || !index.data()) {
+    return false;
+  }
+
+  auto slot = find_slot(levelID);
+  if (slot->levelID == 0) {
+    return false;
+  }
+
+  stats.sessions = slot->sessions;
+  stats.seconds = slot->seconds;
+  return true;
+}
+
+std::string format_play_time(uint64_t seconds) {
+  auto minutes = seconds / 60;
+  if (minutes < 60) {
+    return std::to_string(minutes) + "m";
+  }
+
+  auto hours = minutes / 60;
+  minutes %= 60;
+  return std::to_string(hours) + "h " + (minutes < 10 ? "0" : "") +
+         std::to_string(minutes) + "m";
+}
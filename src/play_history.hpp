@@ -0,0 +1,107 @@
+#pragma once
+#ifndef PLAY_HISTORY_HPP
+#define PLAY_HISTORY_HPP
+#include "mapped_file.hpp"
+#include "snapshot_io.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+struct Play_Session {
+  int64_t ended;
+  int32_t levelID;
+  uint32_t seconds;
+  // attempts made during the session
+  int32_t attempts;
+  int8_t best_before;
+  int8_t best_after;
+};
+
+struct Play_Stats {
+  uint32_t sessions = 0;
+  uint64_t seconds = 0;
+};
+
+// every time a level was played
+// sessions are appended to a log of checksummed records, and totals per
+// level are kept in a memory mapped open addressing table next to it, so a
+// lookup touches one or two slots no matter how many levels were played
+// the table can always be rebuilt from the log, which happens whenever the
+// two don't agree
+class Play_History {
+private:
+  typedef std::chrono::steady_clock clock;
+
+  static constexpr uint32_t MIN_CAPACITY = 1024;
+
+  struct Index_Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t count;
+    uint32_t reserved;
+    // how much of the log the table covers
+    uint64_t log_size;
+  };
+
+  struct Index_Slot {
+    // 0 for an empty slot, local levels are never recorded
+    int32_t levelID;
+    uint32_t sessions;
+    uint64_t seconds;
+  };
+
+  std::string log_filename;
+  std::string index_filename;
+
+  Writable_Mapped_File index;
+
+  // valid bytes in the log, appends go after this
+  uint64_t log_size;
+
+  // the session in progress
+  bool playing_level;
+  Play_Session current;
+  int attempts_at_start;
+  clock::time_point started;
+  clock::time_point last_seen;
+
+  Index_Header &header() const;
+  Index_Slot *slots() const;
+
+  // slot holding the level, or the empty slot it would go in
+  Index_Slot *find_slot(int32_t levelID) const;
+
+  // maps a fresh table, empty apart from the header
+  bool create_index(uint32_t capacity);
+  // doubles the capacity if the table is half full
+  bool reserve_slot();
+  void add_to_index(const Play_Session &session);
+
+  // replays the whole log into a new table
+  bool rebuild_index();
+
+  bool append(const Play_Session &session);
+
+public:
+  Play_History(std::string log_filename = "gdrpc_play_history.log",
+               std::string index_filename = "gdrpc_play_history.idx");
+
+  void open();
+
+  // called by the loop while a level is open, with the level's counters
+  // starts a new session if the level changed
+  void playing(int levelID, int attempts, int best);
+  // finishes the session in progress, if any
+  void stopped();
+
+  // totals over the finished sessions of a level
+  // returns false if it was never played
+  bool lookup(int levelID, Play_Stats &stats) const;
+};
+
+// "2h 05m", "14m", "0m"
+std::string format_play_time(uint64_t seconds);
+
+#endif
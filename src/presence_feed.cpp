@@ -0,0 +1,234 @@
+#include "presence_feed.hpp"
+#include "discord_ipc.hpp"
+#include "presence_frame.hpp"
+#include "worker_thread.hpp"
+
+#include <chrono>
+#include <iterator>
+#include <stdexcept>
+
+#include <fmt/format.h>
+#include <httplib.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+// sent when nothing changed, so proxies don't drop the connection
+constexpr std::chrono::seconds KEEPALIVE{15};
+
+const char *state_name(Feed_State state) {
+  switch (state) {
+  case Feed_State::level:
+    return "level";
+  case Feed_State::editor:
+    return "editor";
+  case Feed_State::away:
+    return "away";
+  case Feed_State::menu:
+  default:
+    return "menu";
+  }
+}
+} // namespace
+
+void copy_feed_text(char (&field)[FEED_TEXT_SIZE], const char *text,
+                    size_t size) {
+  size = utf8_truncate(text, size, FEED_TEXT_SIZE - 1);
+  std::memcpy(field, text, size);
+  std::memset(field + size, 0, FEED_TEXT_SIZE - size);
+}
+
+Presence_Feed::Presence_Feed()
+    :
+#ifdef _WIN32
+      mapping(nullptr),
+#else
+      mapping(-1),
+#endif
+      segment(nullptr), has_last(false), event_id(0), stopping(false) {
+}
+
+Presence_Feed::~Presence_Feed() { close(); }
+
+#ifdef _WIN32
+void Presence_Feed::open() {
+  mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                               0, sizeof(Presence_Feed_Segment),
+                               PRESENCE_FEED_NAME);
+  if (mapping == nullptr) {
+    throw std::runtime_error("could not create the presence feed mapping");
+  }
+
+  segment = static_cast<Presence_Feed_Segment *>(MapViewOfFile(
+      mapping, FILE_MAP_WRITE, 0, 0, sizeof(Presence_Feed_Segment)));
+  if (segment == nullptr) {
+    CloseHandle(mapping);
+    mapping = nullptr;
+    throw std::runtime_error("could not map the presence feed");
+  }
+#else
+void Presence_Feed::open() {
+  mapping = shm_open(PRESENCE_FEED_NAME, O_RDWR | O_CREAT, 0644);
+  if (mapping == -1 ||
+      ftruncate(mapping, sizeof(Presence_Feed_Segment)) == -1) {
+    close();
+    throw std::runtime_error("could not create the presence feed segment");
+  }
+
+  auto mapped = mmap(nullptr, sizeof(Presence_Feed_Segment),
+                     PROT_READ | PROT_WRITE, MAP_SHARED, mapping, 0);
+  if (mapped == MAP_FAILED) {
+    close();
+    throw std::runtime_error("could not map the presence feed");
+  }
+  segment = static_cast<Presence_Feed_Segment *>(mapped);
+#endif
+
+  // left odd until there's something to read
+  segment->sequence.store(1, std::memory_order_relaxed);
+  segment->magic = PRESENCE_FEED_MAGIC;
+  segment->version = PRESENCE_FEED_VERSION;
+  segment->snapshot_size = sizeof(Presence_Snapshot);
+  has_last = false;
+}
+
+void Presence_Feed::start_stream(int port) {
+  server = std::make_unique<httplib::Server>();
+  server->Get("/presence", [this](const httplib::Request &,
+                                  httplib::Response &res) {
+    res.set_header("Cache-Control", "no-cache");
+    res.set_header("Access-Control-Allow-Origin", "*");
+
+    // the first call sends whatever is current, later ones wait for news
+    auto sent = std::make_shared<uint64_t>(0);
+    res.set_chunked_content_provider(
+        "text/event-stream", [this, sent](size_t, httplib::DataSink &sink) {
+          std::unique_lock<std::mutex> lock(event_mutex);
+          event_cv.wait_for(lock, KEEPALIVE, [this, sent]() {
+            return stopping || event_id != *sent;
+          });
+
+          if (stopping) {
+            return false;
+          }
+
+          if (event_id == *sent) {
+            return sink.write(": keepalive\n\n", 13);
+          }
+
+          *sent = event_id;
+          auto message = event;
+          lock.unlock();
+          return sink.write(message.data(), message.size());
+        });
+  });
+
+  // localhost only, same as the metrics endpoint
+  if (!server->bind_to_port("127.0.0.1", port)) {
+    server.reset();
+    throw std::runtime_error("could not bind presence stream to port " +
+                             std::to_string(port));
+  }
+
+  auto listening = server.get();
+  listener.start([listening](Stop_Token) { listening->listen_after_bind(); });
+}
+
+void Presence_Feed::close() {
+  {
+    std::lock_guard<std::mutex> lock(event_mutex);
+    stopping = true;
+  }
+  event_cv.notify_all();
+
+  if (server) {
+    server->stop();
+    if (listener.join_for(STOP_TIMEOUT)) {
+      server.reset();
+    } else {
+      // a client is still being written to, the server goes with the
+      // process
+      server.release();
+    }
+  }
+
+#ifdef _WIN32
+  if (segment != nullptr) {
+    UnmapViewOfFile(segment);
+    segment = nullptr;
+  }
+  if (mapping != nullptr) {
+    CloseHandle(mapping);
+    mapping = nullptr;
+  }
+#else
+  if (segment != nullptr) {
+    munmap(segment, sizeof(Presence_Feed_Segment));
+    segment = nullptr;
+  }
+  if (mapping != -1) {
+    ::close(mapping);
+    shm_unlink(PRESENCE_FEED_NAME);
+    mapping = -1;
+  }
+#endif
+}
+
+void Presence_Feed::publish(const Presence_Snapshot &snapshot) {
+  if (has_last && std::memcmp(&last, &snapshot, sizeof(snapshot)) == 0) {
+    return;
+  }
+  last = snapshot;
+  has_last = true;
+
+  if (segment != nullptr) {
+    // this is the only writer, so a plain increment is enough
+    auto sequence = segment->sequence.load(std::memory_order_relaxed);
+    segment->sequence.store(sequence | 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    std::memcpy(&segment->snapshot, &snapshot, sizeof(snapshot));
+
+    segment->sequence.store((sequence | 1) + 1, std::memory_order_release);
+  }
+
+  if (server) {
+    publish_event(snapshot);
+  }
+}
+
+void Presence_Feed::publish_event(const Presence_Snapshot &snapshot) {
+  std::string json = "{\"state\":";
+  append_json_string(json, state_name(snapshot.state));
+  fmt::format_to(std::back_inserter(json),
+                 ",\"level_id\":{},\"best\":{},\"attempts\":{},\"stars\":{},"
+                 "\"rank\":{},\"timestamp\":{}",
+                 snapshot.level_id, snapshot.best, snapshot.attempts,
+                 snapshot.stars, snapshot.rank, snapshot.timestamp);
+
+  auto field = [&json](const char *name, const char *text) {
+    json += ",\"";
+    json += name;
+    json += "\":";
+    append_json_string(json, text);
+  };
+  field("level_name", snapshot.level_name);
+  field("author", snapshot.author);
+  field("details", snapshot.details);
+  field("state_text", snapshot.state_text);
+  field("large_text", snapshot.large_text);
+  field("small_text", snapshot.small_text);
+  field("small_image", snapshot.small_image);
+  json += '}';
+
+  {
+    std::lock_guard<std::mutex> lock(event_mutex);
+    event_id++;
+    event = fmt::format("id: {}\ndata: {}\n\n", event_id, json);
+  }
+  event_cv.notify_all();
+}
@@ -0,0 +1,145 @@
+#pragma once
+#ifndef PRESENCE_FEED_HPP
+#define PRESENCE_FEED_HPP
+
+#include "worker_thread.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// everything here up to Presence_Feed is all a reader needs, see
+// examples/presence_feed_reader.cpp
+
+#ifdef _WIN32
+constexpr auto PRESENCE_FEED_NAME = "Local\\gdrpc_presence";
+#else
+constexpr auto PRESENCE_FEED_NAME = "/gdrpc_presence";
+#endif
+
+constexpr uint32_t PRESENCE_FEED_MAGIC = 0x43505247; // GRPC
+constexpr uint32_t PRESENCE_FEED_VERSION = 1;
+
+constexpr size_t FEED_TEXT_SIZE = 129;
+
+enum class Feed_State : int32_t { menu, level, editor, away };
+
+// what the overlay gets, text is null terminated utf-8
+struct Presence_Snapshot {
+  Feed_State state;
+  // the rest of the level fields are 0 outside of levels and the editor
+  int32_t level_id;
+  int32_t best;
+  int32_t attempts;
+  int32_t stars;
+  // the player's global rank, -1 if unknown
+  int32_t rank;
+  // when the current presence started, unix seconds
+  int64_t timestamp;
+
+  char level_name[FEED_TEXT_SIZE];
+  char author[FEED_TEXT_SIZE];
+
+  // the presence exactly as sent to discord
+  char details[FEED_TEXT_SIZE];
+  char state_text[FEED_TEXT_SIZE];
+  char large_text[FEED_TEXT_SIZE];
+  char small_text[FEED_TEXT_SIZE];
+  char small_image[FEED_TEXT_SIZE];
+};
+
+// layout of the shared memory segment
+// sequence is odd while the snapshot is being written, readers copy the
+// snapshot and retry if sequence was odd or changed in the meantime
+struct Presence_Feed_Segment {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t snapshot_size;
+  std::atomic<uint32_t> sequence;
+  Presence_Snapshot snapshot;
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free,
+              "the sequence is shared between processes");
+
+// copies out a consistent snapshot without locking or syscalls
+// returns false if the writer was busy for every try
+inline bool read_presence_feed(const Presence_Feed_Segment &segment,
+                               Presence_Snapshot &snapshot,
+                               uint32_t &sequence, int tries = 64) {
+  for (int i = 0; i < tries; i++) {
+    auto before = segment.sequence.load(std::memory_order_acquire);
+    if (before & 1) {
+      continue;
+    }
+
+    std::memcpy(&snapshot, &segment.snapshot, sizeof(snapshot));
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    if (segment.sequence.load(std::memory_order_relaxed) == before) {
+      sequence = before;
+      return true;
+    }
+  }
+  return false;
+}
+
+namespace httplib {
+class Server;
+}
+
+// single writer side, owned by the loop
+// publishes into shared memory and, if a port is given, streams the same
+// snapshots as server sent events on http://127.0.0.1:<port>/presence
+class Presence_Feed {
+private:
+#ifdef _WIN32
+  HANDLE mapping;
+#else
+  int mapping;
+#endif
+  Presence_Feed_Segment *segment;
+
+  Presence_Snapshot last;
+  bool has_last;
+
+  // the stream, each client waits for a newer event than it last sent
+  static constexpr std::chrono::milliseconds STOP_TIMEOUT{250};
+  std::unique_ptr<httplib::Server> server;
+  Worker_Thread listener;
+  std::mutex event_mutex;
+  std::condition_variable event_cv;
+  std::string event;
+  uint64_t event_id;
+  bool stopping;
+
+  void publish_event(const Presence_Snapshot &snapshot);
+
+public:
+  Presence_Feed();
+  ~Presence_Feed();
+
+  // throws std::runtime_error if the segment can't be created
+  void open();
+  // throws std::runtime_error if the port can't be bound
+  void start_stream(int port);
+  void close();
+
+  // does nothing if the snapshot is the same as the last one
+  void publish(const Presence_Snapshot &snapshot);
+};
+
+// "text" into a snapshot field, cut off at a character boundary
+void copy_feed_text(char (&field)[FEED_TEXT_SIZE], const char *text,
+                    size_t size);
+
+#endif
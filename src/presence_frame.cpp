@@ -0,0 +1,56 @@
+#include "presence_frame.hpp"
+
+size_t utf8_truncate(const char *text, size_t size, size_t limit) {
+  if (size <= limit) {
+    return size;
+  }
+
+  // find where the last sequence before the limit starts
+  auto end = limit;
+  while (end > 0 && (static_cast<unsigned char>(text[end - 1]) & 0xC0) == 0x80) {
+    end--;
+  }
+
+  if (end == 0) {
+    return 0;
+  }
+
+  auto lead = static_cast<unsigned char>(text[end - 1]);
+  size_t sequence_length = 1;
+  if ((lead & 0xE0) == 0xC0) {
+    sequence_length = 2;
+  } else if ((lead & 0xF0) == 0xE0) {
+    sequence_length = 3;
+  } else if ((lead & 0xF8) == 0xF0) {
+    sequence_length = 4;
+  }
+
+  // drop the whole sequence if it doesn't fit
+  if (end - 1 + sequence_length > limit) {
+    return end - 1;
+  }
+  return limit;
+}
+
+Presence_Field::Presence_Field() : length(0) { data[0] = '\0'; }
+
+void Presence_Field::assign(const char *text, size_t size) {
+  length = utf8_truncate(text, size, PRESENCE_FIELD_SIZE);
+  std::memcpy(data.data(), text, length);
+  data[length] = '\0';
+}
+
+void Presence_Field::assign(const std::string &text) {
+  assign(text.data(), text.size());
+}
+
+bool Presence_Field::operator==(const Presence_Field &other) const {
+  return length == other.length &&
+         std::memcmp(data.data(), other.data.data(), length) == 0;
+}
+
+bool PresenceFrame::operator==(const PresenceFrame &other) const {
+  return timestamp == other.timestamp && details == other.details &&
+         state == other.state && large_text == other.large_text &&
+         small_text == other.small_text && small_image == other.small_image;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#ifndef PRESENCE_FRAME_HPP
+#define PRESENCE_FRAME_HPP
+
+#include <array>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <utility>
+
+#include <fmt/format.h>
+
+// discord rejects any text field longer than this
+constexpr size_t PRESENCE_FIELD_SIZE = 128;
+
+// returns the longest prefix of text no longer than limit that doesn't cut a
+// utf-8 sequence in half
+size_t utf8_truncate(const char *text, size_t size, size_t limit);
+
+// fixed size, null terminated text for a single presence field
+class Presence_Field {
+private:
+  std::array<char, PRESENCE_FIELD_SIZE + 1> data;
+  size_t length;
+
+public:
+  Presence_Field();
+
+  void assign(const char *text, size_t size);
+  void assign(const std::string &text);
+
+  // formats straight into the field, truncating on overflow
+  // throws fmt::format_error like fmt::format does
+  template <typename... Args>
+  void format(const std::string &format_string, Args &&...args) {
+    auto result = fmt::format_to_n(data.data(), PRESENCE_FIELD_SIZE,
+                                   format_string, std::forward<Args>(args)...);
+    length = utf8_truncate(data.data(), result.size, PRESENCE_FIELD_SIZE);
+    data[length] = '\0';
+  }
+
+  const char *c_str() const { return data.data(); }
+  size_t size() const { return length; }
+  bool empty() const { return length == 0; }
+
+  bool operator==(const Presence_Field &other) const;
+  bool operator!=(const Presence_Field &other) const {
+    return !(*this == other);
+  }
+};
+
+struct PresenceFrame {
+  Presence_Field details;
+  Presence_Field state;
+  Presence_Field large_text;
+  Presence_Field small_text;
+  Presence_Field small_image;
+  std::time_t timestamp = 0;
+
+  bool operator==(const PresenceFrame &other) const;
+  bool operator!=(const PresenceFrame &other) const {
+    return !(*this == other);
+  }
+};
+
+#endif
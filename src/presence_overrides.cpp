@@ -0,0 +1,98 @@
+#include "presence_overrides.hpp"
+
+#include <algorithm>
+
+bool Presence_Overrides::set(Override_Field field, uint8_t priority,
+                             std::chrono::milliseconds ttl, const char *text,
+                             size_t size) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto &overrides = fields.at(static_cast<size_t>(field));
+
+  auto existing = std::find_if(
+      overrides.begin(), overrides.end(),
+      [priority](const Override &entry) { return entry.priority == priority; });
+  bool was_shown = existing == overrides.begin() && existing != overrides.end();
+
+  if (size == 0) {
+    if (existing == overrides.end()) {
+      return false;
+    }
+    overrides.erase(existing);
+    return was_shown;
+  }
+
+  Override entry;
+  entry.priority = priority;
+  entry.expires = ttl.count() == 0 ? clock::time_point::max()
+                                   : clock::now() + ttl;
+  entry.text.assign(text, size);
+
+  if (existing != overrides.end()) {
+    bool same_text = existing->text == entry.text;
+    *existing = entry;
+    return was_shown && !same_text;
+  }
+
+  auto position = std::find_if(
+      overrides.begin(), overrides.end(),
+      [priority](const Override &other) { return other.priority < priority; });
+  bool shown = position == overrides.begin();
+  bool same_text = shown && !overrides.empty() &&
+                   overrides.front().text == entry.text;
+  overrides.insert(position, entry);
+  return shown && !same_text;
+}
+
+bool Presence_Overrides::expire(clock::time_point now) {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  bool changed = false;
+  for (auto &overrides : fields) {
+    if (overrides.empty()) {
+      continue;
+    }
+
+    auto shown = overrides.front().text;
+    overrides.erase(std::remove_if(overrides.begin(), overrides.end(),
+                                   [now](const Override &entry) {
+                                     return entry.expires <= now;
+                                   }),
+                    overrides.end());
+
+    if (overrides.empty() || overrides.front().text != shown) {
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+Presence_Overrides::clock::duration
+Presence_Overrides::until_next_expiry(clock::time_point now) const {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  auto next = clock::time_point::max();
+  for (const auto &overrides : fields) {
+    for (const auto &entry : overrides) {
+      next = std::min(next, entry.expires);
+    }
+  }
+
+  if (next == clock::time_point::max()) {
+    return clock::duration::max();
+  }
+  return next > now ? next - now : clock::duration::zero();
+}
+
+void Presence_Overrides::apply(PresenceFrame &frame) const {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  std::array<Presence_Field *, static_cast<size_t>(Override_Field::count)>
+      targets{&frame.details, &frame.state, &frame.large_text,
+              &frame.small_text, &frame.small_image};
+
+  for (size_t i = 0; i < fields.size(); i++) {
+    if (!fields[i].empty()) {
+      *targets[i] = fields[i].front().text;
+    }
+  }
+}
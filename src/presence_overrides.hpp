@@ -0,0 +1,70 @@
+#pragma once
+#ifndef PRESENCE_OVERRIDES_HPP
+#define PRESENCE_OVERRIDES_HPP
+#include "presence_frame.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+enum class Override_Field : uint8_t {
+  details,
+  state,
+  large_text,
+  small_text,
+  small_image,
+  count
+};
+
+// every message sent to the override server is this header, little endian,
+// followed by size bytes of utf-8 text
+// an empty text takes back the override at that field and priority
+struct Override_Header {
+  uint8_t field;
+  // higher wins, the presence gdrpc renders itself is below all of them
+  uint8_t priority;
+  uint16_t size;
+  // how long the override lasts, 0 for as long as gdrpc runs
+  uint32_t ttl_ms;
+};
+
+static_assert(sizeof(Override_Header) == 8, "sent as is");
+
+constexpr size_t MAX_OVERRIDE_SIZE = PRESENCE_FIELD_SIZE;
+
+// text other mods asked to show instead of what gdrpc renders
+// written from the override server, read from the loop
+class Presence_Overrides {
+private:
+  typedef std::chrono::steady_clock clock;
+
+  struct Override {
+    uint8_t priority;
+    // time_point::max() if it never expires
+    clock::time_point expires;
+    Presence_Field text;
+  };
+
+  mutable std::mutex mutex;
+  // highest priority first
+  std::array<std::vector<Override>, static_cast<size_t>(Override_Field::count)>
+      fields;
+
+public:
+  // returns true if this changes what the field shows
+  bool set(Override_Field field, uint8_t priority,
+           std::chrono::milliseconds ttl, const char *text, size_t size);
+
+  // drops expired overrides, returns true if that changed what is shown
+  bool expire(clock::time_point now);
+
+  // how long until the next override expires, max() if none will
+  clock::duration until_next_expiry(clock::time_point now) const;
+
+  // puts the winning overrides into the frame
+  void apply(PresenceFrame &frame) const;
+};
+
+#endif
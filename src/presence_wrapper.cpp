@@ -1,71 +1,267 @@
 #include "presence_wrapper.hpp"
 
+#ifdef _WIN32
+#define current_pid() GetCurrentProcessId()
+#else
+#include <unistd.h>
+#define current_pid() getpid()
+#endif
+
 Discord_Presence global_discord = Discord_Presence();
 
 Discord_Presence *get_discord() { return &global_discord; }
 
-// this weird structure is necessary due to how discord-rpc handles this
-static void handleDiscordReady(const DiscordUser *connectedUser) {
-  get_discord()->set_status(0); // success is code of 0
+// discord only ever sends flat enough json that this is all we need
+// returns the value of the first matching key, unquoted
+std::string find_json_value(const std::string &json, const char *key) {
+  auto quoted_key = std::string("\"") + key + "\"";
+  auto position = json.find(quoted_key);
+  if (position == std::string::npos) {
+    return "";
+  }
+
+  position = json.find_first_not_of(" \t\r\n:", position + quoted_key.size());
+  if (position == std::string::npos) {
+    return "";
+  }
+
+  if (json.at(position) == '"') {
+    auto end = json.find('"', position + 1);
+    return json.substr(position + 1, end - position - 1);
+  }
+
+  auto end = json.find_first_of(",}] \t\r\n", position);
+  return json.substr(position, end - position);
+}
+
+void append_optional(std::string &out, const char *key, const char *value,
+                     bool &first) {
+  if (value == nullptr || value[0] == '\0') {
+    return;
+  }
+
+  if (!first) {
+    out.push_back(',');
+  }
+  first = false;
+
+  append_json_string(out, key);
+  out.push_back(':');
+  append_json_string(out, value);
+}
+
+const char *discord_state_name(Discord_State state) {
+  switch (state) {
+  case Discord_State::disconnected:
+    return "disconnected";
+  case Discord_State::connecting:
+    return "connecting";
+  case Discord_State::ready:
+    return "ready";
+  case Discord_State::errored:
+    return "errored";
+  }
+  return "unknown";
 }
 
-static void handleDiscordDisconnected(int errcode, const char *message) {
-  get_discord()->set_status(errcode);
+Discord_Presence::Discord_Presence()
+    : Discord_Presence(std::make_unique<Discord_Ipc>()) {}
+
+Discord_Presence::Discord_Presence(std::unique_ptr<Ipc_Transport> transport)
+    : state(Discord_State::disconnected), status(-1),
+      ipc(std::move(transport)), nonce(0),
+      min_backoff(std::chrono::seconds(1)),
+      max_backoff(std::chrono::seconds(60)), failed_attempts(0) {}
+
+void Discord_Presence::initialize(const char *n_application_id,
+                                  clock::time_point now) {
+  application_id = n_application_id;
+  failed_attempts = 0;
+  try_connect(now);
 }
 
-static void handleDiscordError(int errcode, const char *message) {
-  get_discord()->set_status(errcode);
+void Discord_Presence::set_state(Discord_State n_state) { state = n_state; }
+
+void Discord_Presence::try_connect(clock::time_point now) {
+  if (!ipc->connect()) {
+    connection_lost(Discord_State::disconnected, now);
+    return;
+  }
+
+  payload.clear();
+  payload.append("{\"v\":1,\"client_id\":");
+  append_json_string(payload, application_id.c_str());
+  payload.push_back('}');
+
+  connect_started = now;
+  set_state(Discord_State::connecting);
+  if (!ipc->send(Ipc_Opcode::handshake, payload)) {
+    connection_lost(Discord_State::disconnected, now);
+  }
 }
 
-static void handleDiscordJoinGame(const char *secret) { return; }
+void Discord_Presence::connection_lost(Discord_State n_state,
+                                       clock::time_point now) {
+  ipc->disconnect();
+  set_state(n_state);
 
-static void handleDiscordSpectateGame(const char *secret) { return; }
+  // 1s, 2s, 4s, ... so a closed discord isn't polled every loop
+  auto delay = min_backoff;
+  for (int i = 0; i < failed_attempts && delay < max_backoff; i++) {
+    delay *= 2;
+  }
+  if (delay > max_backoff) {
+    delay = max_backoff;
+  }
 
-static void handleDiscordJoinRequest(const DiscordUser *request) {
-  Discord_Respond(request->userId, DISCORD_REPLY_NO);
+  failed_attempts++;
+  next_connect = now + delay;
 }
 
-Discord_Presence::Discord_Presence() : status(-1) {}
+void Discord_Presence::handle_frame(Ipc_Opcode opcode,
+                                    clock::time_point now) {
+  switch (opcode) {
+  case Ipc_Opcode::ping:
+    ipc->send(Ipc_Opcode::pong, response);
+    break;
+  case Ipc_Opcode::close: {
+    auto code = find_json_value(response, "code");
+    set_status(code.empty() ? -1 : std::atoi(code.c_str()));
+    connection_lost(Discord_State::errored, now);
+    break;
+  }
+  case Ipc_Opcode::frame: {
+    auto event = find_json_value(response, "evt");
+    if (event == "READY") {
+      set_state(Discord_State::ready);
+      set_status(0); // success is code of 0
+      failed_attempts = 0;
 
-void Discord_Presence::initialize(const char *application_id) {
-  DiscordEventHandlers handlers;
-  std::memset(&handlers, 0, sizeof(handlers));
-  handlers.ready = handleDiscordReady;
-  handlers.errored = handleDiscordError;
-  handlers.disconnected = handleDiscordDisconnected;
-  handlers.joinGame = handleDiscordJoinGame;
-  handlers.spectateGame = handleDiscordSpectateGame;
-  handlers.joinRequest = handleDiscordJoinRequest;
+      // discord forgets the activity when it restarts, so always resend it
+      if (!latest_presence.empty()) {
+        ipc->send(Ipc_Opcode::frame, latest_presence);
+      }
+    } else if (event == "ERROR") {
+      auto code = find_json_value(response, "code");
+      set_status(code.empty() ? -1 : std::atoi(code.c_str()));
 
-  Discord_Initialize(application_id, &handlers, 1, "322170");
+      // once ready, errors are about a single command and not the connection
+      if (state == Discord_State::connecting) {
+        connection_lost(Discord_State::errored, now);
+      }
+    }
+    break;
+  }
+  default:
+    break;
+  }
 }
 
+Discord_State Discord_Presence::get_state() { return state; }
+
 int Discord_Presence::get_status() { return status; }
 
 void Discord_Presence::set_status(int n_status) { status = n_status; }
 
+void Discord_Presence::set_backoff(std::chrono::milliseconds min,
+                                   std::chrono::milliseconds max) {
+  min_backoff = min;
+  max_backoff = max;
+}
+
+Discord_Presence::clock::duration
+Discord_Presence::until_next_attempt(clock::time_point now) {
+  switch (state) {
+  case Discord_State::ready:
+    return clock::duration::max();
+  case Discord_State::connecting:
+    return CONNECT_POLL;
+  default:
+    return next_connect > now ? next_connect - now : clock::duration::zero();
+  }
+}
+
 void Discord_Presence::update(const char *details, const char *largeText,
                               const char *smallText, const char *statetext,
                               const char *smallImage, std::time_t timestamp) {
-  DiscordRichPresence discordPresence;
-  std::memset(&discordPresence, 0, sizeof(discordPresence));
+  payload.clear();
+  payload.append("{\"cmd\":\"SET_ACTIVITY\",\"args\":{\"pid\":");
+  payload.append(std::to_string(current_pid()));
+  payload.append(",\"activity\":{");
+
+  bool first = true;
+  append_optional(payload, "state", statetext, first);
+  append_optional(payload, "details", details, first);
 
-  if (std::strlen(statetext) != 0) {
-    discordPresence.state = statetext;
+  if (!first) {
+    payload.push_back(',');
   }
+  payload.append("\"timestamps\":{\"start\":");
+  payload.append(std::to_string(static_cast<long long>(timestamp)));
+  payload.append("},\"assets\":{");
 
-  discordPresence.details = details;
-  discordPresence.startTimestamp = timestamp;
-  discordPresence.largeImageKey = "logo";
-  discordPresence.largeImageText = largeText;
+  bool first_asset = true;
+  append_optional(payload, "large_image", "logo", first_asset);
+  append_optional(payload, "large_text", largeText, first_asset);
 
   if (std::strcmp(smallImage, "none") != 0) {
-    discordPresence.smallImageKey = smallImage;
-    discordPresence.smallImageText = smallText;
+    append_optional(payload, "small_image", smallImage, first_asset);
+    append_optional(payload, "small_text", smallText, first_asset);
+  }
+
+  payload.append("},\"instance\":false}},\"nonce\":\"");
+  payload.append(std::to_string(++nonce));
+  payload.append("\"}");
+
+  latest_presence.assign(payload);
+  if (state == Discord_State::ready) {
+    ipc->send(Ipc_Opcode::frame, latest_presence);
   }
-  Discord_UpdatePresence(&discordPresence);
 }
 
-void Discord_Presence::run_callbacks() { Discord_RunCallbacks(); }
+void Discord_Presence::run_callbacks(clock::time_point now) {
+  if (!ipc->is_connected()) {
+    if (application_id.empty()) {
+      // never initialized, or shut down
+      return;
+    }
+
+    if (state == Discord_State::ready || state == Discord_State::connecting) {
+      // a failed send dropped the pipe since the last call
+      connection_lost(Discord_State::disconnected, now);
+    }
+
+    if (now >= next_connect) {
+      try_connect(now);
+    }
+    return;
+  }
+
+  try {
+    ipc->flush();
 
-void Discord_Presence::shutdown() { Discord_Shutdown(); }
\ No newline at end of file
+    Ipc_Opcode opcode;
+    while (ipc->is_connected() && ipc->receive(opcode, response)) {
+      handle_frame(opcode, now);
+    }
+  } catch (const std::exception &) {
+    // the pipe broke, discord probably closed
+    set_status(-1);
+  }
+
+  if (!ipc->is_connected()) {
+    if (state == Discord_State::ready || state == Discord_State::connecting) {
+      connection_lost(Discord_State::disconnected, now);
+    }
+  } else if (state == Discord_State::connecting &&
+             now - connect_started >= CONNECT_TIMEOUT) {
+    // something is holding the pipe open but isn't answering
+    connection_lost(Discord_State::errored, now);
+  }
+}
+
+void Discord_Presence::shutdown() {
+  ipc->disconnect();
+  set_state(Discord_State::disconnected);
+  application_id.clear();
+}
@@ -1,27 +1,87 @@
 #pragma once
-#pragma comment(lib, "discord-rpc.lib")
+#include "discord_ipc.hpp"
 
-#include <discord_rpc.h>
+#include <chrono>
 #include <ctime>
 #include <cstring>
+#include <memory>
+#include <string>
 
 #ifndef DRPWRAP
 #define DRPWRAP
 
+// disconnected: no pipe, waiting out the backoff before trying again
+// connecting: pipe open and handshake sent, waiting for READY
+// ready: presence updates go straight to discord
+// errored: discord refused us or never answered, waiting out the backoff
+enum class Discord_State { disconnected, connecting, ready, errored };
+
+const char *discord_state_name(Discord_State state);
+
 class Discord_Presence {
+public:
+  typedef std::chrono::steady_clock clock;
+
 private:
+  // discord takes well under a second to answer when it's up
+  static constexpr std::chrono::seconds CONNECT_TIMEOUT{10};
+  // how often to check for READY while connecting
+  static constexpr std::chrono::milliseconds CONNECT_POLL{100};
+
+  Discord_State state;
+  // the last close or error code, 0 once ready and -1 if we never got one
   int status;
 
+  std::unique_ptr<Ipc_Transport> ipc;
+  std::string application_id;
+
+  // reused for every message, so updates don't allocate once warmed up
+  std::string payload;
+  std::string response;
+  unsigned int nonce;
+
+  // the newest presence, sent on every READY so a restarted discord
+  // shows it again without waiting for the next game event
+  std::string latest_presence;
+
+  clock::time_point next_connect;
+  clock::time_point connect_started;
+
+  // doubles with every failed attempt, back to min_backoff on READY
+  std::chrono::milliseconds min_backoff;
+  std::chrono::milliseconds max_backoff;
+  int failed_attempts;
+
+  void set_state(Discord_State);
+  void try_connect(clock::time_point now);
+  // drops the pipe and schedules the next attempt
+  void connection_lost(Discord_State, clock::time_point now);
+  void handle_frame(Ipc_Opcode opcode, clock::time_point now);
+
 public:
   Discord_Presence();
-  void initialize(const char *);
+  explicit Discord_Presence(std::unique_ptr<Ipc_Transport> transport);
+
+  // the now overloads are for replaying a timeline, the others use the clock
+  void initialize(const char *n_application_id) {
+    initialize(n_application_id, clock::now());
+  }
+  void initialize(const char *, clock::time_point now);
+  Discord_State get_state();
   int get_status();
   void set_status(int);
+  // only sent if discord is ready, otherwise kept until it is
   void update(const char *details, const char *largeText, const char *smallText,
               const char *statetext, const char *smallImage, std::time_t timestamp);
-  void run_callbacks();
+  void run_callbacks() { run_callbacks(clock::now()); }
+  void run_callbacks(clock::time_point now);
   void shutdown();
+
+  void set_backoff(std::chrono::milliseconds min,
+                   std::chrono::milliseconds max);
+  // how long run_callbacks can wait before it has something to do
+  clock::duration until_next_attempt(clock::time_point now);
 };
 
 Discord_Presence *get_discord();
-#endif
\ No newline at end of file
+#endif
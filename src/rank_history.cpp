@@ -0,0 +1,256 @@
+#include "rank_history.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <tuple>
+
+constexpr char HISTORY_MAGIC[8] = {'G', 'D', 'R', 'P', 'C', 'R', 'N', 'K'};
+constexpr uint32_t HISTORY_VERSION = 1;
+
+struct History_Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size;
+};
+
+struct History_Record {
+  int64_t timestamp;
+  int32_t accountID;
+  int32_t rank;
+  int32_t stars;
+  uint32_t reserved;
+  // of everything above
+  uint64_t checksum;
+};
+
+static_assert(sizeof(History_Record) == 32, "records are written as is");
+
+namespace {
+uint64_t record_checksum(const History_Record &record) {
+  return fnv1a(reinterpret_cast<const char *>(&record),
+               offsetof(History_Record, checksum));
+}
+
+History_Record into_record(const Rank_Sample &sample) {
+  History_Record record{};
+  record.timestamp = sample.timestamp;
+  record.accountID = sample.accountID;
+  record.rank = sample.rank;
+  record.stars = sample.stars;
+  record.checksum = record_checksum(record);
+  return record;
+}
+
+History_Header make_header() {
+  History_Header header;
+  std::memcpy(header.magic, HISTORY_MAGIC, sizeof(HISTORY_MAGIC));
+  header.version = HISTORY_VERSION;
+  header.record_size = sizeof(History_Record);
+  return header;
+}
+
+bool sample_before(const Rank_Sample &a, const Rank_Sample &b) {
+  return std::tie(a.accountID, a.timestamp) <
+         std::tie(b.accountID, b.timestamp);
+}
+
+constexpr int64_t SECONDS_PER_DAY = 24 * 60 * 60;
+} // namespace
+
+Rank_History::Rank_History(std::string filename) : filename(filename) {}
+
+void Rank_History::open(std::time_t now) {
+  samples.clear();
+
+  // where the good records end, anything after is cut off so appends line
+  // up with the records again
+  size_t valid_size = 0;
+  size_t file_size = 0;
+  {
+    Mapped_File file;
+    if (!file.open(filename)) {
+      return;
+    }
+    file_size = file.size();
+
+    // a file that isn't ours (or a torn header) is cut down to nothing
+    // below, otherwise appends would land behind a header that never loads
+    History_Header header;
+    bool header_valid = file.size() >= sizeof(header);
+    if (header_valid) {
+      std::memcpy(&header, file.data(), sizeof(header));
+      header_valid =
+          std::memcmp(header.magic, HISTORY_MAGIC, sizeof(HISTORY_MAGIC)) ==
+              0 &&
+          header.version == HISTORY_VERSION &&
+          header.record_size == sizeof(History_Record);
+    }
+
+    valid_size = header_valid ? sizeof(header) : 0;
+    auto count = header_valid ? (file.size() - sizeof(header)) /
+                                    sizeof(History_Record)
+                              : 0;
+    samples.reserve(count);
+
+    for (size_t i = 0; i < count; i++) {
+      History_Record record;
+      std::memcpy(&record, file.data() + valid_size, sizeof(record));
+      if (record.checksum != record_checksum(record)) {
+        // a torn append, nothing valid comes after it
+        break;
+      }
+
+      samples.push_back(
+          {record.timestamp, record.accountID, record.rank, record.stars});
+      valid_size += sizeof(record);
+    }
+  }
+
+  if (valid_size != file_size) {
+    std::error_code error;
+    std::filesystem::resize_file(filename, valid_size, error);
+  }
+
+  // appends are in time order, but the clock could have been changed
+  std::stable_sort(samples.begin(), samples.end(), sample_before);
+
+  if (samples.size() - compacted(now).size() >= MIN_COMPACTION) {
+    compact(now);
+  }
+}
+
+bool Rank_History::append(const Rank_Sample &sample) {
+  samples.insert(
+      std::upper_bound(samples.begin(), samples.end(), sample, sample_before),
+      sample);
+
+  std::error_code error;
+  bool is_new = !std::filesystem::exists(filename, error) ||
+                std::filesystem::file_size(filename, error) == 0;
+
+  std::ofstream file(filename, std::ios::binary | std::ios::app);
+  if (is_new) {
+    auto header = make_header();
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  }
+
+  auto record = into_record(sample);
+  file.write(reinterpret_cast<const char *>(&record), sizeof(record));
+  file.flush();
+  return static_cast<bool>(file);
+}
+
+std::vector<Rank_Sample> Rank_History::compacted(int64_t now) const {
+  auto full_after =
+      now - std::chrono::duration_cast<std::chrono::seconds>(FULL_RESOLUTION)
+                .count();
+  auto oldest =
+      now - std::chrono::duration_cast<std::chrono::seconds>(MAX_AGE).count();
+
+  std::vector<Rank_Sample> kept;
+  kept.reserve(samples.size());
+
+  for (size_t i = 0; i < samples.size(); i++) {
+    const auto &sample = samples[i];
+    if (sample.timestamp < oldest) {
+      continue;
+    }
+
+    if (sample.timestamp < full_after && i + 1 < samples.size()) {
+      // only the last sample of each day is kept
+      const auto &next = samples[i + 1];
+      if (next.accountID == sample.accountID &&
+          next.timestamp / SECONDS_PER_DAY ==
+              sample.timestamp / SECONDS_PER_DAY) {
+        continue;
+      }
+    }
+
+    kept.push_back(sample);
+  }
+
+  return kept;
+}
+
+bool Rank_History::rewrite(const std::vector<Rank_Sample> &kept) {
+  // written to the side first, same as the config snapshot
+  auto temporary_filename = filename + ".tmp";
+  {
+    std::ofstream file(temporary_filename, std::ios::binary | std::ios::trunc);
+    auto header = make_header();
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    std::vector<History_Record> records;
+    records.reserve(kept.size());
+    for (const auto &sample : kept) {
+      records.push_back(into_record(sample));
+    }
+    file.write(reinterpret_cast<const char *>(records.data()),
+               records.size() * sizeof(History_Record));
+
+    if (!file) {
+      return false;
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::rename(temporary_filename, filename, error);
+  return !error;
+}
+
+bool Rank_History::compact(std::time_t now) {
+  auto kept = compacted(now);
+  if (!rewrite(kept)) {
+    return false;
+  }
+
+  samples = std::move(kept);
+  return true;
+}
+
+std::pair<std::vector<Rank_Sample>::const_iterator,
+          std::vector<Rank_Sample>::const_iterator>
+Rank_History::range(int accountID, int64_t from, int64_t to) const {
+  Rank_Sample first{from, accountID, 0, 0};
+  Rank_Sample last{to, accountID, 0, 0};
+  return {std::lower_bound(samples.begin(), samples.end(), first,
+                           sample_before),
+          std::lower_bound(samples.begin(), samples.end(), last,
+                           sample_before)};
+}
+
+bool Rank_History::rank_change(int accountID, std::chrono::seconds period,
+                               std::time_t now, int &change) const {
+  auto [begin, end] = range(accountID, INT64_MIN, INT64_MAX);
+  if (begin == end) {
+    return false;
+  }
+
+  const auto &newest = *(end - 1);
+
+  // the last sample from before the period started, or the first one if
+  // the history doesn't go back that far
+  auto [before, start] = range(accountID, INT64_MIN, now - period.count() + 1);
+  const auto &baseline = start != before ? *(start - 1) : *begin;
+
+  // lower ranks are better
+  change = baseline.rank - newest.rank;
+  return true;
+}
+
+std::string format_rank_change(bool known, int change) {
+  if (!known) {
+    return "";
+  }
+  if (change > 0) {
+    return "\xE2\x96\xB2" + std::to_string(change);
+  }
+  if (change < 0) {
+    return "\xE2\x96\xBC" + std::to_string(-change);
+  }
+  return "\xC2\xB1" "0";
+}
@@ -0,0 +1,72 @@
+#pragma once
+#ifndef RANK_HISTORY_HPP
+#define RANK_HISTORY_HPP
+#include "mapped_file.hpp"
+#include "snapshot_io.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+struct Rank_Sample {
+  int64_t timestamp;
+  int32_t accountID;
+  int32_t rank;
+  int32_t stars;
+};
+
+// every rank the player has had, appended to a file of fixed size records
+// each record carries its own checksum, so a crash mid append only loses
+// that record and the rest of the file stays readable
+class Rank_History {
+private:
+  // samples newer than this are all kept, older ones only one per day
+  static constexpr std::chrono::hours FULL_RESOLUTION{24 * 8};
+  static constexpr std::chrono::hours MAX_AGE{24 * 400};
+  // compaction rewrites the file, so only bother once there's enough to drop
+  static constexpr size_t MIN_COMPACTION = 64;
+
+  std::string filename;
+
+  // sorted by account and then time, for binary searching ranges
+  std::vector<Rank_Sample> samples;
+
+  // samples of the account in [from, to)
+  std::pair<std::vector<Rank_Sample>::const_iterator,
+            std::vector<Rank_Sample>::const_iterator>
+  range(int accountID, int64_t from, int64_t to) const;
+
+  // the samples compact would keep
+  std::vector<Rank_Sample> compacted(int64_t now) const;
+
+  bool rewrite(const std::vector<Rank_Sample> &kept);
+
+public:
+  Rank_History(std::string filename = "gdrpc_rank_history.bin");
+
+  // reads the file, dropping anything damaged and compacting it if enough
+  // samples are old
+  void open(std::time_t now);
+
+  // returns false if the sample couldn't be written, it's still used for
+  // this session
+  bool append(const Rank_Sample &sample);
+
+  // thins out old samples and rewrites the file
+  bool compact(std::time_t now);
+
+  // how many places the account climbed between the last sample at least
+  // period old (or its first sample) and its newest one
+  // returns false if there are no samples for the account
+  bool rank_change(int accountID, std::chrono::seconds period,
+                   std::time_t now, int &change) const;
+
+  size_t size() const { return samples.size(); }
+};
+
+// "▲15" for climbing 15 places, "▼3" for dropping, "±0" and empty if unknown
+std::string format_rank_change(bool known, int change);
+
+#endif
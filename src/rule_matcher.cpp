@@ -0,0 +1,346 @@
+#include "rule_matcher.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <stdexcept>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+// same names as getDifficultyName, in bucket order
+constexpr const char *DIFFICULTY_NAMES[] = {
+    "na",         "auto",         "easy",         "normal",
+    "hard",       "harder",       "insane",       "easy_demon",
+    "medium_demon", "hard_demon", "insane_demon", "extreme_demon"};
+constexpr size_t DIFFICULTY_COUNT =
+    sizeof(DIFFICULTY_NAMES) / sizeof(DIFFICULTY_NAMES[0]);
+constexpr size_t FIRST_DEMON = 7;
+
+// indices match GJLevelType
+constexpr const char *TYPE_NAMES[] = {"official", "editor", "saved"};
+constexpr size_t TYPE_COUNT = sizeof(TYPE_NAMES) / sizeof(TYPE_NAMES[0]);
+
+size_t difficulty_index(const std::string &name) {
+  for (size_t i = 0; i < DIFFICULTY_COUNT; i++) {
+    if (name == DIFFICULTY_NAMES[i]) {
+      return i;
+    }
+  }
+  return DIFFICULTY_COUNT;
+}
+
+// one bit per difficulty the rule accepts, all of them without a list
+uint16_t difficulty_mask(const Config::Config_Format::Rule &rule, size_t index) {
+  if (rule.difficulty.empty()) {
+    return (1 << DIFFICULTY_COUNT) - 1;
+  }
+
+  uint16_t mask = 0;
+  for (const auto &name : rule.difficulty) {
+    if (name == "demon") {
+      for (auto d = FIRST_DEMON; d < DIFFICULTY_COUNT; d++) {
+        mask |= 1 << d;
+      }
+      continue;
+    }
+
+    auto d = difficulty_index(name);
+    if (d == DIFFICULTY_COUNT) {
+      throw std::runtime_error("rule " + std::to_string(index + 1) +
+                               " has unknown difficulty " + name);
+    }
+    mask |= 1 << d;
+  }
+  return mask;
+}
+
+uint8_t type_mask(const Config::Config_Format::Rule &rule, size_t index) {
+  if (rule.level_type.empty()) {
+    return (1 << TYPE_COUNT) - 1;
+  }
+
+  uint8_t mask = 0;
+  for (const auto &name : rule.level_type) {
+    auto t = std::find_if(
+        std::begin(TYPE_NAMES), std::end(TYPE_NAMES),
+        [&name](const char *type) { return name == type; });
+    if (t == std::end(TYPE_NAMES)) {
+      throw std::runtime_error("rule " + std::to_string(index + 1) +
+                               " has unknown level_type " + name);
+    }
+    mask |= 1 << (t - std::begin(TYPE_NAMES));
+  }
+  return mask;
+}
+
+std::string to_lower(std::string s) {
+  std::transform(s.begin(), s.end(), s.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return s;
+}
+
+int lowest_bit(uint64_t word) {
+#ifdef _MSC_VER
+  // _BitScanForward64 only exists on x64, and the dll is built for x86
+  unsigned long index;
+  auto low = static_cast<unsigned long>(word);
+  if (_BitScanForward(&index, low)) {
+    return static_cast<int>(index);
+  }
+  _BitScanForward(&index, static_cast<unsigned long>(word >> 32));
+  return static_cast<int>(index) + 32;
+#else
+  return __builtin_ctzll(word);
+#endif
+}
+} // namespace
+
+Rule_Matcher::Rule_Set Rule_Matcher::empty_set() const {
+  return Rule_Set(word_count, 0);
+}
+
+void Rule_Matcher::set_bit(Rule_Set &set, size_t rule) const {
+  set.at(rule / 64) |= uint64_t(1) << (rule % 64);
+}
+
+void Rule_Matcher::compile(const std::vector<Config::Config_Format::Rule> &rules,
+                           size_t linear_limit) {
+  rule_count = rules.size();
+  linear = rule_count <= linear_limit;
+  linear_rules.clear();
+
+  if (linear) {
+    for (size_t i = 0; i < rules.size(); i++) {
+      const auto &rule = rules.at(i);
+
+      Linear_Rule resolved{rule.id_min,
+                           rule.id_max,
+                           rule.stars_min,
+                           rule.stars_max,
+                           difficulty_mask(rule, i),
+                           type_mask(rule, i),
+                           {}};
+      for (const auto &author : rule.author) {
+        resolved.authors.push_back(to_lower(author));
+      }
+      linear_rules.push_back(std::move(resolved));
+    }
+    return;
+  }
+
+  word_count = (rule_count + 63) / 64;
+
+  star_sets.assign(MAX_STARS + 1, empty_set());
+  difficulty_sets.assign(DIFFICULTY_COUNT, empty_set());
+  type_sets.assign(TYPE_COUNT, empty_set());
+  author_sets.clear();
+  any_author = empty_set();
+
+  // every place a range starts or stops is the start of an interval
+  id_bounds = {0};
+  for (const auto &rule : rules) {
+    id_bounds.push_back(rule.id_min);
+    if (rule.id_max != INT_MAX) {
+      id_bounds.push_back(rule.id_max + 1);
+    }
+  }
+  std::sort(id_bounds.begin(), id_bounds.end());
+  id_bounds.erase(std::unique(id_bounds.begin(), id_bounds.end()),
+                  id_bounds.end());
+
+  auto bound_index = [this](int id) {
+    return static_cast<size_t>(
+        std::lower_bound(id_bounds.begin(), id_bounds.end(), id) -
+        id_bounds.begin());
+  };
+
+  // bucket the toggles by bound, counting first so it's one allocation
+  id_toggle_start.assign(id_bounds.size() + 1, 0);
+  for (const auto &rule : rules) {
+    if (rule.id_max < rule.id_min) {
+      continue;
+    }
+    id_toggle_start.at(bound_index(rule.id_min) + 1)++;
+    if (rule.id_max != INT_MAX) {
+      id_toggle_start.at(bound_index(rule.id_max + 1) + 1)++;
+    }
+  }
+  for (size_t b = 1; b < id_toggle_start.size(); b++) {
+    id_toggle_start.at(b) += id_toggle_start.at(b - 1);
+  }
+
+  id_toggles.assign(id_toggle_start.back(), 0);
+  auto next_toggle = id_toggle_start;
+  for (size_t i = 0; i < rules.size(); i++) {
+    const auto &rule = rules.at(i);
+    if (rule.id_max < rule.id_min) {
+      continue;
+    }
+    id_toggles.at(next_toggle.at(bound_index(rule.id_min))++) =
+        static_cast<uint32_t>(i);
+    if (rule.id_max != INT_MAX) {
+      id_toggles.at(next_toggle.at(bound_index(rule.id_max + 1))++) =
+          static_cast<uint32_t>(i);
+    }
+  }
+
+  id_checkpoints.clear();
+  id_scratch = empty_set();
+  for (size_t b = 0; b < id_bounds.size(); b++) {
+    for (auto t = id_toggle_start.at(b); t < id_toggle_start.at(b + 1); t++) {
+      auto rule = id_toggles.at(t);
+      id_scratch.at(rule / 64) ^= uint64_t(1) << (rule % 64);
+    }
+    if (b % ID_CHECKPOINT_SPACING == 0) {
+      id_checkpoints.push_back(id_scratch);
+    }
+  }
+
+  for (size_t i = 0; i < rules.size(); i++) {
+    const auto &rule = rules.at(i);
+
+    for (int stars = 0; stars <= MAX_STARS; stars++) {
+      if (stars >= rule.stars_min && stars <= rule.stars_max) {
+        set_bit(star_sets.at(stars), i);
+      }
+    }
+
+    auto difficulties = difficulty_mask(rule, i);
+    for (size_t d = 0; d < DIFFICULTY_COUNT; d++) {
+      if (difficulties & (1 << d)) {
+        set_bit(difficulty_sets.at(d), i);
+      }
+    }
+
+    auto types = type_mask(rule, i);
+    for (size_t t = 0; t < TYPE_COUNT; t++) {
+      if (types & (1 << t)) {
+        set_bit(type_sets.at(t), i);
+      }
+    }
+
+    if (rule.author.empty()) {
+      set_bit(any_author, i);
+    }
+    for (const auto &author : rule.author) {
+      auto &set = author_sets[to_lower(author)];
+      if (set.empty()) {
+        set = empty_set();
+      }
+      set_bit(set, i);
+    }
+  }
+}
+
+const Rule_Matcher::Rule_Set &Rule_Matcher::id_set(size_t interval) const {
+  auto checkpoint = interval / ID_CHECKPOINT_SPACING;
+  const auto &start = id_checkpoints.at(checkpoint);
+  auto first_bound = checkpoint * ID_CHECKPOINT_SPACING;
+  if (first_bound == interval) {
+    return start;
+  }
+
+  id_scratch = start;
+  for (auto t = id_toggle_start.at(first_bound + 1);
+       t < id_toggle_start.at(interval + 1); t++) {
+    auto rule = id_toggles.at(t);
+    id_scratch.at(rule / 64) ^= uint64_t(1) << (rule % 64);
+  }
+  return id_scratch;
+}
+
+int Rule_Matcher::match_linear(GDlevel &level, int level_type) const {
+  if (level_type < 1 || level_type > static_cast<int>(TYPE_COUNT)) {
+    return -1;
+  }
+  uint8_t type_bit = 1 << (level_type - 1);
+
+  auto stars = std::clamp(level.stars, 0, MAX_STARS);
+  auto d = difficulty_index(getDifficultyName(level));
+  uint16_t difficulty_bit = d < DIFFICULTY_COUNT ? 1 << d : 0;
+
+  bool author_lowered = false;
+  for (size_t i = 0; i < linear_rules.size(); i++) {
+    const auto &rule = linear_rules.at(i);
+    if (level.levelID < rule.id_min || level.levelID > rule.id_max ||
+        stars < rule.stars_min || stars > rule.stars_max ||
+        (rule.difficulties & difficulty_bit) == 0 ||
+        (rule.types & type_bit) == 0) {
+      continue;
+    }
+
+    if (!rule.authors.empty()) {
+      if (!author_lowered) {
+        author_scratch.assign(level.author);
+        std::transform(author_scratch.begin(), author_scratch.end(),
+                       author_scratch.begin(),
+                       [](unsigned char c) { return std::tolower(c); });
+        author_lowered = true;
+      }
+      if (std::find(rule.authors.begin(), rule.authors.end(),
+                    author_scratch) == rule.authors.end()) {
+        continue;
+      }
+    }
+
+    return static_cast<int>(i);
+  }
+
+  return -1;
+}
+
+int Rule_Matcher::match(GDlevel &level, int level_type) const {
+  if (rule_count == 0) {
+    return -1;
+  }
+
+  if (linear) {
+    return match_linear(level, level_type);
+  }
+
+  auto interval =
+      std::upper_bound(id_bounds.begin(), id_bounds.end(), level.levelID) -
+      id_bounds.begin();
+  if (interval == 0) {
+    // below every range, nothing can ask for those
+    return -1;
+  }
+  const auto &ids = id_set(interval - 1);
+
+  auto stars = std::clamp(level.stars, 0, MAX_STARS);
+  const auto &star_set = star_sets.at(stars);
+
+  auto d = difficulty_index(getDifficultyName(level));
+  const auto &difficulty_set = difficulty_sets.at(d);
+
+  if (level_type < 1 || level_type > static_cast<int>(TYPE_COUNT)) {
+    return -1;
+  }
+  const auto &type_set = type_sets.at(level_type - 1);
+
+  const Rule_Set *author_set = nullptr;
+  if (!author_sets.empty()) {
+    auto found = author_sets.find(to_lower(level.author));
+    if (found != author_sets.end()) {
+      author_set = &found->second;
+    }
+  }
+
+  for (size_t w = 0; w < word_count; w++) {
+    auto authors = any_author.at(w);
+    if (author_set) {
+      authors |= author_set->at(w);
+    }
+
+    auto word = ids.at(w) & star_set.at(w) & difficulty_set.at(w) &
+                type_set.at(w) & authors;
+    if (word != 0) {
+      return static_cast<int>(w * 64 + lowest_bit(word));
+    }
+  }
+
+  return -1;
+}
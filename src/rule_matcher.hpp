@@ -0,0 +1,91 @@
+#pragma once
+#ifndef RULE_MATCHER_HPP
+#define RULE_MATCHER_HPP
+
+#include "config_defaults.hpp"
+#include "gdapi.hpp"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// picks the first [[rule]] a level satisfies
+// every condition is turned into a set of rules (one bit per rule) ahead of
+// time, so matching is a few lookups and an AND per 64 rules instead of
+// walking the list and comparing strings every frame
+// short lists are walked anyway, the lookups cost more than a few compares
+class Rule_Matcher {
+public:
+  // up to this many rules are walked in order instead of compiled, see
+  // tests/rule_matcher_bench.cpp for where the two cross
+  static constexpr size_t LINEAR_RULE_LIMIT = 128;
+
+private:
+  typedef std::vector<uint64_t> Rule_Set;
+
+  static constexpr int MAX_STARS = 15;
+
+  size_t rule_count = 0;
+  size_t word_count = 0;
+
+  // a rule with its names already resolved, for the walk
+  struct Linear_Rule {
+    int id_min;
+    int id_max;
+    int stars_min;
+    int stars_max;
+    // one bit per difficulty and level type
+    uint16_t difficulties;
+    uint8_t types;
+    // lowercase, empty matches any author
+    std::vector<std::string> authors;
+  };
+  bool linear = false;
+  std::vector<Linear_Rule> linear_rules;
+  // the level's author in lowercase, only ever used from the loop thread
+  mutable std::string author_scratch;
+
+  int match_linear(GDlevel &level, int level_type) const;
+
+  // id ranges are split into intervals that don't overlap, bounds holds
+  // the start of each one
+  // a full set per interval grows with rules * intervals, so instead each
+  // bound lists the rules that start or stop there (flipping their bit),
+  // with a full set kept every ID_CHECKPOINT_SPACING bounds to replay from
+  static constexpr size_t ID_CHECKPOINT_SPACING = 64;
+  std::vector<int> id_bounds;
+  std::vector<uint32_t> id_toggle_start;
+  std::vector<uint32_t> id_toggles;
+  std::vector<Rule_Set> id_checkpoints;
+
+  // the id set being replayed, only ever used from the loop thread
+  mutable Rule_Set id_scratch;
+  const Rule_Set &id_set(size_t interval) const;
+
+  std::vector<Rule_Set> star_sets;
+  std::vector<Rule_Set> difficulty_sets;
+  std::vector<Rule_Set> type_sets;
+
+  // authors are stored lowercase, any_author holds rules without a list
+  std::unordered_map<std::string, Rule_Set> author_sets;
+  Rule_Set any_author;
+
+  Rule_Set empty_set() const;
+  void set_bit(Rule_Set &set, size_t rule) const;
+
+public:
+  // throws std::runtime_error on a difficulty or level type that doesn't
+  // exist, which would otherwise silently never match
+  // linear_limit is only changed to compare the two ways
+  void compile(const std::vector<Config::Config_Format::Rule> &rules,
+               size_t linear_limit = LINEAR_RULE_LIMIT);
+
+  // returns the index of the first matching rule, or -1
+  // not thread safe, it shares scratch space between calls
+  int match(GDlevel &level, int level_type) const;
+
+  bool empty() const { return rule_count == 0; }
+};
+
+#endif
@@ -0,0 +1,266 @@
+#include "signature_scanner.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) ||             \
+    defined(__x86_64__)
+#define SCANNER_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_AVX2
+#else
+#include <cpuid.h>
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace {
+int hex_value(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+int lowest_bit(uint32_t bits) {
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward(&index, bits);
+  return static_cast<int>(index);
+#else
+  return __builtin_ctz(bits);
+#endif
+}
+
+#ifdef SCANNER_X86
+bool cpu_has_avx2() {
+#ifdef _MSC_VER
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7) {
+    return false;
+  }
+
+  // the os has to save ymm registers too, not just the cpu support it
+  __cpuid(info, 1);
+  bool osxsave = (info[2] & (1 << 27)) != 0;
+  bool avx = (info[2] & (1 << 28)) != 0;
+  if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) {
+    return false;
+  }
+
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  return __builtin_cpu_supports("avx2");
+#endif
+}
+
+// both filters compare 16 or 32 candidate positions at once against the
+// first and last fixed bytes, only positions where both agree get the
+// full comparison
+size_t find_sse2(const uint8_t *data, size_t size,
+                 const Signature &signature) {
+  auto first = signature.get_first_fixed();
+  auto last = signature.get_last_fixed();
+  auto first_byte = _mm_set1_epi8(static_cast<char>(signature.byte_at(first)));
+  auto last_byte = _mm_set1_epi8(static_cast<char>(signature.byte_at(last)));
+
+  auto candidates = size - signature.size() + 1;
+  size_t position = 0;
+  for (; position + 16 <= candidates; position += 16) {
+    auto at_first = _mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(data + position + first));
+    auto at_last = _mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(data + position + last));
+
+    auto bits = static_cast<uint32_t>(_mm_movemask_epi8(
+        _mm_and_si128(_mm_cmpeq_epi8(at_first, first_byte),
+                      _mm_cmpeq_epi8(at_last, last_byte))));
+    while (bits != 0) {
+      auto candidate = position + lowest_bit(bits);
+      if (signature.matches(data + candidate)) {
+        return candidate;
+      }
+      bits &= bits - 1;
+    }
+  }
+
+  auto rest = find_signature_scalar(data + position, size - position,
+                                    signature);
+  return rest == NO_MATCH ? NO_MATCH : position + rest;
+}
+
+TARGET_AVX2 size_t find_avx2(const uint8_t *data, size_t size,
+                             const Signature &signature) {
+  auto first = signature.get_first_fixed();
+  auto last = signature.get_last_fixed();
+  auto first_byte =
+      _mm256_set1_epi8(static_cast<char>(signature.byte_at(first)));
+  auto last_byte =
+      _mm256_set1_epi8(static_cast<char>(signature.byte_at(last)));
+
+  auto candidates = size - signature.size() + 1;
+  size_t position = 0;
+  for (; position + 32 <= candidates; position += 32) {
+    auto at_first = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(data + position + first));
+    auto at_last = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(data + position + last));
+
+    auto bits = static_cast<uint32_t>(_mm256_movemask_epi8(
+        _mm256_and_si256(_mm256_cmpeq_epi8(at_first, first_byte),
+                         _mm256_cmpeq_epi8(at_last, last_byte))));
+    while (bits != 0) {
+      auto candidate = position + lowest_bit(bits);
+      if (signature.matches(data + candidate)) {
+        return candidate;
+      }
+      bits &= bits - 1;
+    }
+  }
+
+  auto rest = find_signature_scalar(data + position, size - position,
+                                    signature);
+  return rest == NO_MATCH ? NO_MATCH : position + rest;
+}
+#endif
+
+uint16_t read_u16(const uint8_t *at) {
+  uint16_t value;
+  std::memcpy(&value, at, sizeof(value));
+  return value;
+}
+
+uint32_t read_u32(const uint8_t *at) {
+  uint32_t value;
+  std::memcpy(&value, at, sizeof(value));
+  return value;
+}
+} // namespace
+
+Signature::Signature(const std::string &pattern) {
+  for (size_t i = 0; i < pattern.size();) {
+    if (pattern[i] == ' ') {
+      i++;
+      continue;
+    }
+
+    if (i + 1 >= pattern.size()) {
+      throw std::runtime_error("signature ends in half a byte: " + pattern);
+    }
+
+    if (pattern[i] == '?' && pattern[i + 1] == '?') {
+      bytes.push_back(0);
+      mask.push_back(0);
+    } else {
+      auto high = hex_value(pattern[i]);
+      auto low = hex_value(pattern[i + 1]);
+      if (high == -1 || low == -1) {
+        throw std::runtime_error("bad byte in signature: " + pattern);
+      }
+      bytes.push_back(static_cast<uint8_t>(high << 4 | low));
+      mask.push_back(1);
+    }
+    i += 2;
+  }
+
+  first_fixed = bytes.size();
+  last_fixed = 0;
+  for (size_t i = 0; i < mask.size(); i++) {
+    if (mask[i]) {
+      first_fixed = std::min(first_fixed, i);
+      last_fixed = i;
+    }
+  }
+
+  if (first_fixed == bytes.size()) {
+    throw std::runtime_error("signature has no fixed bytes: " + pattern);
+  }
+}
+
+bool Signature::matches(const uint8_t *data) const {
+  for (size_t i = 0; i < bytes.size(); i++) {
+    if (mask[i] && data[i] != bytes[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+size_t find_signature_scalar(const uint8_t *data, size_t size,
+                             const Signature &signature) {
+  if (size < signature.size()) {
+    return NO_MATCH;
+  }
+
+  auto first = signature.get_first_fixed();
+  auto first_byte = signature.byte_at(first);
+  auto candidates = size - signature.size() + 1;
+
+  for (size_t position = 0; position < candidates; position++) {
+    if (data[position + first] == first_byte &&
+        signature.matches(data + position)) {
+      return position;
+    }
+  }
+  return NO_MATCH;
+}
+
+size_t find_signature(const uint8_t *data, size_t size,
+                      const Signature &signature) {
+  if (size < signature.size()) {
+    return NO_MATCH;
+  }
+
+#ifdef SCANNER_X86
+  static const bool has_avx2 = cpu_has_avx2();
+  if (has_avx2) {
+    return find_avx2(data, size, signature);
+  }
+  return find_sse2(data, size, signature);
+#else
+  return find_signature_scalar(data, size, signature);
+#endif
+}
+
+bool read_image_info(const uint8_t *base, Image_Info &info) {
+  if (base[0] != 'M' || base[1] != 'Z') {
+    return false;
+  }
+
+  auto pe = base + read_u32(base + 0x3C);
+  if (std::memcmp(pe, "PE\0\0", 4) != 0) {
+    return false;
+  }
+
+  auto file_header = pe + 4;
+  auto section_count = read_u16(file_header + 2);
+  auto optional_size = read_u16(file_header + 16);
+  info.timestamp = read_u32(file_header + 4);
+
+  // these sit at the same offsets in pe32 and pe32+
+  auto optional_header = file_header + 20;
+  info.image_size = read_u32(optional_header + 56);
+  info.checksum = read_u32(optional_header + 64);
+
+  auto section = optional_header + optional_size;
+  for (uint16_t i = 0; i < section_count; i++, section += 40) {
+    if (std::memcmp(section, ".text", 6) == 0) {
+      info.text_size = read_u32(section + 8);
+      info.text_rva = read_u32(section + 12);
+      return true;
+    }
+  }
+
+  return false;
+}
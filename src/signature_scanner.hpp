@@ -0,0 +1,61 @@
+#pragma once
+#ifndef SIGNATURE_SCANNER_HPP
+#define SIGNATURE_SCANNER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// a byte pattern like "55 8B EC ?? ?? 6A FF", ?? matches any byte
+class Signature {
+private:
+  std::vector<uint8_t> bytes;
+  std::vector<uint8_t> mask;
+
+  // the first and last bytes that aren't wildcards, used to filter
+  // candidates before the whole pattern is compared
+  size_t first_fixed;
+  size_t last_fixed;
+
+public:
+  // throws std::runtime_error on anything that isn't two hex digits or ??
+  explicit Signature(const std::string &pattern);
+
+  size_t size() const { return bytes.size(); }
+
+  // compares the whole pattern at data, which must have size() bytes
+  bool matches(const uint8_t *data) const;
+
+  size_t get_first_fixed() const { return first_fixed; }
+  size_t get_last_fixed() const { return last_fixed; }
+  uint8_t byte_at(size_t index) const { return bytes.at(index); }
+};
+
+constexpr size_t NO_MATCH = static_cast<size_t>(-1);
+
+// offset of the first match in data, or NO_MATCH
+// uses avx2 or sse2 when the cpu has them
+size_t find_signature(const uint8_t *data, size_t size,
+                      const Signature &signature);
+
+// the same search without any simd, mostly here to check the others
+size_t find_signature_scalar(const uint8_t *data, size_t size,
+                             const Signature &signature);
+
+// what's needed out of a loaded pe image's headers
+struct Image_Info {
+  uint32_t text_rva = 0;
+  uint32_t text_size = 0;
+
+  // together these tell builds of an executable apart without hashing it
+  uint32_t timestamp = 0;
+  uint32_t image_size = 0;
+  uint32_t checksum = 0;
+};
+
+// reads the headers of an image mapped by the loader (so sections are at
+// their virtual addresses), returns false if it doesn't look like one
+bool read_image_info(const uint8_t *base, Image_Info &info);
+
+#endif
@@ -0,0 +1,99 @@
+#pragma once
+#ifndef SNAPSHOT_IO_HPP
+#define SNAPSHOT_IO_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// fnv-1a, used for checksums and not for anything security related
+inline uint64_t fnv1a(const char *data, size_t size,
+                      uint64_t hash = 0xcbf29ce484222325ull) {
+  for (size_t i = 0; i < size; i++) {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+// flat little endian encoding for the binary config snapshot
+class Snapshot_Writer {
+private:
+  std::string buffer;
+
+public:
+  template <typename T> void write(T value) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "only plain values can be written directly");
+    buffer.append(reinterpret_cast<const char *>(&value), sizeof(T));
+  }
+
+  void write(const std::string &value) {
+    write(static_cast<uint32_t>(value.size()));
+    buffer.append(value);
+  }
+
+  void write(bool value) { write(static_cast<uint8_t>(value)); }
+
+  void write(const std::vector<std::string> &values) {
+    write(static_cast<uint32_t>(values.size()));
+    for (const auto &value : values) {
+      write(value);
+    }
+  }
+
+  const std::string &data() const { return buffer; }
+};
+
+// reads what Snapshot_Writer wrote, throwing std::runtime_error instead of
+// reading past the end of a damaged snapshot
+class Snapshot_Reader {
+private:
+  const char *position;
+  const char *end;
+
+  void require(size_t size) {
+    if (static_cast<size_t>(end - position) < size) {
+      throw std::runtime_error("config snapshot is truncated");
+    }
+  }
+
+public:
+  Snapshot_Reader(const char *data, size_t size)
+      : position(data), end(data + size) {}
+
+  template <typename T> T read() {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "only plain values can be read directly");
+    require(sizeof(T));
+    T value;
+    std::memcpy(&value, position, sizeof(T));
+    position += sizeof(T);
+    return value;
+  }
+
+  std::string read_string() {
+    auto size = read<uint32_t>();
+    require(size);
+    std::string value(position, size);
+    position += size;
+    return value;
+  }
+
+  bool read_bool() { return read<uint8_t>() != 0; }
+
+  std::vector<std::string> read_strings() {
+    std::vector<std::string> values(read<uint32_t>());
+    for (auto &value : values) {
+      value = read_string();
+    }
+    return values;
+  }
+
+  bool at_end() const { return position == end; }
+};
+
+#endif
@@ -0,0 +1,140 @@
+#include "song_cache.hpp"
+
+#include <fstream>
+
+// tabs and newlines would break the cache format
+std::string strip_separators(std::string text) {
+  std::replace_if(
+      text.begin(), text.end(),
+      [](char c) { return c == '\t' || c == '\n' || c == '\r'; }, ' ');
+  return text;
+}
+
+Song_Cache::Song_Cache(std::string filename)
+    : filename(filename), running(false), client(nullptr) {}
+
+void Song_Cache::load() {
+  std::ifstream cache_file(filename);
+  std::string line;
+
+  while (std::getline(cache_file, line)) {
+    auto fields = explode(line, '\t');
+    if (fields.size() != 3) {
+      continue;
+    }
+
+    try {
+      GDsong song;
+      song.ID = std::stoi(fields.at(0), nullptr);
+      song.name = fields.at(1);
+      song.artist = fields.at(2);
+      songs[song.ID] = song;
+    } catch (const std::exception &) {
+      // skip broken lines, they will be fetched again
+    }
+  }
+}
+
+void Song_Cache::save(const GDsong &song) {
+  std::ofstream cache_file(filename, std::ios::app);
+  cache_file << song.ID << '\t' << strip_separators(song.name) << '\t'
+             << strip_separators(song.artist) << '\n';
+}
+
+void Song_Cache::start(std::shared_ptr<GD_Client> n_client,
+                       std::function<void()> n_on_resolved) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (running) {
+    return;
+  }
+
+  load();
+
+  client = n_client;
+  on_resolved = n_on_resolved;
+  running = true;
+  worker.start([this](Stop_Token) { worker_loop(); });
+}
+
+void Song_Cache::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    running = false;
+  }
+  queue_cv.notify_all();
+
+  // a request may still be in flight, don't hold up closing the game for it
+  worker.request_stop();
+  worker.join_for(STOP_TIMEOUT);
+}
+
+bool Song_Cache::lookup(int audioTrack, int songID, GDsong &song) {
+  if (songID == 0) {
+    song.ID = 0;
+    if (audioTrack >= 0 &&
+        static_cast<size_t>(audioTrack) < OFFICIAL_SONGS.size()) {
+      song.name = OFFICIAL_SONGS.at(audioTrack).name;
+      song.artist = OFFICIAL_SONGS.at(audioTrack).artist;
+    } else {
+      song.name = "Unknown";
+      song.artist = "RobTop";
+    }
+    return true;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  if (auto cached = songs.find(songID); cached != songs.end()) {
+    song = cached->second;
+    return true;
+  }
+
+  song = GDsong();
+  if (running && pending.insert(songID).second) {
+    queue.push_back(songID);
+    queue_cv.notify_one();
+  }
+  return false;
+}
+
+void Song_Cache::worker_loop() {
+  while (true) {
+    int songID;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      queue_cv.wait(lock, [this]() { return !running || !queue.empty(); });
+      if (!running) {
+        return;
+      }
+
+      songID = queue.front();
+      queue.pop_front();
+    }
+
+    GDsong song;
+    bool resolved = true;
+    try {
+      client->get_song_info(songID, song);
+    } catch (const Not_Found_Error &) {
+      // server says the song doesn't exist, remember that
+      song = GDsong();
+    } catch (const std::exception &) {
+      // network issue or a garbled response, allow a retry on the next lookup
+      resolved = false;
+    }
+    song.ID = songID;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      pending.erase(songID);
+      if (!resolved) {
+        continue;
+      }
+      songs[songID] = song;
+    }
+
+    save(song);
+    if (on_resolved) {
+      on_resolved();
+    }
+  }
+}
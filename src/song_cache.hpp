@@ -0,0 +1,81 @@
+#pragma once
+#ifndef SONG_CACHE_HPP
+#define SONG_CACHE_HPP
+#include "gdapi.hpp"
+#include "worker_thread.hpp"
+
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+struct Official_Song {
+  const char *name;
+  const char *artist;
+};
+
+// indexed by GJGameLevel::audioTrack
+constexpr std::array<Official_Song, 21> OFFICIAL_SONGS{{
+    {"Stereo Madness", "ForeverBound"},
+    {"Back On Track", "DJVI"},
+    {"Polargeist", "Step"},
+    {"Dry Out", "DJVI"},
+    {"Base After Base", "DJVI"},
+    {"Cant Let Go", "DJVI"},
+    {"Jumper", "Waterflame"},
+    {"Time Machine", "Waterflame"},
+    {"Cycles", "DJVI"},
+    {"xStep", "DJVI"},
+    {"Clutterfunk", "Waterflame"},
+    {"Theory of Everything", "DJ-Nate"},
+    {"Electroman Adventures", "Waterflame"},
+    {"Clubstep", "DJ-Nate"},
+    {"Electrodynamix", "DJ-Nate"},
+    {"Hexagon Force", "Waterflame"},
+    {"Blast Processing", "Waterflame"},
+    {"Theory of Everything 2", "DJ-Nate"},
+    {"Geometrical Dominator", "Waterflame"},
+    {"Deadlocked", "F-777"},
+    {"Fingerdash", "MDK"},
+}};
+
+// custom songs are looked up from the server on a worker thread,
+// then saved to disk so that each id is only ever requested once
+class Song_Cache {
+private:
+  std::string filename;
+
+  std::unordered_map<int, GDsong> songs;
+  std::unordered_set<int> pending;
+  std::deque<int> queue;
+
+  std::mutex mutex;
+  std::condition_variable queue_cv;
+  Worker_Thread worker;
+  static constexpr std::chrono::milliseconds STOP_TIMEOUT{250};
+  bool running;
+
+  std::shared_ptr<GD_Client> client;
+  std::function<void()> on_resolved;
+
+  void load();
+  void save(const GDsong &song);
+  void worker_loop();
+
+public:
+  Song_Cache(std::string filename = "gdrpc_songs.txt");
+
+  void start(std::shared_ptr<GD_Client> client,
+             std::function<void()> on_resolved);
+  void stop();
+
+  // never blocks on the network, returns false and queues a lookup on a miss
+  bool lookup(int audioTrack, int songID, GDsong &song);
+};
+
+#endif
@@ -0,0 +1,136 @@
+#include "text_encoding.hpp"
+
+#include <cstdint>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define TEXT_ENCODING_SSE2
+#endif
+
+#ifdef TEXT_ENCODING_SSE2
+// the high bit of each byte is all movemask looks at
+bool ascii_block(const char *text) {
+  auto chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text));
+  return _mm_movemask_epi8(chars) == 0;
+}
+#endif
+
+// length of the ascii run at the start of text
+size_t ascii_prefix(const char *text, size_t size) {
+  size_t i = 0;
+
+#ifdef TEXT_ENCODING_SSE2
+  while (i + 16 <= size && ascii_block(text + i)) {
+    i += 16;
+  }
+#endif
+
+  // the rest of the block tells us exactly where it stops
+  while (i < size && static_cast<unsigned char>(text[i]) < 0x80) {
+    i++;
+  }
+  return i;
+}
+
+bool is_ascii(const char *text, size_t size) {
+  return ascii_prefix(text, size) == size;
+}
+
+bool is_valid_utf8(const char *text, size_t size) {
+  auto bytes = reinterpret_cast<const unsigned char *>(text);
+
+  size_t i = 0;
+  while (i < size) {
+    if (bytes[i] < 0x80) {
+#ifdef TEXT_ENCODING_SSE2
+      // long ascii runs go a block at a time, short ones aren't worth it
+      if (size - i >= 16 && ascii_block(text + i)) {
+        i += 16;
+        continue;
+      }
+#endif
+      i++;
+      continue;
+    }
+
+    auto lead = bytes[i];
+    size_t length;
+    uint32_t min;
+    uint32_t codepoint;
+    if ((lead & 0xE0) == 0xC0) {
+      length = 2;
+      min = 0x80;
+      codepoint = lead & 0x1F;
+    } else if ((lead & 0xF0) == 0xE0) {
+      length = 3;
+      min = 0x800;
+      codepoint = lead & 0x0F;
+    } else if ((lead & 0xF8) == 0xF0) {
+      length = 4;
+      min = 0x10000;
+      codepoint = lead & 0x07;
+    } else {
+      return false;
+    }
+
+    if (size - i < length) {
+      return false;
+    }
+
+    for (size_t j = 1; j < length; j++) {
+      if ((bytes[i + j] & 0xC0) != 0x80) {
+        return false;
+      }
+      codepoint = (codepoint << 6) | (bytes[i + j] & 0x3F);
+    }
+
+    if (codepoint < min || codepoint > 0x10FFFF ||
+        (codepoint >= 0xD800 && codepoint <= 0xDFFF)) {
+      return false;
+    }
+
+    i += length;
+  }
+
+  return true;
+}
+
+// windows-1252 for 0x80-0x9F, the holes keep their latin-1 control codes
+constexpr uint16_t WINDOWS_1252_HIGH[32] = {
+    0x20AC, 0x0081, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+    0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0x008D, 0x017D, 0x008F,
+    0x0090, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+    0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x009D, 0x017E, 0x0178};
+
+bool normalize_text(std::string &text) {
+  auto ascii = ascii_prefix(text.data(), text.size());
+  if (ascii == text.size() ||
+      is_valid_utf8(text.data() + ascii, text.size() - ascii)) {
+    return false;
+  }
+
+  // every byte becomes at most 3
+  std::string out;
+  out.reserve(text.size() * 3);
+  out.append(text, 0, ascii);
+
+  for (size_t i = ascii; i < text.size(); i++) {
+    auto byte = static_cast<unsigned char>(text[i]);
+    uint32_t codepoint =
+        (byte >= 0x80 && byte < 0xA0) ? WINDOWS_1252_HIGH[byte - 0x80] : byte;
+
+    if (codepoint < 0x80) {
+      out.push_back(static_cast<char>(codepoint));
+    } else if (codepoint < 0x800) {
+      out.push_back(static_cast<char>(0xC0 | (codepoint >> 6)));
+      out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+    } else {
+      out.push_back(static_cast<char>(0xE0 | (codepoint >> 12)));
+      out.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+      out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+    }
+  }
+
+  text.swap(out);
+  return true;
+}
@@ -0,0 +1,20 @@
+#pragma once
+#ifndef TEXT_ENCODING_HPP
+#define TEXT_ENCODING_HPP
+
+#include <cstddef>
+#include <string>
+
+// whether every byte is below 0x80
+bool is_ascii(const char *text, size_t size);
+
+// strict utf-8: no overlong forms, surrogates or anything past U+10FFFF
+bool is_valid_utf8(const char *text, size_t size);
+
+// gd keeps some names in windows-1252 (latin-1 plus a few symbols in
+// 0x80-0x9F), which discord either mangles or rejects outright
+// ascii and valid utf-8 are left alone, anything else is transcoded
+// returns true if text was changed
+bool normalize_text(std::string &text);
+
+#endif
@@ -0,0 +1,188 @@
+#include "worker_thread.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sys/resource.h>
+#ifdef __linux__
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#endif
+
+Thread_Options &worker_thread_options() {
+  static Thread_Options options;
+  return options;
+}
+
+void apply_worker_thread_options() {
+  const auto &options = worker_thread_options();
+
+#ifdef _WIN32
+  if (options.low_priority) {
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+  }
+  if (options.affinity_mask != 0) {
+    SetThreadAffinityMask(GetCurrentThread(),
+                          static_cast<DWORD_PTR>(options.affinity_mask));
+  }
+#elif defined(__linux__)
+  // linux applies nice values per thread
+  if (options.low_priority) {
+    auto tid = static_cast<id_t>(syscall(SYS_gettid));
+    setpriority(PRIO_PROCESS, tid, 5);
+  }
+  if (options.affinity_mask != 0) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu = 0; cpu < 64 && cpu < CPU_SETSIZE; cpu++) {
+      if (options.affinity_mask & (uint64_t(1) << cpu)) {
+        CPU_SET(cpu, &set);
+      }
+    }
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  }
+#endif
+}
+
+bool Stop_Token::stop_requested() const {
+  std::lock_guard<std::mutex> lock(state->mutex);
+  return state->stop_requested;
+}
+
+bool Stop_Token::sleep_for(std::chrono::milliseconds duration) const {
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->cv.wait_for(lock, duration, [this]() {
+    return state->stop_requested || state->wake_requested;
+  });
+
+  state->wake_requested = false;
+  return !state->stop_requested;
+}
+
+Worker_Thread::~Worker_Thread() {
+  request_stop();
+  if (thread.joinable()) {
+    thread.detach();
+  }
+}
+
+void Worker_Thread::start(std::function<void(Stop_Token)> body) {
+  if (thread.joinable()) {
+    return;
+  }
+
+  state = std::make_shared<Stop_Token::State>();
+  thread = std::thread([state = state, body]() {
+    apply_worker_thread_options();
+    body(Stop_Token(state));
+
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->finished = true;
+    state->cv.notify_all();
+  });
+}
+
+void Worker_Thread::request_stop() {
+  if (!state) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(state->mutex);
+  state->stop_requested = true;
+  state->cv.notify_all();
+}
+
+void Worker_Thread::wake() {
+  if (!state) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(state->mutex);
+  state->wake_requested = true;
+  state->cv.notify_all();
+}
+
+bool Worker_Thread::join_for(std::chrono::milliseconds timeout) {
+  if (!thread.joinable()) {
+    return true;
+  }
+
+  if (thread.get_id() == std::this_thread::get_id()) {
+    // can't wait on ourselves, returning will finish the job
+    thread.detach();
+    return false;
+  }
+
+  bool finished;
+  {
+    std::unique_lock<std::mutex> lock(state->mutex);
+    finished = state->cv.wait_for(lock, timeout,
+                                  [this]() { return state->finished; });
+  }
+
+  if (finished) {
+    // only the end of the lambda is left
+    thread.join();
+  } else {
+    thread.detach();
+  }
+  return finished;
+}
+
+bool Worker_Thread::finished() const {
+  if (!state) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(state->mutex);
+  return state->finished;
+}
+
+void Worker_Group::start(std::function<void(Stop_Token)> body) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (stopped) {
+    throw std::runtime_error("shutting down");
+  }
+
+  for (auto it = workers.begin(); it != workers.end();) {
+    if ((*it)->finished()) {
+      (*it)->join_for(std::chrono::milliseconds(0));
+      it = workers.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  workers.push_back(std::make_unique<Worker_Thread>());
+  workers.back()->start(body);
+}
+
+bool Worker_Group::stop_all(std::chrono::milliseconds timeout) {
+  std::vector<std::unique_ptr<Worker_Thread>> stopping;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopped = true;
+    stopping.swap(workers);
+  }
+
+  for (auto &worker : stopping) {
+    worker->request_stop();
+  }
+
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  bool all_finished = true;
+  for (auto &worker : stopping) {
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now());
+    if (!worker->join_for(std::max(left, std::chrono::milliseconds(0)))) {
+      all_finished = false;
+    }
+  }
+  return all_finished;
+}
@@ -0,0 +1,105 @@
+#pragma once
+#ifndef WORKER_THREAD_HPP
+#define WORKER_THREAD_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// how every thread gdrpc starts should be scheduled
+struct Thread_Options {
+  // below normal priority, so the game's own threads always win
+  bool low_priority = true;
+  // cpus the thread may run on, 0 leaves it up to the os
+  uint64_t affinity_mask = 0;
+};
+
+// set once from the config before any workers start
+Thread_Options &worker_thread_options();
+
+// applies worker_thread_options() to the calling thread
+void apply_worker_thread_options();
+
+// handed to a worker so it can notice it should stop
+class Stop_Token {
+private:
+  friend class Worker_Thread;
+
+  struct State {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stop_requested = false;
+    bool wake_requested = false;
+    bool finished = false;
+  };
+
+  std::shared_ptr<State> state;
+
+  explicit Stop_Token(std::shared_ptr<State> state) : state(state) {}
+
+public:
+  bool stop_requested() const;
+
+  // sleeps until the time is up or the thread is woken or asked to stop,
+  // returns false if it was asked to stop
+  bool sleep_for(std::chrono::milliseconds duration) const;
+};
+
+// a thread that is asked to stop instead of being left running, and that
+// can be waited on for a limited time so a stuck request never holds up
+// closing the game
+class Worker_Thread {
+private:
+  std::shared_ptr<Stop_Token::State> state;
+  std::thread thread;
+
+public:
+  Worker_Thread() = default;
+  ~Worker_Thread();
+
+  Worker_Thread(const Worker_Thread &) = delete;
+  Worker_Thread &operator=(const Worker_Thread &) = delete;
+
+  // body runs on the new thread with worker_thread_options() applied
+  void start(std::function<void(Stop_Token)> body);
+
+  void request_stop();
+
+  // cuts the worker's current sleep_for short
+  void wake();
+
+  // returns true if the thread finished in time, otherwise it's detached
+  // and left to finish on its own
+  bool join_for(std::chrono::milliseconds timeout);
+
+  bool running() const { return thread.joinable(); }
+
+  // whether the body has returned, the thread may still need a join
+  bool finished() const;
+};
+
+// short lived workers started one per job (a request, a lookup), kept so
+// they can all be stopped and waited on when gdrpc shuts down instead of
+// running on in a dll that's being unloaded
+class Worker_Group {
+private:
+  std::mutex mutex;
+  std::vector<std::unique_ptr<Worker_Thread>> workers;
+  bool stopped = false;
+
+public:
+  // joins any workers that are done first, so the list stays short
+  // throws std::runtime_error once stop_all was called
+  void start(std::function<void(Stop_Token)> body);
+
+  // asks every worker to stop and gives them timeout, together, to finish
+  // returns false if any had to be left running
+  bool stop_all(std::chrono::milliseconds timeout);
+};
+
+#endif
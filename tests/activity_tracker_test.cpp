@@ -0,0 +1,170 @@
+#include "activity_tracker.hpp"
+#include "check.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+// the loop's sleeps replayed against made up timelines of focus, input and
+// state changes, counting how often the loop would have woken up
+// before the tracker it woke every second, 3600 times an hour
+
+namespace {
+typedef Activity_Tracker::clock clock;
+using std::chrono::milliseconds;
+using std::chrono::seconds;
+
+constexpr int WAKEUPS_BEFORE = 3600;
+
+struct Event {
+  enum Kind { input, focus, state };
+
+  milliseconds at;
+  Kind kind;
+  // focused for focus, in the menu for state
+  bool value = false;
+};
+
+struct Replay {
+  int wakeups = 0;
+  // wakeups that came from an event instead of the sleep running out
+  int woken = 0;
+};
+
+// runs the loop for an hour, the tracker is told about each event at its
+// time, and an event that asks for a wake ends the sleep right there
+Replay replay(std::vector<Event> events, bool starts_in_menu = true,
+              milliseconds length = seconds(3600)) {
+  Activity_Tracker tracker;
+  auto start = clock::now();
+  tracker.record_state(starts_in_menu, start);
+
+  Replay result;
+  auto now = start;
+  size_t next = 0;
+  while (now < start + length) {
+    result.wakeups++;
+    auto wake_at = now + tracker.next_interval(now);
+
+    for (; next < events.size() && start + events[next].at < wake_at; next++) {
+      const auto &event = events[next];
+      auto at = start + event.at;
+
+      bool wake = false;
+      switch (event.kind) {
+      case Event::input:
+        wake = tracker.record_activity(at);
+        break;
+      case Event::focus:
+        wake = tracker.record_focus(event.value, at);
+        break;
+      case Event::state:
+        wake = tracker.record_state(event.value, at);
+        break;
+      }
+
+      if (wake) {
+        result.woken++;
+        wake_at = at;
+        next++;
+        break;
+      }
+    }
+
+    now = wake_at;
+  }
+  return result;
+}
+
+void test_idle_hours() {
+  // nobody touches anything in the menu: ten seconds at a second, then
+  // 2, 4, 8 and 15 seconds for the rest of the hour
+  auto menu = replay({});
+  std::printf("idle in the menu:    %4d wakeups, %d before\n", menu.wakeups,
+              WAKEUPS_BEFORE);
+  CHECK(menu.wakeups == 252);
+
+  // tabbed out of a level backs off the same way, without the ten seconds
+  auto unfocused = replay({{milliseconds(0), Event::focus, false}}, false);
+  std::printf("tabbed out:          %4d wakeups\n", unfocused.wakeups);
+  CHECK(unfocused.wakeups == 243);
+
+  // a focused level keeps changing without input, nothing is stretched
+  auto level = replay({}, false);
+  std::printf("watching a level:    %4d wakeups\n", level.wakeups);
+  CHECK(level.wakeups == WAKEUPS_BEFORE);
+  CHECK(level.woken == 0);
+}
+
+void test_input_wakes_a_long_sleep() {
+  // a mouse move every five minutes in the menu: each one lands in a 15
+  // second sleep and wakes the loop, which is active for ten seconds again
+  std::vector<Event> events;
+  for (int minute = 5; minute < 60; minute += 5) {
+    events.push_back({seconds(minute * 60 + 7), Event::input});
+  }
+  auto result = replay(events);
+  std::printf("input every 5 min:   %4d wakeups, %d of them woken\n",
+              result.wakeups, result.woken);
+  CHECK(result.woken == 11);
+  CHECK(result.wakeups > 252 && result.wakeups < 400);
+}
+
+void test_steady_input_doesnt_add_wakeups() {
+  // moving the mouse all the time only keeps the second interval, none of
+  // the thousands of moves wakes the loop on its own
+  std::vector<Event> events;
+  for (int ms = 100; ms < 3600 * 1000; ms += 50) {
+    events.push_back({milliseconds(ms), Event::input});
+  }
+  auto result = replay(events);
+  std::printf("constant input:      %4d wakeups\n", result.wakeups);
+  CHECK(result.wakeups == WAKEUPS_BEFORE);
+  CHECK(result.woken == 0);
+}
+
+void test_focus_and_state_changes() {
+  std::vector<Event> events = {
+      // tabs out of the menu, and comes back twenty minutes later
+      {seconds(60), Event::focus, false},
+      {seconds(20 * 60 + 3), Event::focus, true},
+      // into a level for ten minutes, then back to the menu
+      {seconds(25 * 60), Event::state, false},
+      {seconds(35 * 60), Event::state, true},
+  };
+  auto result = replay(events);
+  std::printf("tab out, play, menu: %4d wakeups, %d of them woken\n",
+              result.wakeups, result.woken);
+
+  // coming back and starting the level both land in a long sleep, leaving
+  // the level doesn't since it ran every second
+  CHECK(result.woken == 2);
+  // the ten minute level is 600 of them, everything else is stretched
+  CHECK(result.wakeups > 600 && result.wakeups < 900);
+}
+
+void test_away() {
+  Activity_Tracker tracker;
+  auto start = clock::now();
+  tracker.record_state(true, start);
+
+  // off by default
+  CHECK(!tracker.is_away(start + seconds(3600)));
+
+  tracker.set_idle_after(seconds(300));
+  CHECK(!tracker.is_away(start + seconds(299)));
+  CHECK(tracker.is_away(start + seconds(300)));
+
+  tracker.record_activity(start + seconds(400));
+  CHECK(!tracker.is_away(start + seconds(401)));
+}
+} // namespace
+
+int main() {
+  test_idle_hours();
+  test_input_wakes_a_long_sleep();
+  test_steady_input_doesnt_add_wakeups();
+  test_focus_and_state_changes();
+  test_away();
+  return check_result();
+}
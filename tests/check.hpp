@@ -0,0 +1,42 @@
+#pragma once
+#ifndef CHECK_HPP
+#define CHECK_HPP
+
+#include <cstdio>
+
+// just enough of a test framework for the tests here, a failed check is
+// printed and the test keeps going so one run shows every failure
+
+inline int &check_failures() {
+  static int failures = 0;
+  return failures;
+}
+
+#define CHECK(condition)                                                       \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__,    \
+                   #condition);                                                \
+      check_failures()++;                                                      \
+    }                                                                          \
+  } while (0)
+
+#define CHECK_THROWS(expression, exception)                                    \
+  do {                                                                         \
+    bool thrown = false;                                                       \
+    try {                                                                      \
+      expression;                                                              \
+    } catch (const exception &) {                                              \
+      thrown = true;                                                           \
+    }                                                                          \
+    if (!thrown) {                                                             \
+      std::fprintf(stderr, "%s:%d: %s didn't throw %s\n", __FILE__, __LINE__,  \
+                   #expression, #exception);                                   \
+      check_failures()++;                                                      \
+    }                                                                          \
+  } while (0)
+
+// what main returns
+inline int check_result() { return check_failures() == 0 ? 0 : 1; }
+
+#endif
@@ -0,0 +1,141 @@
+#include "config_cache.hpp"
+#include "config_defaults.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <toml.hpp>
+
+// startup cost of the config, parsing gdrpc.toml against loading the
+// snapshot next to it, for the stock config and a very large one
+// not run by ctest, run config_cache_bench by hand
+
+namespace {
+typedef std::chrono::steady_clock steady;
+
+template <typename F> double median_ms(int runs, F &&run) {
+  std::vector<double> times;
+  for (int i = 0; i < runs; i++) {
+    auto started = steady::now();
+    run();
+    times.push_back(
+        std::chrono::duration<double, std::milli>(steady::now() - started)
+            .count());
+  }
+  std::sort(times.begin(), times.end());
+  return times.at(times.size() / 2);
+}
+
+// hundreds of folders and rules on top of the stock config
+std::string large_config(const std::string &stock, int folders, int rules) {
+  std::ostringstream out;
+  out << stock << '\n';
+
+  for (int i = 1; i <= folders; i++) {
+    out << "[[level]] # folder " << i << "\n"
+        << "\t[level.saved]\n"
+        << "\t\tdetail = \"Attempting {name} in folder " << i << "\"\n"
+        << "\t\tstate = \"by {author} ({best}%)\"\n"
+        << "\t\tsmalltext = \"{stars}* {diff} ({id})\"\n"
+        << "\t[level.playtesting]\n"
+        << "\t\tdetail = \"Practicing {name}\"\n"
+        << "\t\tstate = \"{best}%\"\n"
+        << "\t\tsmalltext = \"{objects} objects\"\n"
+        << "[[editor]]\n"
+        << "\tdetail = \"Editing in folder " << i << "\"\n"
+        << "\tstate = \"{objects} objects\"\n"
+        << "\tsmalltext = \"\"\n"
+        << "\treset_timestamp = " << (i % 2 ? "true" : "false") << "\n";
+  }
+
+  for (int i = 0; i < rules; i++) {
+    out << "[[rule]]\n"
+        << "\tid_min = " << i * 1000 << "\n"
+        << "\tid_max = " << i * 1000 + 999 << "\n"
+        << "\tstars_min = " << i % 10 << "\n"
+        << "\tdifficulty = [\"insane\", \"extreme_demon\"]\n"
+        << "\tlevel_type = [\"saved\"]\n"
+        << "\tauthor = [\"creator" << i << "\"]\n"
+        << "\tdetail = \"Rule " << i << " on {name}\"\n"
+        << "\tstate = \"by {author} ({best}%)\"\n"
+        << "\tsmalltext = \"{stars}* {diff} ({id})\"\n";
+  }
+
+  return out.str();
+}
+
+void measure(const char *name, const std::string &text,
+             const std::filesystem::path &directory) {
+  auto filename = (directory / "gdrpc.toml").string();
+  {
+    std::ofstream toml(filename, std::ios::binary | std::ios::trunc);
+    toml << text;
+  }
+  std::filesystem::remove(filename + ".cache");
+
+  // a cold start, what every launch did before the snapshot
+  Config::Config_Format parsed;
+  auto parse_ms = median_ms(5, [&]() {
+    const toml::value config = toml::parse(filename);
+    parsed = Config::Config_Format();
+    parsed.from_toml(config);
+  });
+
+  // only after the toml changed
+  auto save_ms = median_ms(5, [&]() {
+    if (!save_config_snapshot(filename, parsed)) {
+      std::fprintf(stderr, "couldn't save the snapshot\n");
+      std::exit(1);
+    }
+  });
+
+  // every other launch
+  Config::Config_Format loaded;
+  auto load_ms = median_ms(50, [&]() {
+    if (!load_config_snapshot(filename, loaded)) {
+      std::fprintf(stderr, "snapshot didn't load\n");
+      std::exit(1);
+    }
+  });
+
+  if (loaded.level.size() != parsed.level.size() ||
+      loaded.rule.size() != parsed.rule.size()) {
+    std::fprintf(stderr, "snapshot doesn't match the toml\n");
+    std::exit(1);
+  }
+
+  auto snapshot_size =
+      std::filesystem::file_size(filename + ".cache");
+  std::printf("%-8s %7zu byte toml, %7ju byte snapshot, %4zu folders, "
+              "%4zu rules: parse %8.3fms, save %6.3fms, load %6.3fms\n",
+              name, text.size(), static_cast<uintmax_t>(snapshot_size),
+              loaded.level.size(), loaded.rule.size(), parse_ms, save_ms,
+              load_ms);
+}
+} // namespace
+
+int main() {
+  std::ifstream stock_file(GDRPC_SOURCE_DIR "/gdrpc.toml", std::ios::binary);
+  std::string stock((std::istreambuf_iterator<char>(stock_file)),
+                    std::istreambuf_iterator<char>());
+  if (stock.empty()) {
+    std::fprintf(stderr, "can't read gdrpc.toml\n");
+    return 1;
+  }
+
+  auto directory = std::filesystem::temp_directory_path() / "gdrpc_config_bench";
+  std::filesystem::create_directories(directory);
+
+  measure("stock", stock, directory);
+  measure("large", large_config(stock, 300, 1000), directory);
+
+  std::filesystem::remove_all(directory);
+  return 0;
+}
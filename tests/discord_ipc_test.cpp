@@ -0,0 +1,300 @@
+#include "check.hpp"
+#include "discord_ipc.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// stands in for the discord client, listening on the same socket path the
+// real one would use
+
+namespace {
+class Stand_In {
+private:
+  std::string path;
+  int listen_fd = -1;
+
+public:
+  int client_fd = -1;
+
+  explicit Stand_In(const std::string &directory)
+      : path(directory + "/discord-ipc-0") {
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    if (bind(listen_fd, reinterpret_cast<sockaddr *>(&address),
+             sizeof(address)) == -1 ||
+        listen(listen_fd, 1) == -1) {
+      throw std::runtime_error("can't listen on " + path);
+    }
+  }
+
+  ~Stand_In() {
+    hang_up();
+    close(listen_fd);
+    unlink(path.c_str());
+  }
+
+  void accept_client() {
+    hang_up();
+    client_fd = accept(listen_fd, nullptr, nullptr);
+
+    // so a test that goes wrong fails instead of hanging
+    timeval timeout{5, 0};
+    setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  }
+
+  void hang_up() {
+    if (client_fd != -1) {
+      close(client_fd);
+      client_fd = -1;
+    }
+  }
+
+  void write_raw(const std::string &data) {
+    size_t offset = 0;
+    while (offset < data.size()) {
+      auto written = ::send(client_fd, data.data() + offset,
+                            data.size() - offset, MSG_NOSIGNAL);
+      if (written <= 0) {
+        throw std::runtime_error("stand in write failed");
+      }
+      offset += static_cast<size_t>(written);
+    }
+  }
+
+  std::string read_raw(size_t size) {
+    std::string data(size, '\0');
+    size_t offset = 0;
+    while (offset < size) {
+      auto read = ::recv(client_fd, &data[offset], size - offset, 0);
+      if (read <= 0) {
+        throw std::runtime_error("stand in read failed");
+      }
+      offset += static_cast<size_t>(read);
+    }
+    return data;
+  }
+
+  // reads a frame, checking the header is little endian on the way
+  std::string read_frame(uint32_t &opcode) {
+    auto header = read_raw(8);
+    auto byte = [&](size_t i) {
+      return static_cast<uint32_t>(static_cast<unsigned char>(header[i]));
+    };
+    opcode = byte(0) | byte(1) << 8 | byte(2) << 16 | byte(3) << 24;
+    auto length = byte(4) | byte(5) << 8 | byte(6) << 16 | byte(7) << 24;
+    return read_raw(length);
+  }
+};
+
+std::string frame(uint32_t opcode, const std::string &payload) {
+  std::string out;
+  for (auto value : {opcode, static_cast<uint32_t>(payload.size())}) {
+    for (int shift = 0; shift < 32; shift += 8) {
+      out.push_back(static_cast<char>((value >> shift) & 0xFF));
+    }
+  }
+  return out + payload;
+}
+
+// polls like the game loop does, with a deadline so a bug can't hang the test
+bool receive_within(Discord_Ipc &ipc, Ipc_Opcode &opcode, std::string &payload,
+                    std::chrono::milliseconds timeout) {
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  while (std::chrono::steady_clock::now() < deadline) {
+    if (ipc.receive(opcode, payload)) {
+      return true;
+    }
+    std::this_thread::yield();
+  }
+  return false;
+}
+
+void test_frames(const std::string &directory) {
+  Discord_Ipc ipc;
+  CHECK(!ipc.connect());
+  CHECK(!ipc.is_connected());
+
+  Stand_In discord(directory);
+  CHECK(ipc.connect());
+  CHECK(ipc.is_connected());
+  discord.accept_client();
+
+  const std::string handshake = R"({"v":1,"client_id":"123"})";
+  CHECK(ipc.send(Ipc_Opcode::handshake, handshake));
+  uint32_t opcode = 99;
+  CHECK(discord.read_frame(opcode) == handshake);
+  CHECK(opcode == 0);
+
+  // nothing sent yet, receive doesn't block
+  Ipc_Opcode received;
+  std::string payload;
+  CHECK(!ipc.receive(received, payload));
+
+  // a frame split across writes only comes out once it's all there
+  auto ready = frame(1, R"({"cmd":"DISPATCH","evt":"READY"})");
+  discord.write_raw(ready.substr(0, 3));
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  CHECK(!ipc.receive(received, payload));
+  discord.write_raw(ready.substr(3, 10));
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  CHECK(!ipc.receive(received, payload));
+  discord.write_raw(ready.substr(13));
+  CHECK(receive_within(ipc, received, payload, std::chrono::seconds(1)));
+  CHECK(received == Ipc_Opcode::frame);
+  CHECK(payload == R"({"cmd":"DISPATCH","evt":"READY"})");
+
+  // two frames in one write, and an empty one
+  discord.write_raw(frame(3, "ping") + frame(1, "") + frame(1, "last"));
+  CHECK(receive_within(ipc, received, payload, std::chrono::seconds(1)));
+  CHECK(received == Ipc_Opcode::ping && payload == "ping");
+  CHECK(ipc.receive(received, payload));
+  CHECK(received == Ipc_Opcode::frame && payload.empty());
+  CHECK(ipc.receive(received, payload));
+  CHECK(payload == "last");
+  CHECK(!ipc.receive(received, payload));
+
+  // a length past the limit is garbage, not something to wait for
+  discord.write_raw(frame(1, "").replace(4, 4, "\x01\x00\x01\x00", 4));
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  CHECK_THROWS(ipc.receive(received, payload), std::runtime_error);
+  CHECK(!ipc.is_connected());
+
+  // discord going away shows up on the next receive
+  CHECK(ipc.connect());
+  discord.accept_client();
+  discord.hang_up();
+  CHECK_THROWS(receive_within(ipc, received, payload, std::chrono::seconds(1)),
+               std::runtime_error);
+  CHECK(!ipc.is_connected());
+  CHECK(!ipc.send(Ipc_Opcode::frame, "{}"));
+}
+
+void test_full_pipe(const std::string &directory) {
+  Discord_Ipc ipc;
+  Stand_In discord(directory);
+  CHECK(ipc.connect());
+  discord.accept_client();
+
+  // far more than the socket buffer holds, none of it may block
+  constexpr int frames = 64;
+  std::string payload(60 * 1024, 'x');
+  auto started = std::chrono::steady_clock::now();
+  for (int i = 0; i < frames; i++) {
+    payload[0] = static_cast<char>('a' + i % 26);
+    CHECK(ipc.send(Ipc_Opcode::frame, payload));
+  }
+  CHECK(std::chrono::steady_clock::now() - started < std::chrono::seconds(1));
+
+  bool in_order = true;
+  std::atomic<bool> read_all{false};
+  std::thread reader([&]() {
+    try {
+      for (int i = 0; i < frames; i++) {
+        uint32_t opcode;
+        auto read = discord.read_frame(opcode);
+        in_order = in_order && read.size() == payload.size() &&
+                   read[0] == static_cast<char>('a' + i % 26);
+      }
+    } catch (const std::runtime_error &) {
+      in_order = false;
+    }
+    read_all = true;
+  });
+
+  // the rest goes out on later flushes, as the other side reads
+  bool flushed = true;
+  while (!read_all) {
+    flushed = flushed && ipc.flush();
+    std::this_thread::yield();
+  }
+  reader.join();
+  CHECK(flushed);
+  CHECK(in_order);
+}
+
+void measure_latency(const std::string &directory) {
+  Discord_Ipc ipc;
+  Stand_In discord(directory);
+  CHECK(ipc.connect());
+  discord.accept_client();
+
+  constexpr int rounds = 2000;
+  std::thread echo([&]() {
+    try {
+      for (int i = 0; i < rounds; i++) {
+        uint32_t opcode;
+        auto payload = discord.read_frame(opcode);
+        discord.write_raw(frame(1, payload));
+      }
+    } catch (const std::runtime_error &) {
+    }
+  });
+
+  // about the size of a SET_ACTIVITY with every field filled
+  std::string activity(900, 'a');
+  std::string payload;
+  Ipc_Opcode opcode;
+  std::vector<double> round_trips;
+  for (int i = 0; i < rounds; i++) {
+    auto started = std::chrono::steady_clock::now();
+    ipc.send(Ipc_Opcode::frame, activity);
+    if (!receive_within(ipc, opcode, payload, std::chrono::seconds(1))) {
+      break;
+    }
+    round_trips.push_back(std::chrono::duration<double, std::micro>(
+                              std::chrono::steady_clock::now() - started)
+                              .count());
+  }
+  echo.join();
+  CHECK(round_trips.size() == rounds);
+  CHECK(payload == activity);
+  if (round_trips.empty()) {
+    return;
+  }
+
+  std::sort(round_trips.begin(), round_trips.end());
+  std::printf("discord_ipc: %zu round trips of a %zu byte frame, "
+              "p50 %.1fus p99 %.1fus\n",
+              round_trips.size(), activity.size(),
+              round_trips[round_trips.size() / 2],
+              round_trips[round_trips.size() * 99 / 100]);
+}
+} // namespace
+
+int main() {
+  char directory[] = "/tmp/gdrpc-ipc-XXXXXX";
+  if (!mkdtemp(directory)) {
+    std::perror("mkdtemp");
+    return 1;
+  }
+  setenv("XDG_RUNTIME_DIR", directory, 1);
+
+  try {
+    test_frames(directory);
+    test_full_pipe(directory);
+    measure_latency(directory);
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    check_failures()++;
+  }
+
+  rmdir(directory);
+  return check_result();
+}
@@ -0,0 +1,84 @@
+#include "gdapi.hpp"
+#include "stand_in_server.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+// time from launch to a presence with the player's rank, against a server
+// with an injected round trip time
+// before, the profile was asked for first and the leaderboard after it,
+// now get_ranked_user sends both at once
+// not run by ctest, run gdapi_bench by hand
+
+namespace {
+typedef std::chrono::steady_clock steady;
+
+const std::string PROFILE = "1:Player:2:5:16:71:3:100:8:2";
+
+// a relative leaderboard with the player 25th of 50, like the real one
+std::string leaderboard() {
+  std::string reply;
+  for (int i = 0; i < 50; i++) {
+    auto id = i == 24 ? 71 : 1000 + i;
+    if (i > 0) {
+      reply += '|';
+    }
+    reply += "1:Player" + std::to_string(i) + ":2:" + std::to_string(id + 5) +
+             ":16:" + std::to_string(id) + ":6:" + std::to_string(1000 + i) +
+             ":3:" + std::to_string(5000 - i);
+  }
+  return reply;
+}
+
+template <typename Lookup> double median_ms(Lookup &&lookup) {
+  std::vector<double> times;
+  for (int i = 0; i < 7; i++) {
+    auto started = steady::now();
+    lookup();
+    times.push_back(
+        std::chrono::duration<double, std::milli>(steady::now() - started)
+            .count());
+  }
+  std::sort(times.begin(), times.end());
+  return times.at(times.size() / 2);
+}
+} // namespace
+
+int main() {
+  const auto scores = leaderboard();
+  Stand_In_Server server("", [&scores](const httplib::Request &req) {
+    return req.path.find("getGJScores20") != std::string::npos ? scores
+                                                                : PROFILE;
+  });
+  auto client = std::make_shared<GD_Client>(
+      std::vector<std::string>{server.host()}, "/database/");
+
+  std::printf("%8s %14s %14s\n", "rtt", "one by one", "ranked user");
+  for (int rtt : {0, 20, 50, 100, 200}) {
+    server.delay_ms = rtt;
+
+    auto sequential = median_ms([&]() {
+      GDuser user;
+      int id = 71;
+      client->get_user_info(id, user);
+      client->get_user_rank(user);
+    });
+
+    auto concurrent = median_ms([&]() {
+      GDuser user;
+      client->get_ranked_user(71, user);
+      if (user.rank != 1024) {
+        std::fprintf(stderr, "wrong rank %d\n", user.rank);
+      }
+    });
+
+    std::printf("%6dms %12.1fms %12.1fms\n", rtt, sequential, concurrent);
+  }
+
+  client->stop();
+  return 0;
+}
@@ -0,0 +1,316 @@
+#include "check.hpp"
+#include "gdapi.hpp"
+#include "stand_in_server.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// GD_Client against a local server standing in for the gdps, counting what
+// actually goes out over the network
+
+namespace {
+typedef std::chrono::steady_clock steady;
+
+const std::string PROFILE = "1:Player:2:5:16:71:3:100:8:2:30:42";
+
+struct Lookup_Result {
+  GDuser user;
+  bool not_found = false;
+  bool failed = false;
+};
+
+Lookup_Result look_up(GD_Client &client, int account_id) {
+  Lookup_Result result;
+  try {
+    client.get_user_info(account_id, result.user);
+  } catch (const Not_Found_Error &) {
+    result.not_found = true;
+  } catch (const std::exception &) {
+    result.failed = true;
+  }
+  return result;
+}
+
+// every caller starts at once and waits on the server together
+std::vector<Lookup_Result> look_up_together(GD_Client &client, int callers,
+                                           int account_id) {
+  std::vector<Lookup_Result> results(callers);
+  std::vector<std::thread> threads;
+  std::atomic<int> ready{0};
+  for (int i = 0; i < callers; i++) {
+    threads.emplace_back([&, i]() {
+      ready++;
+      while (ready < callers) {
+        std::this_thread::yield();
+      }
+      results.at(i) = look_up(client, account_id);
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  return results;
+}
+
+void test_single_flight() {
+  Stand_In_Server server(PROFILE);
+  server.delay_ms = 200;
+  auto client = std::make_shared<GD_Client>(
+      std::vector<std::string>{server.host()}, "/database/");
+
+  // the same lookup from eight threads is one request, everyone gets its
+  // answer
+  auto results = look_up_together(*client, 8, 71);
+  CHECK(server.requests == 1);
+  for (const auto &result : results) {
+    CHECK(!result.failed && !result.not_found);
+    CHECK(result.user.name == "Player" && result.user.rank == 42);
+  }
+
+  // once it's answered the next one goes out again, nothing is cached
+  look_up(*client, 71);
+  CHECK(server.requests == 2);
+
+  // different bodies don't wait on each other
+  server.requests = 0;
+  std::thread other([&]() { look_up(*client, 72); });
+  look_up(*client, 71);
+  other.join();
+  CHECK(server.requests == 2);
+
+  client->stop();
+}
+
+void test_shared_failure() {
+  Stand_In_Server server("");
+  server.delay_ms = 200;
+  server.status = 500;
+  auto client = std::make_shared<GD_Client>(
+      std::vector<std::string>{server.host()}, "/database/");
+
+  // the callers waiting on a request that fails all get the failure
+  auto results = look_up_together(*client, 8, 71);
+  CHECK(server.requests == 1);
+  for (const auto &result : results) {
+    CHECK(result.failed && !result.not_found);
+  }
+
+  // and it's worth retrying, unlike a -1
+  server.status = 200;
+  server.reply = PROFILE;
+  CHECK(!look_up(*client, 71).failed);
+  CHECK(server.requests == 2);
+
+  client->stop();
+}
+
+void test_rejected() {
+  Stand_In_Server server("-1");
+  server.delay_ms = 100;
+  auto client = std::make_shared<GD_Client>(
+      std::vector<std::string>{server.host()}, "/database/");
+
+  auto results = look_up_together(*client, 4, 71);
+  CHECK(server.requests == 1);
+  for (const auto &result : results) {
+    CHECK(result.not_found);
+  }
+
+  // the -1 is remembered for 30 seconds, asking again doesn't go out
+  auto started = steady::now();
+  CHECK(look_up(*client, 71).not_found);
+  CHECK(steady::now() - started < std::chrono::milliseconds(50));
+  CHECK(server.requests == 1);
+
+  // only for that body
+  look_up(*client, 72);
+  CHECK(server.requests == 2);
+
+  client->stop();
+}
+
+void test_rejected_expires() {
+  Stand_In_Server server("-2");
+  auto client = std::make_shared<GD_Client>(
+      std::vector<std::string>{server.host()}, "/database/",
+      std::chrono::milliseconds(300));
+
+  CHECK(look_up(*client, 71).not_found);
+  CHECK(look_up(*client, 71).not_found);
+  CHECK(server.requests == 1);
+
+  // asked again after the time is up, and a real answer isn't remembered
+  std::this_thread::sleep_for(std::chrono::milliseconds(350));
+  server.reply = PROFILE;
+  auto result = look_up(*client, 71);
+  CHECK(!result.not_found && result.user.name == "Player");
+  CHECK(server.requests == 2);
+
+  client->stop();
+}
+
+// a relative leaderboard of count players, the one with account_id at
+// position index
+std::string leaderboard(size_t count, size_t index, int account_id) {
+  std::string reply;
+  for (size_t i = 0; i < count; i++) {
+    auto id = i == index ? account_id : 1000 + static_cast<int>(i);
+    if (i > 0) {
+      reply += '|';
+    }
+    reply += "1:Player" + std::to_string(i) + ":2:" + std::to_string(id + 5) +
+             ":16:" + std::to_string(id) + ":6:" + std::to_string(100 + i) +
+             ":3:" + std::to_string(5000 - i);
+  }
+  return reply;
+}
+
+void test_leaderboard_sizes() {
+  Stand_In_Server server("");
+  auto client = std::make_shared<GD_Client>(
+      std::vector<std::string>{server.host()}, "/database/");
+
+  // the player is usually the 25th of 50, and found anywhere otherwise,
+  // even with exactly 24 records where there's no 25th to look at
+  for (auto [count, index] : {std::pair<size_t, size_t>{50, 24},
+                              {50, 3},
+                              {24, 10},
+                              {25, 24},
+                              {1, 0}}) {
+    server.reply = leaderboard(count, index, 71);
+    GDuser user;
+    user.accID = 71;
+    bool threw = false;
+    try {
+      client->get_user_rank(user);
+    } catch (const std::exception &) {
+      threw = true;
+    }
+    CHECK(!threw);
+    CHECK(user.rank == 100 + static_cast<int>(index));
+    CHECK(user.name == "Player" + std::to_string(index));
+  }
+
+  // not on it at all
+  server.reply = leaderboard(24, 24, 71);
+  GDuser user;
+  user.accID = 71;
+  CHECK_THROWS(client->get_user_rank(user), std::runtime_error);
+  CHECK(user.rank == -1);
+
+  client->stop();
+}
+
+// the profile and the leaderboard both take a round trip, asking for both
+// at once shows the rank after one instead of two
+void test_ranked_user_in_one_round_trip() {
+  // the slower request of each lookup is still being answered when the
+  // next one starts, so the replies are swapped under a lock
+  std::mutex replies;
+  auto profile = PROFILE;
+  auto scores = leaderboard(50, 24, 71);
+  Stand_In_Server server("", [&](const httplib::Request &req) {
+    std::lock_guard<std::mutex> lock(replies);
+    return req.path.find("getGJScores20") != std::string::npos ? scores
+                                                                : profile;
+  });
+  server.delay_ms = 150;
+  auto client = std::make_shared<GD_Client>(
+      std::vector<std::string>{server.host()}, "/database/");
+
+  auto started = steady::now();
+  GDuser user;
+  client->get_ranked_user(71, user);
+  auto elapsed = steady::now() - started;
+  CHECK(user.rank == 124 || user.rank == 42);
+  CHECK(elapsed >= std::chrono::milliseconds(150) &&
+        elapsed < std::chrono::milliseconds(250));
+  CHECK(server.requests == 2);
+
+  // without a rank in the profile, the leaderboard alone is enough
+  {
+    std::lock_guard<std::mutex> lock(replies);
+    profile = "1:Player:2:5:16:71:3:100:8:2";
+  }
+  GDuser unranked_profile;
+  client->get_ranked_user(71, unranked_profile);
+  CHECK(unranked_profile.rank == 124);
+
+  // and if neither has one, the profile is still used
+  {
+    std::lock_guard<std::mutex> lock(replies);
+    scores = leaderboard(50, 24, 72);
+  }
+  GDuser unranked;
+  client->get_ranked_user(71, unranked);
+  CHECK(unranked.name == "Player" && unranked.rank == -1);
+
+  client->stop();
+}
+
+// an editor level, id 0, with only what changed marked dirty
+void test_level_fields() {
+  auto in_memory = std::make_unique<GJGameLevel>();
+  in_memory->levelType = GJLevelType::Editor;
+  in_memory->levelID = 0;
+  in_memory->levelName = "Untitled Megacollab Layout";
+  in_memory->userName = "Player";
+  in_memory->ratingsSum = 40;
+
+  GDlevel level;
+  parseGJGameLevel(in_memory.get(), level);
+  CHECK(level.dirty == ALL_LEVEL_FIELDS);
+  CHECK(level.name == "Untitled Megacollab Layout");
+  CHECK(level.author == "Player");
+  CHECK(level.difficulty == Difficulty::Harder);
+  level.dirty = 0;
+
+  parseGJGameLevel(in_memory.get(), level);
+  CHECK(level.dirty == 0);
+
+  in_memory->objectCount = 1;
+  parseGJGameLevel(in_memory.get(), level);
+  CHECK(level.dirty == level_field_bit(Level_Field::objects));
+  level.dirty = 0;
+
+  // a change anywhere in the name, past the first word of it or at the end
+  for (auto name : {"Untitled Megacollab Layouu", "Untitled Megacollab Layou",
+                    "Untitled Megacollab Layout\xE9"}) {
+    in_memory->levelName = name;
+    parseGJGameLevel(in_memory.get(), level);
+    CHECK(level.dirty == level_field_bit(Level_Field::name));
+    level.dirty = 0;
+  }
+  CHECK(level.name == "Untitled Megacollab Layout\xC3\xA9");
+
+  // the same text with a zero byte on the end is still a change
+  in_memory->userName = std::string("Player") + '\0';
+  parseGJGameLevel(in_memory.get(), level);
+  CHECK(level.dirty == level_field_bit(Level_Field::author));
+  level.dirty = 0;
+
+  in_memory->normalPercent = 50;
+  in_memory->ratingsSum = 50;
+  parseGJGameLevel(in_memory.get(), level);
+  CHECK(level.dirty == (level_field_bit(Level_Field::progress) |
+                        level_field_bit(Level_Field::rating)));
+  CHECK(level.difficulty == Difficulty::Insane);
+}
+} // namespace
+
+int main() {
+  test_single_flight();
+  test_shared_failure();
+  test_rejected();
+  test_rejected_expires();
+  test_leaderboard_sizes();
+  test_ranked_user_in_one_round_trip();
+  test_level_fields();
+  return check_result();
+}
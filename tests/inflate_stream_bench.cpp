@@ -0,0 +1,99 @@
+#include "inflate_stream.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+// inflate throughput on level-like data, against zlib for scale
+// not run by ctest, run inflate_stream_bench by hand
+
+namespace {
+// a level string, objects with an id and a position
+std::string level_string(size_t objects) {
+  std::mt19937 random(1);
+  std::string level = "kS38,1_40_2_125_3_255,kA13,0;";
+  for (size_t i = 0; i < objects; i++) {
+    auto id = random() % 10 == 0 ? 1007 : 1 + random() % 8;
+    level += "1," + std::to_string(id) + ",2," +
+             std::to_string(i * 30 + random() % 30) + ",3," +
+             std::to_string(15 + (random() % 20) * 30) + ";";
+  }
+  return level;
+}
+
+std::vector<uint8_t> gzip(const std::string &text, int level) {
+  z_stream stream{};
+  deflateInit2(&stream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+
+  std::vector<uint8_t> out(compressBound(static_cast<uLong>(text.size())) + 32);
+  stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(text.data()));
+  stream.avail_in = static_cast<uInt>(text.size());
+  stream.next_out = out.data();
+  stream.avail_out = static_cast<uInt>(out.size());
+  deflate(&stream, Z_FINISH);
+  out.resize(stream.total_out);
+  deflateEnd(&stream);
+
+  return out;
+}
+
+template <typename F> double seconds_per_run(int runs, F &&run) {
+  auto started = std::chrono::steady_clock::now();
+  for (int i = 0; i < runs; i++) {
+    run();
+  }
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       started)
+             .count() /
+         runs;
+}
+} // namespace
+
+int main() {
+  constexpr int runs = 10;
+  auto text = level_string(200000);
+
+  for (auto level : {0, 1, 6, 9}) {
+    auto compressed = gzip(text, level);
+
+    std::string out;
+    Inflate_Stream(compressed.data(), compressed.size(),
+                   [&](const char *data, size_t size) {
+                     out.append(data, size);
+                   })
+        .run();
+    if (out != text) {
+      std::fprintf(stderr, "level %d didn't round trip\n", level);
+      return 1;
+    }
+
+    size_t sink = 0;
+    auto ours = seconds_per_run(runs, [&]() {
+      Inflate_Stream(compressed.data(), compressed.size(),
+                     [&](const char *, size_t size) { sink += size; })
+          .run();
+    });
+
+    std::vector<char> buffer(text.size());
+    auto theirs = seconds_per_run(runs, [&]() {
+      z_stream stream{};
+      inflateInit2(&stream, 15 + 16);
+      stream.next_in = compressed.data();
+      stream.avail_in = static_cast<uInt>(compressed.size());
+      stream.next_out = reinterpret_cast<Bytef *>(buffer.data());
+      stream.avail_out = static_cast<uInt>(buffer.size());
+      inflate(&stream, Z_FINISH);
+      inflateEnd(&stream);
+    });
+
+    std::printf("level %d: %zu -> %zu bytes, %.0f MB/s (zlib %.0f MB/s)\n",
+                level, compressed.size(), text.size(),
+                text.size() / ours / 1e6, text.size() / theirs / 1e6);
+  }
+
+  return 0;
+}
@@ -0,0 +1,111 @@
+#include "check.hpp"
+#include "inflate_stream.hpp"
+
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef GDRPC_TEST_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+const std::string HELLO = "hello hello hello hello, gdrpc!";
+
+std::string inflate(const std::vector<uint8_t> &data) {
+  std::string out;
+  Inflate_Stream(data.data(), data.size(), [&out](const char *bytes,
+                                                  size_t size) {
+    out.append(bytes, size);
+  }).run();
+  return out;
+}
+
+void test_block_types() {
+  // zlib level 0, a single stored block
+  std::vector<uint8_t> stored = {
+      0x78, 0x01, 0x01, 0x1F, 0x00, 0xE0, 0xFF, 0x68, 0x65, 0x6C, 0x6C,
+      0x6F, 0x20, 0x68, 0x65, 0x6C, 0x6C, 0x6F, 0x20, 0x68, 0x65, 0x6C,
+      0x6C, 0x6F, 0x20, 0x68, 0x65, 0x6C, 0x6C, 0x6F, 0x2C, 0x20, 0x67,
+      0x64, 0x72, 0x70, 0x63, 0x21, 0xB8, 0x28, 0x0B, 0x2E};
+  CHECK(inflate(stored) == HELLO);
+
+  // zlib level 9, fixed codes with back references
+  std::vector<uint8_t> fixed = {0x78, 0xDA, 0xCB, 0x48, 0xCD, 0xC9,
+                                0xC9, 0x57, 0xC8, 0x40, 0x27, 0x75,
+                                0x14, 0xD2, 0x53, 0x8A, 0x0A, 0x92,
+                                0x15, 0x01, 0xB8, 0x28, 0x0B, 0x2E};
+  CHECK(inflate(fixed) == HELLO);
+
+  // the same without a header
+  std::vector<uint8_t> raw(fixed.begin() + 2, fixed.end() - 4);
+  CHECK(inflate(raw) == HELLO);
+
+  std::vector<uint8_t> gzip = {0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00,
+                               0x00, 0x02, 0x03};
+  gzip.insert(gzip.end(), raw.begin(), raw.end());
+  CHECK(inflate(gzip) == HELLO);
+}
+
+void test_malformed() {
+  // fixed block, length 3 at distance 1 before anything was written
+  std::vector<uint8_t> before_start = {0x03, 0x02, 0x00};
+  CHECK_THROWS(inflate(before_start), std::runtime_error);
+
+  // block type 3 doesn't exist
+  std::vector<uint8_t> bad_type = {0x07};
+  CHECK_THROWS(inflate(bad_type), std::runtime_error);
+
+  // stored block whose length check doesn't match
+  std::vector<uint8_t> bad_length = {0x01, 0x05, 0x00, 0x00, 0x00};
+  CHECK_THROWS(inflate(bad_length), std::runtime_error);
+
+  // ends in the middle of the stored data
+  std::vector<uint8_t> truncated = {0x01, 0x05, 0x00, 0xFA, 0xFF, 'a'};
+  CHECK_THROWS(inflate(truncated), std::runtime_error);
+}
+
+#ifdef GDRPC_TEST_ZLIB
+std::vector<uint8_t> deflate(const std::string &text, int level) {
+  auto size = compressBound(static_cast<uLong>(text.size()));
+  std::vector<uint8_t> out(size);
+  compress2(out.data(), &size, reinterpret_cast<const Bytef *>(text.data()),
+            static_cast<uLong>(text.size()), level);
+  out.resize(size);
+  return out;
+}
+
+// level strings are long runs of similar objects, with dynamic blocks and
+// references across the whole window
+void test_zlib_round_trip() {
+  std::mt19937 random(26);
+  std::string level;
+  while (level.size() < 300000) {
+    level += "1," + std::to_string(random() % 1900) + ",2," +
+             std::to_string(random() % 20000) + ",3," +
+             std::to_string(random() % 600) + ";";
+    if (random() % 50 == 0) {
+      // something that doesn't compress
+      for (int i = 0; i < 200; i++) {
+        level.push_back(static_cast<char>(random()));
+      }
+    }
+  }
+
+  for (int compression : {0, 1, 6, 9}) {
+    CHECK(inflate(deflate(level, compression)) == level);
+  }
+}
+#endif
+} // namespace
+
+int main() {
+  test_block_types();
+  test_malformed();
+#ifdef GDRPC_TEST_ZLIB
+  test_zlib_round_trip();
+#endif
+  return check_result();
+}
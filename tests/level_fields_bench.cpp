@@ -0,0 +1,134 @@
+#include "gdapi.hpp"
+#include "gjgamelevel.hpp"
+#include "text_encoding.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+// parseGJGameLevel in the editor, where the level id is always 0 and the
+// object count changes with every object placed, against copying every
+// field each time like it did before fields were tracked
+// the templates are formatted by the game loop, which doesn't build here,
+// so what's shown is which fields end up dirty for it
+// not run by ctest, run level_fields_bench by hand
+
+namespace {
+typedef std::chrono::steady_clock steady;
+
+constexpr int UPDATES = 200000;
+
+// what parseGJGameLevel did before in the editor, it never returned early
+void copy_every_field(GJGameLevel *in_memory, GDlevel &level) {
+  level.levelID = in_memory->levelID;
+  level.stars = in_memory->stars;
+  level.audioTrack = in_memory->audioTrack;
+  level.songID = in_memory->songID;
+
+  level.name = in_memory->levelName;
+  normalize_text(level.name);
+
+  level.isDemon = static_cast<bool>(in_memory->demon);
+  level.isAuto = in_memory->autoLevel;
+
+  level.author = in_memory->userName;
+  normalize_text(level.author);
+  level.authorID = in_memory->userID;
+  level.authorAccountID = in_memory->accountID;
+  level.difficulty = static_cast<Difficulty>(in_memory->ratingsSum / 10);
+
+  if (level.isDemon) {
+    level.demonDifficulty = getDemonDiffValue(in_memory->demonDifficulty);
+  }
+}
+
+template <typename Update> double median_ns(Update &&update) {
+  std::vector<double> times;
+  for (int run = 0; run < 11; run++) {
+    auto started = steady::now();
+    for (int i = 0; i < UPDATES; i++) {
+      update(i);
+    }
+    times.push_back(
+        std::chrono::duration<double, std::nano>(steady::now() - started)
+            .count() /
+        UPDATES);
+  }
+  std::sort(times.begin(), times.end());
+  return times.at(times.size() / 2);
+}
+
+std::string dirty_names(uint32_t dirty) {
+  const char *names[] = {"id",       "name",     "author", "rating",
+                         "song",     "progress", "objects", "stats",
+                         "profile",  "history"};
+  std::string out;
+  for (size_t i = 0; i < std::size(names); i++) {
+    if (dirty & (1u << i)) {
+      out += out.empty() ? "" : " ";
+      out += names[i];
+    }
+  }
+  return out.empty() ? "nothing" : out;
+}
+} // namespace
+
+int main() {
+  // names past the small string buffer, like most real ones
+  auto editing = std::make_unique<GJGameLevel>();
+  editing->levelType = GJLevelType::Editor;
+  editing->levelID = 0;
+  editing->levelName = "Untitled Megacollab Layout (part 3)";
+  editing->userName = "SomeCreatorName_With_A_Long_Tag";
+  editing->userID = 71;
+  editing->accountID = 71;
+  editing->ratingsSum = 40;
+
+  GDlevel tracked;
+  GDlevel copied;
+
+  // an object placed on every update, the loop renders and clears dirty
+  auto copying = median_ns([&](int i) {
+    editing->objectCount = i;
+    copy_every_field(editing.get(), copied);
+  });
+  auto tracking = median_ns([&](int i) {
+    editing->objectCount = i;
+    parseGJGameLevel(editing.get(), tracked);
+    tracked.dirty = 0;
+  });
+
+  // nothing changed at all, an update with the editor idle
+  auto idle = median_ns([&](int) {
+    parseGJGameLevel(editing.get(), tracked);
+    tracked.dirty = 0;
+  });
+
+  // the level renamed on every update, the worst case for tracking
+  std::string names[] = {editing->levelName, editing->levelName + " v2"};
+  auto renaming = median_ns([&](int i) {
+    editing->levelName = names[i & 1];
+    parseGJGameLevel(editing.get(), tracked);
+    tracked.dirty = 0;
+  });
+  auto renaming_copied = median_ns([&](int i) {
+    editing->levelName = names[i & 1];
+    copy_every_field(editing.get(), copied);
+  });
+
+  std::printf("%-26s %12s %12s\n", "editor update", "copy all", "tracked");
+  std::printf("%-26s %10.1fns %10.1fns\n", "object placed", copying,
+              tracking);
+  std::printf("%-26s %10.1fns %10.1fns\n", "level renamed", renaming_copied,
+              renaming);
+  std::printf("%-26s %12s %10.1fns\n", "nothing changed", "", idle);
+
+  editing->objectCount++;
+  parseGJGameLevel(editing.get(), tracked);
+  std::printf("dirty after an object is placed: %s\n",
+              dirty_names(tracked.dirty).c_str());
+  return 0;
+}
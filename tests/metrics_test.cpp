@@ -0,0 +1,200 @@
+#include "check.hpp"
+#include "metrics.hpp"
+#include "stand_in_server.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <httplib.h>
+
+// the histogram and the text it renders, then /metrics and /telemetry
+// scraped over http the way prometheus or curl would
+
+namespace {
+bool contains(const std::string &text, const std::string &part) {
+  return text.find(part) != std::string::npos;
+}
+
+void test_histogram() {
+  Histogram histogram;
+  CHECK(histogram.quantile(0.5) == 0.0);
+
+  for (double seconds : {0.0005, 0.003, 0.003, 0.2, 10.0}) {
+    histogram.observe(seconds);
+  }
+  CHECK(histogram.get_count() == 5);
+  CHECK(std::fabs(histogram.get_sum() - 10.2065) < 1e-5);
+
+  // half of five is in the 2.5-5ms bucket, three quarters of the way in
+  auto median = histogram.quantile(0.5);
+  CHECK(median > 0.0025 && median <= 0.005);
+  CHECK(std::fabs(median - 0.004375) < 1e-9);
+  // past the last bound
+  CHECK(histogram.quantile(1.0) == Histogram::BOUNDS.back());
+
+  // buckets are cumulative, +Inf and _count are everything
+  std::string out;
+  histogram.write(out, "x", "");
+  CHECK(contains(out, "x_bucket{le=\"0.001\"} 1\n"));
+  CHECK(contains(out, "x_bucket{le=\"0.0025\"} 1\n"));
+  CHECK(contains(out, "x_bucket{le=\"0.005\"} 3\n"));
+  CHECK(contains(out, "x_bucket{le=\"0.25\"} 4\n"));
+  CHECK(contains(out, "x_bucket{le=\"5\"} 4\n"));
+  CHECK(contains(out, "x_bucket{le=\"+Inf\"} 5\n"));
+  CHECK(contains(out, "x_count 5\n"));
+
+  out.clear();
+  histogram.write(out, "x", "a=\"b\"");
+  CHECK(contains(out, "x_bucket{a=\"b\",le=\"+Inf\"} 5\n"));
+  CHECK(contains(out, "x_count{a=\"b\"} 5\n"));
+}
+
+void test_endpoints() {
+  auto &endpoints = get_metrics()->get_endpoints();
+  CHECK(&get_metrics()->endpoint("getGJScores20.php") == &endpoints.at(2));
+  CHECK(&get_metrics()->endpoint("uploadGJLevel21.php") == &endpoints.back());
+  CHECK(endpoints.back().name == "other");
+
+  // a timeout is counted but kept out of the timing histograms
+  Endpoint_Metrics endpoint;
+  Request_Timing timing;
+  timing.total = 10.0;
+  endpoint.record(timing);
+  CHECK(endpoint.requests == 1);
+  CHECK(endpoint.outcomes.at(3) == 1);
+  CHECK(endpoint.latency.get_count() == 0);
+}
+
+// every sample line is a name, optional labels and a number, and belongs to
+// a family that was announced with # TYPE
+bool well_formed(const std::string &text) {
+  std::istringstream lines(text);
+  std::set<std::string> families;
+  std::string line;
+  while (std::getline(lines, line)) {
+    if (line.rfind("# TYPE ", 0) == 0) {
+      families.insert(line.substr(7, line.find(' ', 7) - 7));
+      continue;
+    }
+    if (line.rfind("# HELP ", 0) == 0) {
+      continue;
+    }
+
+    auto name_end = line.find_first_of("{ ");
+    auto value_start = line.rfind(' ');
+    if (name_end == std::string::npos || value_start == std::string::npos) {
+      return false;
+    }
+
+    auto name = line.substr(0, name_end);
+    bool announced = false;
+    for (const char *suffix : {"", "_bucket", "_sum", "_count"}) {
+      auto length = std::string(suffix).size();
+      if (name.size() > length &&
+          name.compare(name.size() - length, length, suffix) == 0 &&
+          families.count(name.substr(0, name.size() - length))) {
+        announced = true;
+      }
+    }
+
+    char *end;
+    std::strtod(line.c_str() + value_start + 1, &end);
+    if (!announced || *end != '\0') {
+      return false;
+    }
+  }
+  return !families.empty();
+}
+
+void test_scrape() {
+  auto metrics = get_metrics();
+  metrics->presence_sent += 7;
+  metrics->count_hook(Hook_Id::MenuLayer_init);
+  metrics->count_hook(Hook_Id::MenuLayer_init);
+  metrics->count_hook(Hook_Id::MenuLayer_init);
+
+  Request_Timing timing;
+  timing.outcome = Request_Outcome::ok;
+  timing.total = 0.03;
+  timing.first_byte = 0.02;
+  timing.transfer = 0.01;
+  timing.size = 512;
+  metrics->endpoint("getGJUserInfo20.php").record(timing);
+
+  // a port that was free a moment ago
+  int port;
+  {
+    Stand_In_Server probe("");
+    port = probe.get_port();
+  }
+
+  Metrics_Server server;
+  server.start(port);
+
+  httplib::Client client("127.0.0.1", port);
+  auto res = client.Get("/metrics");
+  CHECK(res && res->status == 200);
+  if (res) {
+    CHECK(res->get_header_value("Content-Type")
+              .rfind("text/plain; version=0.0.4", 0) == 0);
+    CHECK(well_formed(res->body));
+    CHECK(contains(res->body,
+                   "gdrpc_presence_updates_total{result=\"sent\"} 7\n"));
+    CHECK(contains(res->body, "gdrpc_hook_invocations_total"
+                              "{hook=\"MenuLayer::init\"} 3\n"));
+    CHECK(contains(res->body, "gdrpc_requests_total"
+                              "{endpoint=\"getGJUserInfo20.php\"} 1\n"));
+    CHECK(contains(res->body, "gdrpc_request_outcomes_total"
+                              "{endpoint=\"getGJUserInfo20.php\","
+                              "outcome=\"ok\"} 1\n"));
+    CHECK(contains(res->body, "gdrpc_response_bytes_total"
+                              "{endpoint=\"getGJUserInfo20.php\"} 512\n"));
+    CHECK(contains(res->body, "gdrpc_request_duration_seconds_bucket"
+                              "{endpoint=\"getGJUserInfo20.php\","
+                              "le=\"0.05\"} 1\n"));
+  }
+
+  res = client.Get("/telemetry");
+  CHECK(res && res->status == 200);
+  if (res) {
+    CHECK(contains(res->body, "getGJUserInfo20.php: 1 requests, 1 ok 0 "
+                              "rejected 0 http_error 0 no_response, "
+                              "512 bytes\n"));
+    // endpoints nothing was sent to are left out
+    CHECK(!contains(res->body, "getGJScores20.php"));
+  }
+
+  res = client.Get("/nothing");
+  CHECK(res && res->status == 404);
+
+  // stopped means nothing answers, and it can be started again
+  // the listener is joined with a timeout, an idle one is done right away
+  auto stopping = std::chrono::steady_clock::now();
+  server.stop();
+  CHECK(std::chrono::steady_clock::now() - stopping <
+        std::chrono::milliseconds(250));
+  CHECK(!client.Get("/metrics"));
+  server.start(port);
+  res = client.Get("/metrics");
+  CHECK(res && res->status == 200);
+}
+
+void test_taken_port() {
+  Stand_In_Server taken("");
+  Metrics_Server server;
+  CHECK_THROWS(server.start(taken.get_port()), std::runtime_error);
+}
+} // namespace
+
+int main() {
+  test_histogram();
+  test_endpoints();
+  test_scrape();
+  test_taken_port();
+  return check_result();
+}
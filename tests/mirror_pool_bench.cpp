@@ -0,0 +1,335 @@
+#include "mirror_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <httplib.h>
+
+#ifdef CPPHTTPLIB_OPENSSL_SUPPORT
+#include <openssl/ec.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+#endif
+
+// bytes on the wire and latency of a leaderboard request, the way GD_Client
+// used to send it against the way Mirror_Pool sends it now
+// every connection goes through a local proxy that counts what it forwards
+// not run by ctest, run mirror_pool_bench by hand
+
+namespace {
+typedef std::chrono::steady_clock steady;
+
+// forwards every connection to the server, counting bytes both ways
+class Counting_Proxy {
+private:
+  int listen_fd;
+  int target_port;
+  std::atomic<bool> closing{false};
+  std::thread accept_thread;
+  std::vector<std::thread> pumps;
+
+  void pump(int client) {
+    int server = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(target_port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(server, reinterpret_cast<sockaddr *>(&address),
+                  sizeof(address)) == -1) {
+      close(client);
+      close(server);
+      return;
+    }
+
+    // forwarded as soon as it's read, so the proxy doesn't add delayed acks
+    int yes = 1;
+    setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+    setsockopt(server, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+
+    pollfd fds[2] = {{client, POLLIN, 0}, {server, POLLIN, 0}};
+    char buffer[16384];
+    while (!closing) {
+      if (poll(fds, 2, 50) <= 0) {
+        continue;
+      }
+
+      bool open = true;
+      for (int i = 0; i < 2 && open; i++) {
+        if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+          continue;
+        }
+        auto read = recv(fds[i].fd, buffer, sizeof(buffer), 0);
+        if (read <= 0 ||
+            send(fds[1 - i].fd, buffer, static_cast<size_t>(read),
+                 MSG_NOSIGNAL) != read) {
+          open = false;
+          break;
+        }
+        (i == 0 ? sent : received) += static_cast<size_t>(read);
+      }
+      if (!open) {
+        break;
+      }
+    }
+
+    close(client);
+    close(server);
+  }
+
+public:
+  std::atomic<size_t> sent{0};
+  std::atomic<size_t> received{0};
+  std::atomic<size_t> connections{0};
+  int port;
+
+  explicit Counting_Proxy(int n_target_port) : target_port(n_target_port) {
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(listen_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address));
+    listen(listen_fd, 64);
+
+    socklen_t size = sizeof(address);
+    getsockname(listen_fd, reinterpret_cast<sockaddr *>(&address), &size);
+    port = ntohs(address.sin_port);
+
+    accept_thread = std::thread([this]() {
+      pollfd fd{listen_fd, POLLIN, 0};
+      while (!closing) {
+        if (poll(&fd, 1, 50) <= 0) {
+          continue;
+        }
+        auto client = accept(listen_fd, nullptr, nullptr);
+        if (client != -1) {
+          connections++;
+          pumps.emplace_back(&Counting_Proxy::pump, this, client);
+        }
+      }
+    });
+  }
+
+  ~Counting_Proxy() {
+    closing = true;
+    accept_thread.join();
+    for (auto &pump : pumps) {
+      pump.join();
+    }
+    close(listen_fd);
+  }
+
+  void reset() {
+    sent = 0;
+    received = 0;
+    connections = 0;
+  }
+};
+
+// a getGJScores20 reply for 100 players, about what robtop's servers send
+std::string leaderboard() {
+  std::string reply;
+  for (int i = 1; i <= 100; i++) {
+    if (i > 1) {
+      reply += '|';
+    }
+    auto n = std::to_string(i);
+    reply += "1:Player" + n + ":2:" + std::to_string(1000000 + i * 7919) +
+             ":13:" + std::to_string(140 - i) + ":17:" +
+             std::to_string(2000 - i * 3) + ":6:" + n + ":9:" +
+             std::to_string(i % 100) + ":10:" + std::to_string(i % 40) +
+             ":11:" + std::to_string(i % 40) + ":14:0:15:2:16:" +
+             std::to_string(7000000 + i * 131) + ":3:" +
+             std::to_string(30000 - i * 97) + ":8:" + std::to_string(i * 3) +
+             ":46:" + std::to_string(i * 11) + ":4:" + std::to_string(i * 5);
+  }
+  return reply;
+}
+
+void serve(httplib::Server &server, const std::string &reply, int &port,
+           std::thread &thread) {
+  server.Post(".*", [&reply](const httplib::Request &, httplib::Response &res) {
+    res.set_content(reply, "text/plain");
+  });
+  port = server.bind_to_any_port("127.0.0.1");
+  thread = std::thread([&server]() { server.listen_after_bind(); });
+  while (!server.is_running()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+struct Variant {
+  const char *name;
+  bool keep_alive;
+  bool compressed;
+};
+
+const std::string FORM = "gameVersion=21&binaryVersion=35&type=top&count=100"
+                         "&secret=Wmfd2893gb7";
+constexpr int REQUESTS = 200;
+
+template <typename Post>
+void measure(const char *name, Counting_Proxy &proxy, Post &&post) {
+  // the first request isn't counted, so every variant starts with its
+  // connection in the same state
+  post();
+  proxy.reset();
+
+  std::vector<double> latencies;
+  for (int i = 0; i < REQUESTS; i++) {
+    auto started = steady::now();
+    if (!post()) {
+      std::printf("%-36s request failed\n", name);
+      return;
+    }
+    latencies.push_back(std::chrono::duration<double, std::micro>(
+                            steady::now() - started)
+                            .count());
+  }
+
+  std::sort(latencies.begin(), latencies.end());
+  std::printf("%-36s %6zu up %7zu down %4zu connections  p50 %7.1fus  p99 "
+              "%7.1fus\n",
+              name, proxy.sent / REQUESTS, proxy.received / REQUESTS,
+              proxy.connections.load(), latencies[REQUESTS / 2],
+              latencies[REQUESTS * 99 / 100]);
+}
+
+void measure_client(const Variant &variant, const std::string &host,
+                    Counting_Proxy &proxy) {
+  std::unique_ptr<httplib::Client> client;
+  auto make_client = [&]() {
+    client = std::make_unique<httplib::Client>(host);
+    client->set_keep_alive(variant.keep_alive);
+    client->set_decompress(variant.compressed);
+#ifdef CPPHTTPLIB_OPENSSL_SUPPORT
+    // the stand in's certificate is self signed
+    client->enable_server_certificate_verification(false);
+#endif
+  };
+  make_client();
+
+  measure(variant.name, proxy, [&]() {
+    // before, GD_Client made a new client for each lookup
+    if (!variant.keep_alive) {
+      make_client();
+    }
+    httplib::Headers headers{
+        {"Accept-Encoding", variant.compressed ? "gzip, deflate" : "identity"}};
+    auto res = client->Post("/database/getGJScores20.php", headers, FORM,
+                            "application/x-www-form-urlencoded");
+    return res && res->status == 200;
+  });
+}
+
+#ifdef CPPHTTPLIB_OPENSSL_SUPPORT
+// a throwaway P-256 certificate for 127.0.0.1
+void make_certificate(EVP_PKEY *&key, X509 *&cert) {
+  auto context = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+  EVP_PKEY_keygen_init(context);
+  EVP_PKEY_CTX_set_ec_paramgen_curve_nid(context, NID_X9_62_prime256v1);
+  key = nullptr;
+  EVP_PKEY_keygen(context, &key);
+  EVP_PKEY_CTX_free(context);
+
+  cert = X509_new();
+  X509_set_version(cert, 2);
+  ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+  X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+  X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+  X509_set_pubkey(cert, key);
+  auto name = X509_get_subject_name(cert);
+  X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                             reinterpret_cast<const unsigned char *>(
+                                 "127.0.0.1"),
+                             -1, -1, 0);
+  X509_set_issuer_name(cert, name);
+  X509_sign(cert, key, EVP_sha256());
+}
+#endif
+} // namespace
+
+int main() {
+  // a tls peer going away mid write shouldn't end the run
+  std::signal(SIGPIPE, SIG_IGN);
+
+  const auto reply = leaderboard();
+  std::printf("leaderboard reply: %zu bytes, %d requests each, bytes are per "
+              "request\n\n",
+              reply.size(), REQUESTS);
+
+  const Variant variants[] = {
+      {"new connection, uncompressed", false, false},
+      {"new connection, gzip", false, true},
+      {"kept alive, uncompressed", true, false},
+      {"kept alive, gzip", true, true},
+  };
+
+  {
+    httplib::Server server;
+    int port;
+    std::thread thread;
+    serve(server, reply, port, thread);
+
+    Counting_Proxy proxy(port);
+    auto host = "http://127.0.0.1:" + std::to_string(proxy.port);
+    std::printf("http\n");
+    for (const auto &variant : variants) {
+      measure_client(variant, host, proxy);
+    }
+
+    // the pool itself, which keeps its clients between posts
+    auto pool = std::make_shared<Mirror_Pool>(std::vector<std::string>{host});
+    measure("mirror pool", proxy, [&]() {
+      Request_Timing timing;
+      return !pool->post("/database/getGJScores20.php", FORM, timing).empty();
+    });
+    pool->stop(std::chrono::milliseconds(250));
+
+    server.stop();
+    thread.join();
+  }
+
+#ifdef CPPHTTPLIB_OPENSSL_SUPPORT
+  {
+    EVP_PKEY *key;
+    X509 *cert;
+    make_certificate(key, cert);
+
+    httplib::SSLServer server(cert, key);
+    int port;
+    std::thread thread;
+    serve(server, reply, port, thread);
+
+    Counting_Proxy proxy(port);
+    auto host = "https://127.0.0.1:" + std::to_string(proxy.port);
+    std::printf("\nhttps\n");
+    for (const auto &variant : variants) {
+      measure_client(variant, host, proxy);
+    }
+
+    server.stop();
+    thread.join();
+    X509_free(cert);
+    EVP_PKEY_free(key);
+  }
+#else
+  std::printf("\nhttps skipped, httplib was built without OpenSSL\n");
+#endif
+
+  return 0;
+}
@@ -0,0 +1,138 @@
+#include "check.hpp"
+#include "mirror_pool.hpp"
+#include "stand_in_server.hpp"
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+// mirrors are local servers with fixed delays, so which one answers and
+// when the backup request goes out can be checked against the clock
+
+namespace {
+typedef std::chrono::steady_clock steady;
+
+struct Posted {
+  std::string body;
+  double ms = 0.0;
+  bool threw = false;
+  std::string error;
+};
+
+Posted post(Mirror_Pool &pool) {
+  Posted posted;
+  Request_Timing timing;
+  auto started = steady::now();
+  try {
+    posted.body = pool.post("/database/getGJUserInfo20.php", "targetAccountID=71",
+                            timing);
+  } catch (const std::runtime_error &e) {
+    posted.threw = true;
+    posted.error = e.what();
+  }
+  posted.ms = std::chrono::duration<double, std::milli>(steady::now() - started)
+                  .count();
+  return posted;
+}
+
+std::shared_ptr<Mirror_Pool> make_pool(std::vector<std::string> hosts) {
+  return std::make_shared<Mirror_Pool>(std::move(hosts),
+                                       std::chrono::seconds(2));
+}
+
+void test_hedging() {
+  Stand_In_Server slow("slow"), fast("fast");
+  slow.delay_ms = 600;
+  fast.delay_ms = 10;
+  auto pool = make_pool({slow.host(), fast.host()});
+
+  // nothing is known yet, so the configured order goes first and the backup
+  // goes out after the default 500ms
+  auto first = post(*pool);
+  CHECK(first.body == "fast");
+  CHECK(first.ms >= 450 && first.ms < 600);
+  CHECK(slow.requests == 1 && fast.requests == 1);
+
+  // the mirror that answered is ranked first now, the other was cancelled
+  // and still has no samples
+  auto second = post(*pool);
+  CHECK(second.body == "fast");
+  CHECK(second.ms < 300);
+  CHECK(slow.requests == 1 && fast.requests == 2);
+
+  // with enough samples the backup waits for the p95, about 10ms here,
+  // clamped up to 50ms
+  for (int i = 0; i < 5; i++) {
+    post(*pool);
+  }
+  CHECK(slow.requests == 1);
+
+  fast.delay_ms = 1000;
+  slow.delay_ms = 10;
+  auto hedged = post(*pool);
+  CHECK(hedged.body == "slow");
+  CHECK(hedged.ms >= 50 && hedged.ms < 400);
+  CHECK(slow.requests == 2);
+}
+
+void test_failover() {
+  Stand_In_Server broken("broken"), working("working");
+  broken.status = 500;
+  auto pool = make_pool({broken.host(), working.host()});
+
+  // a failure moves on right away instead of waiting out the hedge delay
+  auto first = post(*pool);
+  CHECK(first.body == "working");
+  CHECK(first.ms < 250);
+  CHECK(broken.requests == 1 && working.requests == 1);
+
+  // the failure counted as a timeout, so the working mirror goes first
+  auto second = post(*pool);
+  CHECK(second.body == "working");
+  CHECK(broken.requests == 1 && working.requests == 2);
+
+  working.status = 500;
+  auto failed = post(*pool);
+  CHECK(failed.threw);
+  CHECK(failed.error == "server returned status 500");
+  CHECK(broken.requests == 2 && working.requests == 3);
+
+  auto none = make_pool({});
+  Request_Timing timing;
+  CHECK_THROWS(none->post("/", "", timing), std::runtime_error);
+}
+
+void test_stop() {
+  Stand_In_Server stuck("stuck");
+  stuck.delay_ms = 5000;
+  auto pool = make_pool({stuck.host()});
+
+  auto posting = std::async(std::launch::async, [&]() { return post(*pool); });
+  while (stuck.requests == 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  // the request in flight is cut short, not waited out
+  auto started = steady::now();
+  pool->stop(std::chrono::milliseconds(250));
+  CHECK(steady::now() - started < std::chrono::milliseconds(500));
+
+  auto cancelled = posting.get();
+  CHECK(cancelled.threw);
+  CHECK(cancelled.ms < 1000);
+
+  auto after = post(*pool);
+  CHECK(after.threw);
+  CHECK(after.error == "shutting down");
+  CHECK(stuck.requests == 1);
+}
+} // namespace
+
+int main() {
+  test_hedging();
+  test_failover();
+  test_stop();
+  return check_result();
+}
@@ -0,0 +1,111 @@
+#include "play_history.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+// a player with tens of thousands of levels behind them: recording
+// sessions, opening the history at launch with and without a usable index,
+// and the lookups behind {sessions} and {total_time}
+// not run by ctest, run play_history_bench by hand
+
+namespace {
+typedef std::chrono::steady_clock steady;
+
+constexpr int SESSIONS = 60000;
+constexpr int LEVELS = 50000;
+
+double ms_since(steady::time_point started) {
+  return std::chrono::duration<double, std::milli>(steady::now() - started)
+      .count();
+}
+
+template <typename F> double median_ms(int runs, F &&run) {
+  std::vector<double> times;
+  for (int i = 0; i < runs; i++) {
+    auto started = steady::now();
+    run();
+    times.push_back(ms_since(started));
+  }
+  std::sort(times.begin(), times.end());
+  return times.at(times.size() / 2);
+}
+} // namespace
+
+int main() {
+  auto directory =
+      std::filesystem::temp_directory_path() / "gdrpc_play_history_bench";
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directories(directory);
+  auto log = (directory / "gdrpc_play_history.log").string();
+  auto index = (directory / "gdrpc_play_history.idx").string();
+
+  // level ids spread like real ones, some played more than once
+  std::mt19937 random(44);
+  std::vector<int> levels(LEVELS);
+  for (auto &level : levels) {
+    level = 1 + static_cast<int>(random() % 100000000);
+  }
+
+  auto started = steady::now();
+  {
+    Play_History history(log, index);
+    history.open();
+    for (int i = 0; i < SESSIONS; i++) {
+      auto level = levels[i < LEVELS ? i : random() % LEVELS];
+      history.playing(level, 0, 0);
+      history.playing(level, 1 + i % 20, i % 100);
+      history.stopped();
+    }
+  }
+  std::printf("%d sessions over %d levels: %.2fus per session recorded\n",
+              SESSIONS, LEVELS, ms_since(started) * 1000.0 / SESSIONS);
+  std::printf("log %ju bytes, index %ju bytes\n",
+              static_cast<uintmax_t>(std::filesystem::file_size(log)),
+              static_cast<uintmax_t>(std::filesystem::file_size(index)));
+
+  // every launch, the index covers the log and is used as is
+  auto opening = median_ms(21, [&]() {
+    Play_History history(log, index);
+    history.open();
+  });
+  std::printf("open with index:    %7.3fms\n", opening);
+
+  // the index is gone (or doesn't match), it's rebuilt from the log
+  auto rebuilding = median_ms(11, [&]() {
+    std::filesystem::remove(index);
+    Play_History history(log, index);
+    history.open();
+  });
+  std::printf("open and rebuild:   %7.3fms\n", rebuilding);
+
+  Play_History history(log, index);
+  history.open();
+
+  constexpr int LOOKUPS = 1000000;
+  Play_Stats stats;
+  uint64_t found = 0;
+  started = steady::now();
+  for (int i = 0; i < LOOKUPS; i++) {
+    found += history.lookup(levels[i % LEVELS], stats) ? stats.sessions : 0;
+  }
+  std::printf("lookup, played:     %7.1fns (%ju sessions seen)\n",
+              ms_since(started) * 1e6 / LOOKUPS,
+              static_cast<uintmax_t>(found));
+
+  // levels that were never played, which is most of them
+  size_t misses = 0;
+  started = steady::now();
+  for (int i = 0; i < LOOKUPS; i++) {
+    misses += !history.lookup(100000001 + i, stats);
+  }
+  std::printf("lookup, never:      %7.1fns (%zu misses)\n",
+              ms_since(started) * 1e6 / LOOKUPS, misses);
+
+  std::filesystem::remove_all(directory);
+  return 0;
+}
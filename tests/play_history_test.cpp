@@ -0,0 +1,184 @@
+#include "check.hpp"
+#include "play_history.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace {
+// sizes of the header and records in the log
+constexpr uint64_t HEADER_SIZE = 16;
+constexpr uint64_t RECORD_SIZE = 32;
+
+struct Files {
+  std::string log;
+  std::string index;
+
+  Files(const char *name) {
+    auto directory = std::filesystem::temp_directory_path();
+    log = (directory / (std::string(name) + ".log")).string();
+    index = (directory / (std::string(name) + ".idx")).string();
+    remove();
+  }
+
+  ~Files() { remove(); }
+
+  void remove() {
+    std::filesystem::remove(log);
+    std::filesystem::remove(index);
+  }
+};
+
+void play(Play_History &history, int levelID, int attempts) {
+  history.playing(levelID, 10, 0);
+  history.playing(levelID, 10 + attempts, 50);
+  history.stopped();
+}
+
+uint32_t sessions(const Play_History &history, int levelID) {
+  Play_Stats stats;
+  return history.lookup(levelID, stats) ? stats.sessions : 0;
+}
+
+void test_sessions() {
+  Files files("gdrpc_test_play_history");
+  {
+    Play_History history(files.log, files.index);
+    history.open();
+    CHECK(sessions(history, 128) == 0);
+
+    play(history, 128, 5);
+    play(history, 128, 2);
+    play(history, 4284013, 1);
+    // switching levels finishes the session in progress
+    history.playing(128, 1, 0);
+    history.playing(4284013, 1, 0);
+    history.stopped();
+
+    // local levels aren't recorded
+    play(history, 0, 3);
+    history.stopped();
+
+    CHECK(sessions(history, 128) == 3);
+    CHECK(sessions(history, 4284013) == 2);
+    CHECK(sessions(history, 0) == 0);
+  }
+  CHECK(std::filesystem::file_size(files.log) == HEADER_SIZE + 5 * RECORD_SIZE);
+
+  // the index is still current, and gets used as is
+  {
+    Play_History history(files.log, files.index);
+    history.open();
+    CHECK(sessions(history, 128) == 3);
+    CHECK(sessions(history, 4284013) == 2);
+  }
+
+  // without it everything is counted again from the log
+  std::filesystem::remove(files.index);
+  Play_History history(files.log, files.index);
+  history.open();
+  CHECK(sessions(history, 128) == 3);
+  CHECK(sessions(history, 4284013) == 2);
+}
+
+void test_torn_record() {
+  Files files("gdrpc_test_play_history_torn");
+  {
+    Play_History history(files.log, files.index);
+    history.open();
+    play(history, 128, 1);
+    play(history, 129, 1);
+  }
+
+  {
+    std::ofstream log(files.log, std::ios::binary | std::ios::app);
+    log.write("torn", 4);
+  }
+  {
+    Play_History history(files.log, files.index);
+    history.open();
+    CHECK(std::filesystem::file_size(files.log) ==
+          HEADER_SIZE + 2 * RECORD_SIZE);
+    // the index no longer covers the log as it is, so it was rebuilt
+    CHECK(sessions(history, 128) == 1);
+    CHECK(sessions(history, 129) == 1);
+
+    // appends line up with the records again
+    play(history, 129, 1);
+  }
+
+  // a record that fails its checksum ends the log there
+  {
+    std::fstream log(files.log, std::ios::binary | std::ios::in |
+                                    std::ios::out);
+    log.seekp(HEADER_SIZE + RECORD_SIZE + 8);
+    log.put('\x01');
+  }
+  Play_History history(files.log, files.index);
+  history.open();
+  CHECK(std::filesystem::file_size(files.log) == HEADER_SIZE + RECORD_SIZE);
+  CHECK(sessions(history, 128) == 1);
+  CHECK(sessions(history, 129) == 0);
+}
+
+void test_foreign_log() {
+  Files files("gdrpc_test_play_history_foreign");
+  {
+    std::ofstream log(files.log, std::ios::binary);
+    log << "definitely not a play history";
+  }
+
+  Play_History history(files.log, files.index);
+  history.open();
+  CHECK(std::filesystem::file_size(files.log) == 0);
+  CHECK(sessions(history, 128) == 0);
+
+  play(history, 128, 1);
+  CHECK(sessions(history, 128) == 1);
+}
+
+// more levels than the smallest table holds at half full
+void test_growth() {
+  Files files("gdrpc_test_play_history_growth");
+  {
+    Play_History history(files.log, files.index);
+    history.open();
+    for (int levelID = 1; levelID <= 1500; levelID++) {
+      play(history, levelID, 1);
+    }
+    play(history, 700, 1);
+
+    bool all_found = true;
+    for (int levelID = 1; levelID <= 1500; levelID++) {
+      all_found &= sessions(history, levelID) == (levelID == 700 ? 2u : 1u);
+    }
+    CHECK(all_found);
+  }
+
+  Play_History history(files.log, files.index);
+  history.open();
+  bool all_found = true;
+  for (int levelID = 1; levelID <= 1500; levelID++) {
+    all_found &= sessions(history, levelID) == (levelID == 700 ? 2u : 1u);
+  }
+  CHECK(all_found);
+  CHECK(sessions(history, 1501) == 0);
+}
+
+void test_format() {
+  CHECK(format_play_time(0) == "0m");
+  CHECK(format_play_time(14 * 60 + 59) == "14m");
+  CHECK(format_play_time(2 * 3600 + 5 * 60) == "2h 05m");
+  CHECK(format_play_time(30 * 3600 + 45 * 60) == "30h 45m");
+}
+} // namespace
+
+int main() {
+  test_sessions();
+  test_torn_record();
+  test_foreign_log();
+  test_growth();
+  test_format();
+  return check_result();
+}
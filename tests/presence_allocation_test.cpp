@@ -0,0 +1,178 @@
+#include "check.hpp"
+#include "discord_ipc.hpp"
+#include "presence_frame.hpp"
+#include "presence_wrapper.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+
+#include <fmt/format.h>
+
+// counts every allocation in the process, so a presence update that
+// allocates once it's warmed up shows up as a failure
+
+namespace {
+std::atomic<size_t> allocations{0};
+}
+
+void *operator new(std::size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (auto memory = std::malloc(size ? size : 1)) {
+    return memory;
+  }
+  throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) { return operator new(size); }
+
+void operator delete(void *memory) noexcept { std::free(memory); }
+void operator delete[](void *memory) noexcept { std::free(memory); }
+void operator delete(void *memory, std::size_t) noexcept { std::free(memory); }
+void operator delete[](void *memory, std::size_t) noexcept {
+  std::free(memory);
+}
+
+namespace {
+// discord that answers the handshake with READY and takes every frame
+class Ready_Transport : public Ipc_Transport {
+private:
+  bool connected = false;
+  bool ready_sent = false;
+
+public:
+  std::string last_sent;
+  size_t frames_sent = 0;
+
+  bool connect() override {
+    connected = true;
+    ready_sent = false;
+    return true;
+  }
+  void disconnect() override { connected = false; }
+  bool is_connected() const override { return connected; }
+
+  bool send(Ipc_Opcode, const std::string &payload) override {
+    last_sent.assign(payload);
+    frames_sent++;
+    return true;
+  }
+  bool flush() override { return true; }
+
+  bool receive(Ipc_Opcode &opcode, std::string &payload) override {
+    if (ready_sent) {
+      return false;
+    }
+    ready_sent = true;
+    opcode = Ipc_Opcode::frame;
+    payload.assign(R"({"cmd":"DISPATCH","evt":"READY"})");
+    return true;
+  }
+};
+
+// what the config would hold, built once at startup
+struct Templates {
+  std::string details = "Playing {name} by {author}";
+  std::string state = "{percent}% (best {best}%)";
+  std::string small_text = "{stars} stars, {difficulty}";
+  std::string name = "Theory of Everything 2";
+  std::string author = "RobTopGames";
+  std::string difficulty = "Demon";
+  std::string large_text = "Geometry Dash: level select";
+};
+
+// the game loop's render, into whichever frame is at the back
+void render(PresenceFrame &frame, const Templates &templates, int percent) {
+  frame.details.format(templates.details, fmt::arg("name", templates.name),
+                       fmt::arg("author", templates.author));
+  frame.state.format(templates.state, fmt::arg("percent", percent),
+                     fmt::arg("best", 87));
+  frame.small_text.format(templates.small_text, fmt::arg("stars", 10),
+                          fmt::arg("difficulty", templates.difficulty));
+  frame.large_text.assign(templates.large_text);
+  frame.small_image.assign("demon-hard");
+  frame.timestamp = 1700000000;
+}
+
+// what an update did before frames, a fresh string per field
+void render_strings(std::array<std::string, 4> &fields,
+                    const Templates &templates, int percent) {
+  fields[0] = fmt::format(templates.details, fmt::arg("name", templates.name),
+                          fmt::arg("author", templates.author));
+  fields[1] = fmt::format(templates.state, fmt::arg("percent", percent),
+                          fmt::arg("best", 87));
+  fields[2] =
+      fmt::format(templates.small_text, fmt::arg("stars", 10),
+                  fmt::arg("difficulty", templates.difficulty));
+  fields[3] = templates.large_text;
+}
+
+void test_steady_state() {
+  auto transport = std::make_unique<Ready_Transport>();
+  auto &sent = *transport;
+
+  Discord_Presence discord(std::move(transport));
+  discord.initialize("123456789012345678");
+  discord.run_callbacks();
+  CHECK(discord.get_state() == Discord_State::ready);
+
+  Templates templates;
+  std::array<PresenceFrame, 2> frames;
+  size_t front_frame = 0;
+
+  // same as Game_Loop::update_presence_w, swap and send if it changed
+  auto update = [&](int percent) {
+    render(frames.at(1 - front_frame), templates, percent);
+    front_frame = 1 - front_frame;
+    auto &front = frames.at(front_frame);
+    if (front == frames.at(1 - front_frame)) {
+      return;
+    }
+    discord.update(front.details.c_str(), front.large_text.c_str(),
+                   front.small_text.c_str(), front.state.c_str(),
+                   front.small_image.c_str(), front.timestamp);
+    discord.run_callbacks();
+  };
+
+  // the first few grow the reused buffers to size
+  for (int percent = 0; percent < 10; percent++) {
+    update(percent);
+  }
+
+  constexpr int updates = 1000;
+  auto sent_before = sent.frames_sent;
+  allocations = 0;
+  for (int i = 0; i < updates; i++) {
+    update(i % 100);
+  }
+  auto counted = allocations.load();
+
+  CHECK(counted == 0);
+  // each update is a new percentage, so none of them were coalesced
+  CHECK(sent.frames_sent - sent_before == updates);
+  CHECK(sent.last_sent.find(R"("details":"Playing Theory of Everything 2 )"
+                            R"(by RobTopGames")") != std::string::npos);
+
+  // the same work the old way, for comparison
+  std::array<std::string, 4> fields;
+  allocations = 0;
+  for (int i = 0; i < updates; i++) {
+    render_strings(fields, templates, i % 100);
+  }
+  auto before = allocations.load();
+
+  std::printf("presence updates: %.2f allocations each with frames, "
+              "%.2f rendering into strings\n",
+              static_cast<double>(counted) / updates,
+              static_cast<double>(before) / updates);
+}
+} // namespace
+
+int main() {
+  test_steady_state();
+  return check_result();
+}
@@ -0,0 +1,158 @@
+#include "presence_feed.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// one writer publishing as fast as it can while 1 to 64 readers spin on
+// read_presence_feed, each through its own mapping like an overlay would
+// every snapshot is written so a torn copy can be told apart, any torn
+// read that got through the sequence check is counted
+// not run by ctest, run presence_feed_bench by hand
+
+namespace {
+typedef std::chrono::steady_clock steady;
+
+constexpr auto ROUND = std::chrono::milliseconds(500);
+
+// every field says the same number, a copy mixing two snapshots doesn't
+Presence_Snapshot numbered(int32_t n) {
+  Presence_Snapshot snapshot{};
+  snapshot.state = Feed_State::level;
+  snapshot.level_id = n;
+  snapshot.best = n % 101;
+  snapshot.attempts = n;
+  snapshot.stars = n % 11;
+  snapshot.rank = n;
+  snapshot.timestamp = n;
+
+  auto text = std::to_string(n);
+  copy_feed_text(snapshot.level_name, text.data(), text.size());
+  copy_feed_text(snapshot.author, text.data(), text.size());
+  copy_feed_text(snapshot.details, text.data(), text.size());
+  copy_feed_text(snapshot.state_text, text.data(), text.size());
+  copy_feed_text(snapshot.large_text, text.data(), text.size());
+  copy_feed_text(snapshot.small_text, text.data(), text.size());
+  copy_feed_text(snapshot.small_image, text.data(), text.size());
+  return snapshot;
+}
+
+bool consistent(const Presence_Snapshot &snapshot) {
+  auto n = snapshot.level_id;
+  auto text = std::to_string(n);
+  for (const char *field :
+       {snapshot.level_name, snapshot.author, snapshot.details,
+        snapshot.state_text, snapshot.large_text, snapshot.small_text,
+        snapshot.small_image}) {
+    if (text != field) {
+      return false;
+    }
+  }
+  return snapshot.best == n % 101 && snapshot.attempts == n &&
+         snapshot.stars == n % 11 && snapshot.rank == n &&
+         snapshot.timestamp == n;
+}
+
+const Presence_Feed_Segment *map_feed() {
+  int fd = shm_open(PRESENCE_FEED_NAME, O_RDONLY, 0);
+  if (fd == -1) {
+    return nullptr;
+  }
+  auto mapped = mmap(nullptr, sizeof(Presence_Feed_Segment), PROT_READ,
+                     MAP_SHARED, fd, 0);
+  close(fd);
+  return mapped == MAP_FAILED
+             ? nullptr
+             : static_cast<const Presence_Feed_Segment *>(mapped);
+}
+
+struct Reader_Counts {
+  uint64_t reads = 0;
+  // read_presence_feed gave up, the writer was busy every try
+  uint64_t busy = 0;
+  uint64_t torn = 0;
+};
+} // namespace
+
+int main() {
+  Presence_Feed feed;
+  try {
+    feed.open();
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+
+  std::printf("%u cpus, %lld ms per round\n",
+              std::thread::hardware_concurrency(),
+              static_cast<long long>(ROUND.count()));
+  std::printf("%7s %14s %14s %10s %6s %12s\n", "readers", "reads/s",
+              "per reader", "busy", "torn", "writes/s");
+
+  int32_t n = 1;
+  for (int readers : {1, 2, 4, 8, 16, 32, 64}) {
+    feed.publish(numbered(n++));
+
+    std::atomic<bool> running{true};
+    std::vector<Reader_Counts> counts(readers);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < readers; i++) {
+      threads.emplace_back([&running, &counts, i]() {
+        auto segment = map_feed();
+        if (segment == nullptr) {
+          std::perror("mapping the feed");
+          std::exit(1);
+        }
+
+        auto &count = counts[i];
+        Presence_Snapshot snapshot;
+        uint32_t sequence;
+        while (running.load(std::memory_order_relaxed)) {
+          if (!read_presence_feed(*segment, snapshot, sequence)) {
+            count.busy++;
+            continue;
+          }
+          count.reads++;
+          count.torn += !consistent(snapshot);
+        }
+        munmap(const_cast<Presence_Feed_Segment *>(segment),
+               sizeof(Presence_Feed_Segment));
+      });
+    }
+
+    uint64_t writes = 0;
+    auto started = steady::now();
+    while (steady::now() - started < ROUND) {
+      feed.publish(numbered(n++));
+      writes++;
+    }
+    running = false;
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    auto seconds =
+        std::chrono::duration<double>(steady::now() - started).count();
+
+    Reader_Counts total;
+    for (const auto &count : counts) {
+      total.reads += count.reads;
+      total.busy += count.busy;
+      total.torn += count.torn;
+    }
+    std::printf("%7d %14.0f %14.0f %10ju %6ju %12.0f\n", readers,
+                total.reads / seconds, total.reads / seconds / readers,
+                static_cast<uintmax_t>(total.busy),
+                static_cast<uintmax_t>(total.torn), writes / seconds);
+  }
+
+  feed.close();
+  return 0;
+}
@@ -0,0 +1,85 @@
+#include "check.hpp"
+#include "presence_frame.hpp"
+
+#include <string>
+
+namespace {
+void test_utf8_truncate() {
+  CHECK(utf8_truncate("short", 5, 10) == 5);
+  CHECK(utf8_truncate("exactly", 7, 7) == 7);
+  CHECK(utf8_truncate("abcdef", 6, 4) == 4);
+
+  // "a€b", the euro sign is bytes 1-3
+  const char *euro = "a\xE2\x82\xAC" "b";
+  CHECK(utf8_truncate(euro, 5, 4) == 4);
+  CHECK(utf8_truncate(euro, 5, 3) == 1);
+  CHECK(utf8_truncate(euro, 5, 2) == 1);
+  CHECK(utf8_truncate(euro, 5, 1) == 1);
+
+  // nothing but a sequence that doesn't fit
+  CHECK(utf8_truncate("\xF0\x9F\x8E\xAE", 4, 3) == 0);
+}
+
+void test_field() {
+  Presence_Field field;
+  CHECK(field.empty());
+  CHECK(std::string(field.c_str()).empty());
+
+  field.assign("Stereo Madness");
+  CHECK(field.size() == 14);
+  CHECK(std::string(field.c_str()) == "Stereo Madness");
+
+  // cut at the limit without splitting the last character
+  std::string long_text(PRESENCE_FIELD_SIZE - 1, 'x');
+  long_text += "\xC3\xA9";
+  field.assign(long_text);
+  CHECK(field.size() == PRESENCE_FIELD_SIZE - 1);
+  CHECK(field.c_str()[field.size()] == '\0');
+
+  Presence_Field same;
+  same.assign(long_text.substr(0, PRESENCE_FIELD_SIZE - 1));
+  CHECK(field == same);
+  same.assign("something else");
+  CHECK(field != same);
+}
+
+void test_format() {
+  Presence_Field field;
+  field.format("{} ({}%)", "Bloodbath", 42);
+  CHECK(std::string(field.c_str()) == "Bloodbath (42%)");
+
+  // formatting past the end truncates instead of throwing
+  field.format("{}", std::string(300, 'y'));
+  CHECK(field.size() == PRESENCE_FIELD_SIZE);
+
+  std::string accents;
+  for (int i = 0; i < 100; i++) {
+    accents += "\xC3\xA9";
+  }
+  field.format("{}", accents);
+  CHECK(field.size() == PRESENCE_FIELD_SIZE);
+  field.format("x{}", accents);
+  CHECK(field.size() == PRESENCE_FIELD_SIZE - 1);
+}
+
+void test_frame() {
+  PresenceFrame a, b;
+  CHECK(a == b);
+
+  a.details.assign("Playing Clubstep");
+  CHECK(a != b);
+  b.details.assign("Playing Clubstep");
+  CHECK(a == b);
+
+  b.timestamp = 1;
+  CHECK(a != b);
+}
+} // namespace
+
+int main() {
+  test_utf8_truncate();
+  test_field();
+  test_format();
+  test_frame();
+  return check_result();
+}
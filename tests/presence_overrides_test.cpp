@@ -0,0 +1,286 @@
+#include "check.hpp"
+#include "override_server.hpp"
+#include "presence_overrides.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Presence_Overrides on its own, then fed by the override server from
+// clients on its unix socket
+
+namespace {
+using namespace std::chrono_literals;
+typedef std::chrono::steady_clock steady;
+
+bool set(Presence_Overrides &overrides, Override_Field field,
+         uint8_t priority, std::chrono::milliseconds ttl, const char *text) {
+  return overrides.set(field, priority, ttl, text, std::strlen(text));
+}
+
+std::string shown_details(const Presence_Overrides &overrides) {
+  PresenceFrame frame;
+  frame.details.assign("rendered");
+  overrides.apply(frame);
+  return frame.details.c_str();
+}
+
+void test_priority() {
+  Presence_Overrides overrides;
+  CHECK(shown_details(overrides) == "rendered");
+
+  CHECK(set(overrides, Override_Field::details, 5, 0ms, "five"));
+  CHECK(shown_details(overrides) == "five");
+
+  // lower priority is kept but doesn't change what's shown
+  CHECK(!set(overrides, Override_Field::details, 1, 0ms, "one"));
+  CHECK(shown_details(overrides) == "five");
+
+  CHECK(set(overrides, Override_Field::details, 9, 0ms, "nine"));
+  CHECK(shown_details(overrides) == "nine");
+
+  // same text again is no change
+  CHECK(!set(overrides, Override_Field::details, 9, 0ms, "nine"));
+
+  // taking back the top one shows the next
+  CHECK(set(overrides, Override_Field::details, 9, 0ms, ""));
+  CHECK(shown_details(overrides) == "five");
+  CHECK(set(overrides, Override_Field::details, 5, 0ms, ""));
+  CHECK(shown_details(overrides) == "one");
+
+  // nothing there to take back
+  CHECK(!set(overrides, Override_Field::details, 7, 0ms, ""));
+
+  // other fields are left alone
+  PresenceFrame frame;
+  frame.state.assign("rendered state");
+  overrides.apply(frame);
+  CHECK(std::string(frame.state.c_str()) == "rendered state");
+}
+
+void test_expiry() {
+  Presence_Overrides overrides;
+  CHECK(overrides.until_next_expiry(steady::now()) == steady::duration::max());
+
+  set(overrides, Override_Field::details, 1, 0ms, "forever");
+  set(overrides, Override_Field::details, 2, 60000ms, "a minute");
+  CHECK(shown_details(overrides) == "a minute");
+
+  auto now = steady::now();
+  auto left = overrides.until_next_expiry(now);
+  CHECK(left > 59s && left <= 60s);
+
+  CHECK(!overrides.expire(now));
+  CHECK(overrides.expire(now + 61s));
+  CHECK(shown_details(overrides) == "forever");
+  CHECK(overrides.until_next_expiry(now) == steady::duration::max());
+
+  // setting it again at the same priority replaces the ttl too
+  set(overrides, Override_Field::details, 3, 1000ms, "soon");
+  set(overrides, Override_Field::details, 3, 0ms, "soon");
+  CHECK(!overrides.expire(now + 2s));
+  CHECK(shown_details(overrides) == "soon");
+}
+
+// connected to the override server like another mod would be
+class Override_Client {
+private:
+  int fd;
+
+public:
+  Override_Client() : fd(socket(AF_UNIX, SOCK_STREAM, 0)) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    auto path = override_server_path();
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    if (fd == -1 || connect(fd, reinterpret_cast<sockaddr *>(&address),
+                            sizeof(address)) == -1) {
+      throw std::runtime_error("could not connect to the override server");
+    }
+  }
+  ~Override_Client() { ::close(fd); }
+
+  void send_bytes(const std::string &bytes) {
+    size_t sent = 0;
+    while (sent < bytes.size()) {
+      auto written =
+          ::send(fd, bytes.data() + sent, bytes.size() - sent, MSG_NOSIGNAL);
+      if (written <= 0) {
+        throw std::runtime_error("the override server hung up");
+      }
+      sent += static_cast<size_t>(written);
+    }
+  }
+
+  // true once the server has closed its end
+  bool hung_up(std::chrono::milliseconds timeout) {
+    pollfd entry{fd, POLLIN, 0};
+    char byte;
+    return poll(&entry, 1, static_cast<int>(timeout.count())) == 1 &&
+           ::recv(fd, &byte, 1, 0) == 0;
+  }
+};
+
+std::string message(Override_Field field, uint8_t priority,
+                    const std::string &text, uint32_t ttl_ms = 0) {
+  Override_Header header{static_cast<uint8_t>(field), priority,
+                         static_cast<uint16_t>(text.size()), ttl_ms};
+  std::string bytes(reinterpret_cast<const char *>(&header), sizeof(header));
+  return bytes + text;
+}
+
+// the server applies messages on its own thread
+template <typename Condition> bool eventually(Condition &&condition) {
+  auto deadline = steady::now() + 2s;
+  while (!condition()) {
+    if (steady::now() > deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(1ms);
+  }
+  return true;
+}
+
+std::string shown(const Presence_Overrides &overrides, Override_Field field) {
+  PresenceFrame frame;
+  overrides.apply(frame);
+  Presence_Field *fields[] = {&frame.details, &frame.state, &frame.large_text,
+                              &frame.small_text, &frame.small_image};
+  return fields[static_cast<size_t>(field)]->c_str();
+}
+
+void test_server() {
+  Presence_Overrides overrides;
+  std::atomic<int> changes{0};
+  Override_Server server;
+  server.start(overrides, [&changes]() { changes++; });
+
+  {
+    Override_Client client;
+    client.send_bytes(message(Override_Field::details, 4, "practice"));
+    CHECK(eventually([&]() { return shown_details(overrides) == "practice"; }));
+    CHECK(changes == 1);
+
+    // a message split over several writes waits for the rest
+    auto split = message(Override_Field::state, 4, "run 2 of 10");
+    client.send_bytes(split.substr(0, 3));
+    std::this_thread::sleep_for(100ms);
+    client.send_bytes(split.substr(3, 7));
+    std::this_thread::sleep_for(100ms);
+    CHECK(shown(overrides, Override_Field::state).empty());
+    client.send_bytes(split.substr(10));
+    CHECK(eventually([&]() {
+      return shown(overrides, Override_Field::state) == "run 2 of 10";
+    }));
+    CHECK(changes == 2);
+
+    // sending what's already shown doesn't ask for an update
+    std::string same;
+    for (int i = 0; i < 1000; i++) {
+      same += message(Override_Field::details, 4, "practice");
+    }
+    same += message(Override_Field::small_image, 1, "marker");
+    client.send_bytes(same);
+    CHECK(eventually([&]() {
+      return shown(overrides, Override_Field::small_image) == "marker";
+    }));
+    CHECK(changes == 3);
+  }
+
+  // four mods at full rate, one field each, every message is applied in
+  // order so the last one is what stays
+  constexpr int MESSAGES = 20000;
+  const Override_Field fields[] = {Override_Field::details,
+                                   Override_Field::state,
+                                   Override_Field::large_text,
+                                   Override_Field::small_text};
+  std::vector<std::thread> senders;
+  for (auto field : fields) {
+    senders.emplace_back([field]() {
+      Override_Client client;
+      std::string burst;
+      for (int i = 0; i < MESSAGES; i++) {
+        burst += message(field, 9, std::to_string(i));
+        if (burst.size() > 64 * 1024) {
+          client.send_bytes(burst);
+          burst.clear();
+        }
+      }
+      client.send_bytes(burst + message(field, 9, "done"));
+      // the server takes what arrived before a hang up
+    });
+  }
+  for (auto &sender : senders) {
+    sender.join();
+  }
+  for (auto field : fields) {
+    CHECK(eventually([&]() { return shown(overrides, field) == "done"; }));
+  }
+  // bursts are applied together, far fewer updates than messages
+  CHECK(changes < 4 * MESSAGES);
+
+  // an unknown field or oversized text gets the client disconnected, what
+  // it sent before stays
+  {
+    Override_Client client;
+    client.send_bytes(message(Override_Field::small_image, 9, "kept"));
+    Override_Header bad{static_cast<uint8_t>(Override_Field::count), 1, 1, 0};
+    client.send_bytes(
+        std::string(reinterpret_cast<const char *>(&bad), sizeof(bad)) + "x");
+    CHECK(client.hung_up(2000ms));
+    CHECK(shown(overrides, Override_Field::small_image) == "kept");
+  }
+  {
+    Override_Client client;
+    Override_Header bad{static_cast<uint8_t>(Override_Field::details), 1,
+                        static_cast<uint16_t>(MAX_OVERRIDE_SIZE + 1), 0};
+    client.send_bytes(
+        std::string(reinterpret_cast<const char *>(&bad), sizeof(bad)));
+    CHECK(client.hung_up(2000ms));
+  }
+
+  // and the server still takes new clients
+  {
+    Override_Client client;
+    client.send_bytes(message(Override_Field::details, 200, "after"));
+    CHECK(eventually([&]() { return shown_details(overrides) == "after"; }));
+  }
+
+  // stopping removes the socket
+  server.stop();
+  CHECK(access(override_server_path().c_str(), F_OK) == -1);
+}
+} // namespace
+
+int main() {
+  test_priority();
+  test_expiry();
+
+  char directory[] = "/tmp/gdrpc-overrides-XXXXXX";
+  if (!mkdtemp(directory)) {
+    std::perror("mkdtemp");
+    return 1;
+  }
+  setenv("XDG_RUNTIME_DIR", directory, 1);
+
+  try {
+    test_server();
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    check_failures()++;
+  }
+
+  rmdir(directory);
+  return check_result();
+}
@@ -0,0 +1,296 @@
+#include "check.hpp"
+#include "discord_ipc.hpp"
+#include "presence_wrapper.hpp"
+
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Discord_Presence against a scripted discord, with the time passed in so
+// minutes of backoff take no time at all
+
+namespace {
+using namespace std::chrono_literals;
+typedef Discord_Presence::clock steady;
+
+const char *APPLICATION_ID = "123456789012345678";
+const std::string READY = R"({"cmd":"DISPATCH","evt":"READY"})";
+
+// discord as the test wants it: up or not, answering with whatever frames
+// were queued, recording everything sent to it
+class Script_Transport : public Ipc_Transport {
+private:
+  bool connected = false;
+
+public:
+  bool running = true;
+  int connects = 0;
+  std::deque<std::pair<Ipc_Opcode, std::string>> incoming;
+  std::vector<std::pair<Ipc_Opcode, std::string>> sent;
+
+  bool connect() override {
+    connects++;
+    connected = running;
+    return connected;
+  }
+  void disconnect() override {
+    connected = false;
+    incoming.clear();
+  }
+  bool is_connected() const override { return connected; }
+
+  bool send(Ipc_Opcode opcode, const std::string &payload) override {
+    if (!connected) {
+      return false;
+    }
+    sent.emplace_back(opcode, payload);
+    return true;
+  }
+  bool flush() override { return connected; }
+
+  bool receive(Ipc_Opcode &opcode, std::string &payload) override {
+    if (incoming.empty()) {
+      return false;
+    }
+    opcode = incoming.front().first;
+    payload = incoming.front().second;
+    incoming.pop_front();
+    return true;
+  }
+
+  // discord closing, the pipe is gone on the next read
+  void quit() {
+    running = false;
+    connected = false;
+  }
+
+  size_t count_sent(Ipc_Opcode opcode) const {
+    size_t count = 0;
+    for (const auto &frame : sent) {
+      count += frame.first == opcode;
+    }
+    return count;
+  }
+};
+
+struct Harness {
+  Script_Transport *discord;
+  Discord_Presence presence;
+
+  Harness() : Harness(std::make_unique<Script_Transport>()) {}
+
+private:
+  explicit Harness(std::unique_ptr<Script_Transport> transport)
+      : discord(transport.get()), presence(std::move(transport)) {}
+};
+
+void update(Discord_Presence &presence, const char *details) {
+  presence.update(details, "large", "small", "state", "none", 1700000000);
+}
+
+void test_transitions() {
+  auto start = steady::now();
+  Harness harness;
+  auto &discord = *harness.discord;
+  auto &presence = harness.presence;
+  CHECK(presence.get_state() == Discord_State::disconnected);
+
+  // nothing happens before initialize
+  presence.run_callbacks(start);
+  CHECK(discord.connects == 0);
+
+  // handshake sent, waiting on READY and polling for it
+  presence.initialize(APPLICATION_ID, start);
+  CHECK(presence.get_state() == Discord_State::connecting);
+  CHECK(discord.sent.size() == 1);
+  CHECK(discord.sent.at(0).first == Ipc_Opcode::handshake);
+  CHECK(discord.sent.at(0).second ==
+        std::string("{\"v\":1,\"client_id\":\"") + APPLICATION_ID + "\"}");
+  CHECK(presence.until_next_attempt(start) == 100ms);
+
+  presence.run_callbacks(start + 100ms);
+  CHECK(presence.get_state() == Discord_State::connecting);
+
+  discord.incoming.emplace_back(Ipc_Opcode::frame, READY);
+  presence.run_callbacks(start + 200ms);
+  CHECK(presence.get_state() == Discord_State::ready);
+  CHECK(presence.get_status() == 0);
+  CHECK(presence.until_next_attempt(start + 200ms) ==
+        steady::duration::max());
+
+  // pings are answered with the same payload
+  discord.incoming.emplace_back(Ipc_Opcode::ping, "{\"n\":1}");
+  presence.run_callbacks(start + 300ms);
+  CHECK(discord.sent.back().first == Ipc_Opcode::pong);
+  CHECK(discord.sent.back().second == "{\"n\":1}");
+
+  // once ready an ERROR is about one command, the connection stays
+  discord.incoming.emplace_back(
+      Ipc_Opcode::frame, R"({"cmd":"SET_ACTIVITY","evt":"ERROR",)"
+                         R"("data":{"code":4000}})");
+  presence.run_callbacks(start + 400ms);
+  CHECK(presence.get_state() == Discord_State::ready);
+  CHECK(presence.get_status() == 4000);
+
+  // discord closing the pipe
+  discord.quit();
+  presence.run_callbacks(start + 500ms);
+  CHECK(presence.get_state() == Discord_State::disconnected);
+  CHECK(presence.until_next_attempt(start + 500ms) == 1s);
+
+  // back up, reconnected after the backoff
+  discord.running = true;
+  presence.run_callbacks(start + 1499ms);
+  CHECK(presence.get_state() == Discord_State::disconnected);
+  presence.run_callbacks(start + 1500ms);
+  CHECK(presence.get_state() == Discord_State::connecting);
+
+  // a close frame while connecting, the app id was refused
+  discord.incoming.emplace_back(
+      Ipc_Opcode::close, R"({"code":4000,"message":"Invalid Client ID"})");
+  presence.run_callbacks(start + 1600ms);
+  CHECK(presence.get_state() == Discord_State::errored);
+  CHECK(presence.get_status() == 4000);
+  CHECK(!discord.is_connected());
+
+  // an ERROR while connecting ends the attempt too
+  presence.run_callbacks(start + 3600ms);
+  CHECK(presence.get_state() == Discord_State::connecting);
+  discord.incoming.emplace_back(
+      Ipc_Opcode::frame, R"({"evt":"ERROR","data":{"code":4006}})");
+  presence.run_callbacks(start + 3700ms);
+  CHECK(presence.get_state() == Discord_State::errored);
+  CHECK(presence.get_status() == 4006);
+
+  // something holding the pipe open without ever answering
+  auto connecting_at = start + 7700ms;
+  presence.run_callbacks(connecting_at);
+  CHECK(presence.get_state() == Discord_State::connecting);
+  presence.run_callbacks(connecting_at + 9900ms);
+  CHECK(presence.get_state() == Discord_State::connecting);
+  presence.run_callbacks(connecting_at + 10s);
+  CHECK(presence.get_state() == Discord_State::errored);
+
+  // shut down stays down
+  presence.shutdown();
+  auto connects = discord.connects;
+  presence.run_callbacks(connecting_at + 1h);
+  CHECK(presence.get_state() == Discord_State::disconnected);
+  CHECK(discord.connects == connects);
+}
+
+void test_backoff() {
+  auto start = steady::now();
+  Harness harness;
+  auto &discord = *harness.discord;
+  auto &presence = harness.presence;
+  discord.running = false;
+
+  // discord isn't running: 1s, 2s, 4s and so on up to a minute
+  presence.initialize(APPLICATION_ID, start);
+  CHECK(discord.connects == 1);
+  auto now = start;
+  for (auto delay : {1s, 2s, 4s, 8s, 16s, 32s, 60s, 60s, 60s}) {
+    CHECK(presence.until_next_attempt(now) == delay);
+    auto connects = discord.connects;
+    presence.run_callbacks(now + delay - 1ms);
+    CHECK(discord.connects == connects);
+    now += delay;
+    presence.run_callbacks(now);
+    CHECK(discord.connects == connects + 1);
+    CHECK(presence.get_state() == Discord_State::disconnected);
+  }
+
+  // READY starts it over from a second
+  discord.running = true;
+  now += 60s;
+  presence.run_callbacks(now);
+  discord.incoming.emplace_back(Ipc_Opcode::frame, READY);
+  presence.run_callbacks(now);
+  CHECK(presence.get_state() == Discord_State::ready);
+  discord.quit();
+  presence.run_callbacks(now);
+  CHECK(presence.until_next_attempt(now) == 1s);
+
+  // refused attempts back off the same way
+  discord.running = true;
+  now += 1s;
+  for (auto delay : {2s, 4s, 8s}) {
+    presence.run_callbacks(now);
+    CHECK(presence.get_state() == Discord_State::connecting);
+    discord.incoming.emplace_back(Ipc_Opcode::close, R"({"code":4000})");
+    presence.run_callbacks(now);
+    CHECK(presence.get_state() == Discord_State::errored);
+    CHECK(presence.until_next_attempt(now) == delay);
+    now += delay;
+  }
+
+  // and the limits can be changed
+  presence.set_backoff(100ms, 300ms);
+  presence.initialize(APPLICATION_ID, now);
+  discord.quit();
+  presence.run_callbacks(now);
+  for (auto delay : {100ms, 200ms, 300ms, 300ms}) {
+    CHECK(presence.until_next_attempt(now) == delay);
+    now += delay;
+    presence.run_callbacks(now);
+  }
+}
+
+void test_replay_on_ready() {
+  auto start = steady::now();
+  Harness harness;
+  auto &discord = *harness.discord;
+  auto &presence = harness.presence;
+
+  // updates before READY are kept, only the newest one is sent
+  presence.initialize(APPLICATION_ID, start);
+  update(presence, "first");
+  update(presence, "second");
+  CHECK(discord.count_sent(Ipc_Opcode::frame) == 0);
+
+  discord.incoming.emplace_back(Ipc_Opcode::frame, READY);
+  presence.run_callbacks(start);
+  CHECK(discord.count_sent(Ipc_Opcode::frame) == 1);
+  CHECK(discord.sent.back().second.find("\"details\":\"second\"") !=
+        std::string::npos);
+
+  // once ready, updates go straight out
+  update(presence, "third");
+  CHECK(discord.count_sent(Ipc_Opcode::frame) == 2);
+  auto latest = discord.sent.back().second;
+  CHECK(latest.find("\"details\":\"third\"") != std::string::npos);
+
+  // discord restarts and forgets the activity, it's sent again on READY
+  // without a new update
+  discord.quit();
+  presence.run_callbacks(start + 1s);
+  discord.running = true;
+  discord.sent.clear();
+  presence.run_callbacks(start + 2s);
+  CHECK(presence.get_state() == Discord_State::connecting);
+  CHECK(discord.count_sent(Ipc_Opcode::frame) == 0);
+  discord.incoming.emplace_back(Ipc_Opcode::frame, READY);
+  presence.run_callbacks(start + 2s);
+  CHECK(discord.count_sent(Ipc_Opcode::frame) == 1);
+  CHECK(discord.sent.back().second == latest);
+
+  // nothing to replay before the first update
+  Harness fresh;
+  fresh.presence.initialize(APPLICATION_ID, start);
+  fresh.discord->incoming.emplace_back(Ipc_Opcode::frame, READY);
+  fresh.presence.run_callbacks(start);
+  CHECK(fresh.presence.get_state() == Discord_State::ready);
+  CHECK(fresh.discord->count_sent(Ipc_Opcode::frame) == 0);
+}
+} // namespace
+
+int main() {
+  test_transitions();
+  test_backoff();
+  test_replay_on_ready();
+  return check_result();
+}
@@ -0,0 +1,108 @@
+#include "rank_history.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// a year of hourly rank samples: writing them, the first launch that
+// compacts them, later launches, and the lookups behind {rank_delta_week}
+// not run by ctest, run rank_history_bench by hand
+
+namespace {
+typedef std::chrono::steady_clock steady;
+
+constexpr int64_t HOUR = 60 * 60;
+constexpr std::time_t NOW = 1700000000;
+constexpr int64_t YEAR_OF_HOURS = 365 * 24;
+
+double ms_since(steady::time_point started) {
+  return std::chrono::duration<double, std::milli>(steady::now() - started)
+      .count();
+}
+
+template <typename F> double median_ms(int runs, F &&run) {
+  std::vector<double> times;
+  for (int i = 0; i < runs; i++) {
+    auto started = steady::now();
+    run();
+    times.push_back(ms_since(started));
+  }
+  std::sort(times.begin(), times.end());
+  return times.at(times.size() / 2);
+}
+} // namespace
+
+int main() {
+  auto directory =
+      std::filesystem::temp_directory_path() / "gdrpc_rank_history_bench";
+  std::filesystem::create_directories(directory);
+  auto full = (directory / "full.bin").string();
+  auto file = (directory / "gdrpc_rank_history.bin").string();
+  std::filesystem::remove(full);
+
+  // one append per launch normally, all of them at once here
+  auto started = steady::now();
+  {
+    Rank_History history(full);
+    history.open(NOW - YEAR_OF_HOURS * HOUR);
+    for (int64_t i = 0; i <= YEAR_OF_HOURS; i++) {
+      history.append({NOW - (YEAR_OF_HOURS - i) * HOUR, 71,
+                      static_cast<int32_t>(20000 - i), 0});
+    }
+  }
+  auto append_ms = ms_since(started);
+  auto full_size = std::filesystem::file_size(full);
+  std::printf("%lld samples, %ju bytes: %.2fus per append\n",
+              static_cast<long long>(YEAR_OF_HOURS + 1),
+              static_cast<uintmax_t>(full_size),
+              append_ms * 1000.0 / (YEAR_OF_HOURS + 1));
+
+  // the first launch after that year loads everything and compacts it
+  auto overwrite = std::filesystem::copy_options::overwrite_existing;
+  size_t kept = 0;
+  auto compacting = median_ms(11, [&]() {
+    std::filesystem::copy_file(full, file, overwrite);
+    Rank_History history(file);
+    history.open(NOW);
+    kept = history.size();
+  });
+  // the copy is part of that, timed on its own to take it back out
+  auto copying = median_ms(11, [&]() {
+    std::filesystem::copy_file(full, file, overwrite);
+  });
+  std::printf("open and compact:   %7.3fms, %zu samples kept\n",
+              compacting - copying, kept);
+
+  // then every launch after reads the compacted file
+  {
+    Rank_History history(file);
+    history.open(NOW);
+  }
+  auto compacted_size = std::filesystem::file_size(file);
+  auto opening = median_ms(51, [&]() {
+    Rank_History history(file);
+    history.open(NOW);
+  });
+  std::printf("open compacted:     %7.3fms, %ju bytes\n", opening,
+              static_cast<uintmax_t>(compacted_size));
+
+  Rank_History history(file);
+  history.open(NOW);
+  constexpr int LOOKUPS = 1000000;
+  int change = 0;
+  long long total = 0;
+  started = steady::now();
+  for (int i = 0; i < LOOKUPS; i++) {
+    history.rank_change(71, std::chrono::hours(24 * 7), NOW - i % 1000, change);
+    total += change;
+  }
+  std::printf("week delta lookup:  %7.1fns (%d places)\n",
+              ms_since(started) * 1e6 / LOOKUPS,
+              static_cast<int>(total / LOOKUPS));
+
+  std::filesystem::remove_all(directory);
+  return 0;
+}
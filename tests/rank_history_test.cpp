@@ -0,0 +1,179 @@
+#include "check.hpp"
+#include "rank_history.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace {
+// sizes of the header and records in the file
+constexpr uint64_t HEADER_SIZE = 16;
+constexpr uint64_t RECORD_SIZE = 32;
+
+constexpr int64_t DAY = 24 * 60 * 60;
+constexpr std::time_t NOW = 1700000000;
+
+std::string temporary_file(const char *name) {
+  auto path = (std::filesystem::temp_directory_path() / name).string();
+  std::filesystem::remove(path);
+  return path;
+}
+
+uint64_t file_size(const std::string &filename) {
+  return std::filesystem::file_size(filename);
+}
+
+void append_bytes(const std::string &filename, const std::string &bytes) {
+  std::ofstream file(filename, std::ios::binary | std::ios::app);
+  file.write(bytes.data(), bytes.size());
+}
+
+void test_append_and_reopen() {
+  auto filename = temporary_file("gdrpc_test_rank_history.bin");
+  {
+    Rank_History history(filename);
+    history.open(NOW);
+    CHECK(history.size() == 0);
+
+    CHECK(history.append({NOW - 10 * DAY, 71, 500, 1000}));
+    CHECK(history.append({NOW - 5 * DAY, 71, 450, 1200}));
+    CHECK(history.append({NOW - 1 * DAY, 71, 430, 1300}));
+    // someone else's on the same file
+    CHECK(history.append({NOW - 2 * DAY, 16, 90, 9000}));
+    CHECK(history.size() == 4);
+  }
+  CHECK(file_size(filename) == HEADER_SIZE + 4 * RECORD_SIZE);
+
+  Rank_History history(filename);
+  history.open(NOW);
+  CHECK(history.size() == 4);
+
+  // from the last sample at least a week old
+  int change = 0;
+  CHECK(history.rank_change(71, std::chrono::hours(24 * 7), NOW, change));
+  CHECK(change == 70);
+  // history doesn't go back a year, so from the first sample
+  CHECK(history.rank_change(71, std::chrono::hours(24 * 365), NOW, change));
+  CHECK(change == 70);
+  CHECK(history.rank_change(71, std::chrono::hours(24 * 3), NOW, change));
+  CHECK(change == 20);
+  CHECK(history.rank_change(16, std::chrono::hours(24), NOW, change));
+  CHECK(change == 0);
+  CHECK(!history.rank_change(3, std::chrono::hours(24), NOW, change));
+
+  std::filesystem::remove(filename);
+}
+
+void test_torn_record() {
+  auto filename = temporary_file("gdrpc_test_rank_history_torn.bin");
+  {
+    Rank_History history(filename);
+    history.open(NOW);
+    history.append({NOW - 2 * DAY, 71, 500, 1000});
+    history.append({NOW - 1 * DAY, 71, 480, 1100});
+  }
+
+  // half a record, as if the game died mid append
+  append_bytes(filename, std::string(RECORD_SIZE / 2, '\x7F'));
+  {
+    Rank_History history(filename);
+    history.open(NOW);
+    CHECK(history.size() == 2);
+    CHECK(file_size(filename) == HEADER_SIZE + 2 * RECORD_SIZE);
+
+    // the next append lines up with the records again
+    history.append({NOW, 71, 470, 1150});
+  }
+  {
+    Rank_History history(filename);
+    history.open(NOW);
+    CHECK(history.size() == 3);
+  }
+
+  // a whole record that fails its checksum, and everything after it
+  {
+    std::fstream file(filename, std::ios::binary | std::ios::in |
+                                    std::ios::out);
+    file.seekp(HEADER_SIZE + RECORD_SIZE + 8);
+    file.put('\x01');
+  }
+  Rank_History history(filename);
+  history.open(NOW);
+  CHECK(history.size() == 1);
+  CHECK(file_size(filename) == HEADER_SIZE + RECORD_SIZE);
+
+  std::filesystem::remove(filename);
+}
+
+void test_bad_header() {
+  auto filename = temporary_file("gdrpc_test_rank_history_header.bin");
+  append_bytes(filename, std::string(100, 'z'));
+  {
+    Rank_History history(filename);
+    history.open(NOW);
+    CHECK(history.size() == 0);
+    CHECK(file_size(filename) == 0);
+
+    history.append({NOW, 71, 500, 1000});
+  }
+
+  Rank_History history(filename);
+  history.open(NOW);
+  CHECK(history.size() == 1);
+
+  std::filesystem::remove(filename);
+}
+
+void test_compaction() {
+  auto filename = temporary_file("gdrpc_test_rank_history_compact.bin");
+  {
+    Rank_History history(filename);
+    history.open(NOW);
+
+    // 10 samples a day for 10 days, a month ago
+    for (int day = 0; day < 10; day++) {
+      auto start = (NOW / DAY - 40 + day) * DAY;
+      for (int i = 0; i < 10; i++) {
+        history.append({start + i * 3600, 71, 1000 - day * 10 - i, 0});
+      }
+    }
+    // older than anything that's kept
+    history.append({NOW - 500 * DAY, 71, 5000, 0});
+    // recent ones are all kept
+    for (int i = 0; i < 5; i++) {
+      history.append({NOW - DAY + i * 3600, 71, 800 - i, 0});
+    }
+    CHECK(history.size() == 106);
+  }
+
+  // 90 dropped is enough for open to compact
+  Rank_History history(filename);
+  history.open(NOW);
+  CHECK(history.size() == 15);
+  CHECK(file_size(filename) == HEADER_SIZE + 15 * RECORD_SIZE);
+
+  // the last sample of the oldest day is the baseline now
+  int change = 0;
+  CHECK(history.rank_change(71, std::chrono::hours(24 * 365), NOW, change));
+  CHECK(change == 991 - 796);
+
+  std::filesystem::remove(filename);
+}
+
+void test_format() {
+  CHECK(format_rank_change(false, 5).empty());
+  CHECK(format_rank_change(true, 15) == "\xE2\x96\xB2" "15");
+  CHECK(format_rank_change(true, -3) == "\xE2\x96\xBC" "3");
+  CHECK(format_rank_change(true, 0) == "\xC2\xB1" "0");
+}
+} // namespace
+
+int main() {
+  test_append_and_reopen();
+  test_torn_record();
+  test_bad_header();
+  test_compaction();
+  test_format();
+  return check_result();
+}
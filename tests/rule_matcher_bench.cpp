@@ -0,0 +1,95 @@
+#include "rule_matcher.hpp"
+
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+// matching time for growing rule lists, walked against compiled
+// LINEAR_RULE_LIMIT should sit about where the two cross
+// not run by ctest, run rule_matcher_bench by hand
+
+namespace {
+typedef Config::Config_Format::Rule Rule;
+typedef std::chrono::steady_clock steady;
+
+std::vector<Rule> make_rules(std::mt19937 &random, size_t count) {
+  std::vector<Rule> rules(count);
+  for (auto &rule : rules) {
+    rule.id_min = static_cast<int>(random() % 100000000);
+    rule.id_max = rule.id_min + static_cast<int>(random() % 50000000);
+    rule.stars_min = static_cast<int>(random() % 10);
+    rule.stars_max = rule.stars_min + static_cast<int>(random() % 6);
+    if (random() % 2) {
+      rule.difficulty = {"hard", "insane"};
+    }
+    if (random() % 4 == 0) {
+      rule.author = {"Creator" + std::to_string(random() % 50)};
+    }
+  }
+  return rules;
+}
+
+double build_ms(const std::vector<Rule> &rules, size_t limit) {
+  auto started = steady::now();
+  Rule_Matcher matcher;
+  matcher.compile(rules, limit);
+  return std::chrono::duration<double, std::milli>(steady::now() - started)
+      .count();
+}
+
+double match_ns(const Rule_Matcher &matcher, std::vector<GDlevel> &levels,
+                size_t rule_count) {
+  auto rounds = 500000 / (rule_count + 10) + 10;
+  volatile int sink = 0;
+
+  auto started = steady::now();
+  for (size_t r = 0; r < rounds; r++) {
+    for (auto &level : levels) {
+      sink = matcher.match(level, 3);
+    }
+  }
+  (void)sink;
+  return std::chrono::duration<double, std::nano>(steady::now() - started)
+             .count() /
+         static_cast<double>(rounds * levels.size());
+}
+} // namespace
+
+int main() {
+  std::printf("%6s %12s %12s %12s %12s\n", "rules", "walk build",
+              "walk match", "sets build", "sets match");
+
+  for (size_t count : {1, 8, 32, 64, 96, 128, 160, 192, 256, 1000, 10000}) {
+    std::mt19937 random(static_cast<unsigned>(count));
+    auto rules = make_rules(random, count);
+
+    // mostly levels no rule is for, the usual case
+    std::vector<GDlevel> levels(1000);
+    for (auto &level : levels) {
+      level.levelID = static_cast<int>(random() % 160000000);
+      level.stars = static_cast<int>(random() % 12);
+      level.difficulty = static_cast<Difficulty>(random() % 6);
+      level.author = "creator" + std::to_string(random() % 50);
+    }
+
+    Rule_Matcher walked, compiled;
+    walked.compile(rules, SIZE_MAX);
+    compiled.compile(rules, 0);
+
+    for (auto &level : levels) {
+      if (walked.match(level, 3) != compiled.match(level, 3)) {
+        std::fprintf(stderr, "the two disagree with %zu rules\n", count);
+        return 1;
+      }
+    }
+
+    std::printf("%6zu %10.3fms %10.0fns %10.3fms %10.0fns\n", count,
+                build_ms(rules, SIZE_MAX), match_ns(walked, levels, count),
+                build_ms(rules, 0), match_ns(compiled, levels, count));
+  }
+
+  return 0;
+}
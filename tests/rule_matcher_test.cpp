@@ -0,0 +1,160 @@
+#include "check.hpp"
+#include "rule_matcher.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+typedef Config::Config_Format::Rule Rule;
+
+std::string lower(std::string s) {
+  std::transform(s.begin(), s.end(), s.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return s;
+}
+
+bool listed(const std::vector<std::string> &names, const std::string &name) {
+  return names.empty() ||
+         std::find(names.begin(), names.end(), name) != names.end();
+}
+
+// the rules as the readme describes them, checked one by one
+int reference(const std::vector<Rule> &rules, GDlevel &level, int type) {
+  static const char *types[] = {"official", "editor", "saved"};
+  if (type < 1 || type > 3) {
+    return -1;
+  }
+
+  auto difficulty = getDifficultyName(level);
+  auto demon = difficulty.find("demon") != std::string::npos;
+  auto stars = std::clamp(level.stars, 0, 15);
+
+  for (size_t i = 0; i < rules.size(); i++) {
+    const auto &rule = rules.at(i);
+    if (level.levelID < rule.id_min || level.levelID > rule.id_max ||
+        stars < rule.stars_min || stars > rule.stars_max) {
+      continue;
+    }
+    if (!listed(rule.difficulty, difficulty) &&
+        !(demon && listed(rule.difficulty, "demon"))) {
+      continue;
+    }
+    if (!listed(rule.level_type, types[type - 1])) {
+      continue;
+    }
+
+    std::vector<std::string> authors;
+    for (const auto &author : rule.author) {
+      authors.push_back(lower(author));
+    }
+    if (!listed(authors, lower(level.author))) {
+      continue;
+    }
+
+    return static_cast<int>(i);
+  }
+  return -1;
+}
+
+std::vector<Rule> random_rules(std::mt19937 &random, size_t count) {
+  const char *difficulties[] = {"na",     "auto",          "easy",
+                                "normal", "hard",          "harder",
+                                "insane", "demon",         "easy_demon",
+                                "hard_demon", "extreme_demon"};
+  const char *types[] = {"official", "editor", "saved"};
+
+  std::vector<Rule> rules(count);
+  for (auto &rule : rules) {
+    if (random() % 3 != 0) {
+      rule.id_min = static_cast<int>(random() % 1000);
+      rule.id_max = random() % 8 == 0
+                        ? INT_MAX
+                        : rule.id_min + static_cast<int>(random() % 400) - 20;
+    }
+    if (random() % 2) {
+      rule.stars_min = static_cast<int>(random() % 12);
+      rule.stars_max = rule.stars_min + static_cast<int>(random() % 6);
+    }
+    for (auto n = random() % 3; n > 0; n--) {
+      rule.difficulty.push_back(difficulties[random() % 11]);
+    }
+    if (random() % 3 == 0) {
+      rule.level_type.push_back(types[random() % 3]);
+    }
+    if (random() % 4 == 0) {
+      rule.author.push_back((random() % 2 ? "Author" : "author") +
+                            std::to_string(random() % 8));
+    }
+  }
+  return rules;
+}
+
+GDlevel random_level(std::mt19937 &random) {
+  GDlevel level;
+  level.levelID = static_cast<int>(random() % 1100) - 10;
+  level.stars = static_cast<int>(random() % 18);
+  level.difficulty = static_cast<Difficulty>(random() % 7);
+  level.isAuto = random() % 10 == 0;
+  level.isDemon = random() % 4 == 0;
+  level.demonDifficulty = static_cast<Demon_Difficulty>(random() % 6);
+  level.author = (random() % 2 ? "AUTHOR" : "author") +
+                 std::to_string(random() % 10);
+  return level;
+}
+
+// the walk and the compiled sets against the reference, on both sides of
+// the limit where match switches between them
+void test_against_reference() {
+  std::mt19937 random(33);
+  for (size_t count : {size_t(0), size_t(1), size_t(10),
+                       Rule_Matcher::LINEAR_RULE_LIMIT,
+                       Rule_Matcher::LINEAR_RULE_LIMIT + 1, size_t(300)}) {
+    auto rules = random_rules(random, count);
+
+    Rule_Matcher chosen, walked, compiled;
+    chosen.compile(rules);
+    walked.compile(rules, SIZE_MAX);
+    compiled.compile(rules, 0);
+
+    int mismatches = 0;
+    int matched = 0;
+    for (int i = 0; i < 3000; i++) {
+      auto level = random_level(random);
+      auto type = static_cast<int>(random() % 5);
+      auto expected = reference(rules, level, type);
+      matched += expected != -1;
+      if (chosen.match(level, type) != expected ||
+          walked.match(level, type) != expected ||
+          compiled.match(level, type) != expected) {
+        mismatches++;
+      }
+    }
+    CHECK(mismatches == 0);
+    CHECK(count == 0 || matched > 0);
+  }
+}
+
+void test_bad_names() {
+  for (size_t limit : {size_t(0), SIZE_MAX}) {
+    std::vector<Rule> rules(1);
+    rules.at(0).difficulty = {"impossible"};
+    Rule_Matcher matcher;
+    CHECK_THROWS(matcher.compile(rules, limit), std::runtime_error);
+
+    rules.at(0).difficulty.clear();
+    rules.at(0).level_type = {"gauntlet"};
+    CHECK_THROWS(matcher.compile(rules, limit), std::runtime_error);
+  }
+}
+} // namespace
+
+int main() {
+  test_against_reference();
+  test_bad_names();
+  return check_result();
+}
@@ -0,0 +1,92 @@
+#include "signature_scanner.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// time to find a signature in a .text section the size of SilvrPS.exe's,
+// the simd search against the scalar one
+// not run by ctest, run signature_scanner_bench by hand
+
+namespace {
+typedef std::chrono::steady_clock steady;
+
+// .text of the supported build
+constexpr size_t TEXT_SIZE = 0x2D0000;
+
+// random bytes with a function prologue every 64 bytes or so, so the
+// filter on the first bytes lets through about as much as real code would
+std::vector<uint8_t> code_like(size_t size) {
+  std::mt19937 random(41);
+  std::vector<uint8_t> text(size);
+  for (auto &byte : text) {
+    byte = static_cast<uint8_t>(random());
+  }
+
+  const uint8_t prologue[] = {0x55, 0x8B, 0xEC, 0x6A, 0xFF};
+  for (size_t at = 0; at + 64 < size; at += 32 + random() % 64) {
+    std::memcpy(&text[at], prologue, sizeof(prologue));
+  }
+  return text;
+}
+
+template <typename Find>
+double median_ms(Find &&find, const std::vector<uint8_t> &text,
+                 const Signature &signature, size_t &found) {
+  std::vector<double> times;
+  for (int i = 0; i < 21; i++) {
+    auto started = steady::now();
+    found = find(text.data(), text.size(), signature);
+    times.push_back(
+        std::chrono::duration<double, std::milli>(steady::now() - started)
+            .count());
+  }
+  std::sort(times.begin(), times.end());
+  return times.at(times.size() / 2);
+}
+
+void measure(const char *name, const std::vector<uint8_t> &text,
+             const Signature &signature) {
+  size_t simd_found, scalar_found;
+  auto simd = median_ms(find_signature, text, signature, simd_found);
+  auto scalar = median_ms(find_signature_scalar, text, signature, scalar_found);
+
+  if (simd_found != scalar_found) {
+    std::printf("%-28s the two searches disagree\n", name);
+    return;
+  }
+
+  // how much was actually read, a match stops the search early
+  auto scanned = simd_found == NO_MATCH ? text.size() : simd_found;
+  std::printf("%-28s at %8s  simd %6.3fms %7.0f MB/s  scalar %6.3fms %7.0f "
+              "MB/s\n",
+              name,
+              simd_found == NO_MATCH ? "none"
+                                     : std::to_string(simd_found).c_str(),
+              simd, scanned / simd / 1e3, scalar, scanned / scalar / 1e3);
+}
+} // namespace
+
+int main() {
+  auto text = code_like(TEXT_SIZE);
+  std::printf(".text of %zu bytes\n", text.size());
+
+  // planted near the end, so nearly everything is scanned
+  Signature target("55 8B EC 6A FF 68 ?? ?? ?? ?? 64 A1 00 00 00 00 50");
+  const uint8_t match[] = {0x55, 0x8B, 0xEC, 0x6A, 0xFF, 0x68, 0x12, 0x34,
+                           0x56, 0x78, 0x64, 0xA1, 0x00, 0x00, 0x00, 0x00,
+                           0x50};
+  auto planted = text;
+  std::memcpy(&planted[planted.size() - 4096], match, sizeof(match));
+
+  measure("prologue, near the end", planted, target);
+  measure("prologue, missing", text, target);
+  measure("leading wildcards, missing", text,
+          Signature("?? ?? 8B 0D ?? ?? ?? ?? E8 ?? ?? ?? ?? 85 C0"));
+  measure("rare bytes, missing", text, Signature("F4 F4 F4 CC CC 90"));
+
+  return 0;
+}
@@ -0,0 +1,117 @@
+#include "check.hpp"
+#include "signature_scanner.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+void test_parse() {
+  Signature signature("55 8B EC ?? ?? 6A FF");
+  CHECK(signature.size() == 7);
+  CHECK(signature.get_first_fixed() == 0);
+  CHECK(signature.get_last_fixed() == 6);
+  CHECK(signature.byte_at(1) == 0x8B);
+
+  Signature wildcards_outside("?? 8b ?? ec ??");
+  CHECK(wildcards_outside.get_first_fixed() == 1);
+  CHECK(wildcards_outside.get_last_fixed() == 3);
+
+  CHECK_THROWS(Signature("55 8G"), std::runtime_error);
+  CHECK_THROWS(Signature("?? ??"), std::runtime_error);
+}
+
+// the simd searches have to agree with the scalar one everywhere, including
+// matches in the tail that doesn't fill a whole vector
+void test_matches_scalar() {
+  std::mt19937 random(33);
+  // few distinct bytes, so the filters let plenty of near misses through
+  std::vector<uint8_t> data(4099);
+  for (auto &byte : data) {
+    byte = static_cast<uint8_t>(random() % 4);
+  }
+
+  Signature signature("02 ?? 01 03 ?? ?? 00 02 03 01 ?? 02");
+  CHECK(find_signature(data.data(), data.size(), signature) ==
+        find_signature_scalar(data.data(), data.size(), signature));
+
+  const uint8_t planted[] = {0x02, 0xAA, 0x01, 0x03, 0xBB, 0xCC,
+                             0x00, 0x02, 0x03, 0x01, 0xDD, 0x02};
+  for (size_t offset : {size_t(0), size_t(15), size_t(16), size_t(31),
+                        size_t(1000), data.size() - sizeof(planted)}) {
+    auto copy = data;
+    std::memcpy(copy.data() + offset, planted, sizeof(planted));
+
+    auto expected = find_signature_scalar(copy.data(), copy.size(), signature);
+    CHECK(expected <= offset);
+    CHECK(find_signature(copy.data(), copy.size(), signature) == expected);
+
+    // every shorter buffer too, so each possible tail length is covered
+    for (size_t size = offset; size <= offset + sizeof(planted) + 40 &&
+                               size <= copy.size();
+         size++) {
+      CHECK(find_signature(copy.data(), size, signature) ==
+            find_signature_scalar(copy.data(), size, signature));
+    }
+  }
+}
+
+void test_no_match() {
+  std::vector<uint8_t> data(300, 0x90);
+  Signature signature("90 90 CC");
+  CHECK(find_signature(data.data(), data.size(), signature) == NO_MATCH);
+  CHECK(find_signature_scalar(data.data(), data.size(), signature) ==
+        NO_MATCH);
+
+  // shorter than the pattern
+  CHECK(find_signature(data.data(), 2, signature) == NO_MATCH);
+}
+
+void write_u16(uint8_t *at, uint16_t value) { std::memcpy(at, &value, 2); }
+void write_u32(uint8_t *at, uint32_t value) { std::memcpy(at, &value, 4); }
+
+void test_image_info() {
+  std::vector<uint8_t> image(1024);
+  image[0] = 'M';
+  image[1] = 'Z';
+  write_u32(&image[0x3C], 0x80);
+
+  auto pe = &image[0x80];
+  std::memcpy(pe, "PE\0\0", 4);
+  auto file_header = pe + 4;
+  write_u16(file_header + 2, 2);
+  write_u32(file_header + 4, 0x5F0A1B2C);
+  write_u16(file_header + 16, 224);
+
+  auto optional_header = file_header + 20;
+  write_u32(optional_header + 56, 0x4C0000);
+  write_u32(optional_header + 64, 0x12345);
+
+  auto sections = optional_header + 224;
+  std::memcpy(sections, ".rdata", 7);
+  std::memcpy(sections + 40, ".text", 6);
+  write_u32(sections + 40 + 8, 0x2D0000);
+  write_u32(sections + 40 + 12, 0x1000);
+
+  Image_Info info;
+  CHECK(read_image_info(image.data(), info));
+  CHECK(info.timestamp == 0x5F0A1B2C);
+  CHECK(info.image_size == 0x4C0000);
+  CHECK(info.checksum == 0x12345);
+  CHECK(info.text_rva == 0x1000);
+  CHECK(info.text_size == 0x2D0000);
+
+  image[0] = 'X';
+  CHECK(!read_image_info(image.data(), info));
+}
+} // namespace
+
+int main() {
+  test_parse();
+  test_matches_scalar();
+  test_no_match();
+  test_image_info();
+  return check_result();
+}
@@ -0,0 +1,85 @@
+#pragma once
+#ifndef STAND_IN_SERVER_HPP
+#define STAND_IN_SERVER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <httplib.h>
+
+// a local http server standing in for a gd server or mirror
+// every POST gets the same reply after a set delay, and is counted
+class Stand_In_Server {
+public:
+  // what to answer a request with, by default the reply set below
+  using Responder = std::function<std::string(const httplib::Request &)>;
+
+private:
+  httplib::Server server;
+  std::thread listen_thread;
+  int port;
+
+  // the delay is cut short on close, so a slow reply can't hold up a test
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool closing = false;
+
+  Responder responder;
+
+public:
+  std::atomic<int> delay_ms{0};
+  std::atomic<int> status{200};
+  std::atomic<int> requests{0};
+  std::string reply;
+
+  explicit Stand_In_Server(std::string n_reply, Responder n_responder = nullptr)
+      : responder(std::move(n_responder)), reply(std::move(n_reply)) {
+    server.Post(".*", [this](const httplib::Request &req,
+                             httplib::Response &res) {
+      requests++;
+
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait_for(lock, std::chrono::milliseconds(delay_ms.load()),
+                    [this]() { return closing; });
+      }
+
+      res.status = status;
+      res.set_content(responder ? responder(req) : reply, "text/plain");
+    });
+
+    port = server.bind_to_any_port("127.0.0.1");
+    if (port <= 0) {
+      throw std::runtime_error("stand in server can't bind");
+    }
+    listen_thread = std::thread([this]() { server.listen_after_bind(); });
+
+    while (!server.is_running()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+
+  ~Stand_In_Server() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      closing = true;
+    }
+    cv.notify_all();
+    server.stop();
+    listen_thread.join();
+  }
+
+  Stand_In_Server(const Stand_In_Server &) = delete;
+  Stand_In_Server &operator=(const Stand_In_Server &) = delete;
+
+  int get_port() const { return port; }
+  std::string host() const { return "http://127.0.0.1:" + std::to_string(port); }
+};
+
+#endif
@@ -0,0 +1,93 @@
+#include "text_encoding.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// what normalize_text costs on a name at the sizes gd has, for ascii (almost
+// every name), utf-8 and windows-1252, with the ascii check against the
+// byte at a time loop it replaced
+// not run by ctest, run text_encoding_bench by hand
+
+namespace {
+typedef std::chrono::steady_clock steady;
+
+constexpr int CALLS = 200000;
+
+bool ascii_bytes(const char *text, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    if (static_cast<unsigned char>(text[i]) >= 0x80) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// median over a few runs of CALLS calls, in ns per call
+template <typename Call> double median_ns(Call &&call) {
+  std::vector<double> times;
+  for (int run = 0; run < 11; run++) {
+    auto started = steady::now();
+    for (int i = 0; i < CALLS; i++) {
+      call();
+    }
+    times.push_back(
+        std::chrono::duration<double, std::nano>(steady::now() - started)
+            .count() /
+        CALLS);
+  }
+  std::sort(times.begin(), times.end());
+  return times.at(times.size() / 2);
+}
+
+// size bytes of text, with the special byte(s) every 10 bytes
+std::string name(size_t size, const char *every_tenth) {
+  std::string text;
+  while (text.size() < size) {
+    text += text.size() % 10 == 0 && every_tenth ? every_tenth : "a";
+  }
+  text.resize(size);
+  return text;
+}
+} // namespace
+
+int main() {
+  std::printf("%6s %10s %10s %14s %10s %14s\n", "bytes", "is_ascii",
+              "byte loop", "ascii name", "utf-8 name", "1252 transcode");
+
+  // a volatile store each call so none of it is optimized out
+  volatile bool sink;
+  for (size_t size : {16, 64, 128, 1024}) {
+    auto ascii = name(size, nullptr);
+    auto utf8 = name(size, "\xC3\xA9");
+    // cut at the last complete sequence
+    while (!is_valid_utf8(utf8.data(), utf8.size())) {
+      utf8.pop_back();
+    }
+    auto latin1 = name(size, "\xE9");
+
+    auto simd = median_ns([&]() { sink = is_ascii(ascii.data(), size); });
+    auto bytes = median_ns([&]() { sink = ascii_bytes(ascii.data(), size); });
+
+    // nothing to change, the name is left where it is
+    auto ascii_name = median_ns([&]() { sink = normalize_text(ascii); });
+    auto utf8_name = median_ns([&]() { sink = normalize_text(utf8); });
+
+    // transcoding replaces the name, a fresh copy each call
+    std::string text;
+    auto copying = median_ns([&]() {
+      text = latin1;
+      sink = text.size() == size;
+    });
+    auto transcoding = median_ns([&]() {
+      text = latin1;
+      sink = normalize_text(text);
+    });
+
+    std::printf("%6zu %8.1fns %8.1fns %12.1fns %8.1fns %12.1fns\n", size,
+                simd, bytes, ascii_name, utf8_name, transcoding - copying);
+  }
+  return 0;
+}
@@ -0,0 +1,96 @@
+#include "check.hpp"
+#include "text_encoding.hpp"
+
+#include <string>
+
+namespace {
+void test_ascii() {
+  std::string text = "Bloodbath by Riot";
+  CHECK(is_ascii(text.data(), text.size()));
+  CHECK(!normalize_text(text));
+  CHECK(text == "Bloodbath by Riot");
+
+  // long enough for the simd loop, with the high byte past the first block
+  std::string long_text(100, 'a');
+  CHECK(is_ascii(long_text.data(), long_text.size()));
+  long_text[70] = '\xE9';
+  CHECK(!is_ascii(long_text.data(), long_text.size()));
+
+  // the high byte at every position, in and around each 16 byte block
+  for (size_t at = 0; at < 100; at++) {
+    std::string text(100, 'a');
+    text[at] = '\x80';
+    CHECK(!is_ascii(text.data(), text.size()));
+    CHECK(!is_ascii(text.data(), at + 1));
+    CHECK(is_ascii(text.data(), at));
+  }
+}
+
+void test_valid_utf8() {
+  CHECK(is_valid_utf8("", 0));
+  CHECK(is_valid_utf8("\xC3\xA9", 2));
+  CHECK(is_valid_utf8("\xE2\x82\xAC", 3));
+  CHECK(is_valid_utf8("\xF0\x9F\x8E\xAE", 4));
+  CHECK(is_valid_utf8("\xF4\x8F\xBF\xBF", 4));
+
+  std::string text = "Cr\xC3\xA8me Br\xC3\xBBl\xC3\xA9";
+  CHECK(!normalize_text(text));
+  CHECK(text == "Cr\xC3\xA8me Br\xC3\xBBl\xC3\xA9");
+}
+
+void test_invalid_utf8() {
+  // overlong '/'
+  CHECK(!is_valid_utf8("\xC0\xAF", 2));
+  // overlong U+20AC
+  CHECK(!is_valid_utf8("\xF0\x82\x82\xAC", 4));
+  // surrogate
+  CHECK(!is_valid_utf8("\xED\xA0\x80", 3));
+  // past U+10FFFF
+  CHECK(!is_valid_utf8("\xF4\x90\x80\x80", 4));
+  // cut short
+  CHECK(!is_valid_utf8("\xE2\x82", 2));
+  // stray continuation byte
+  CHECK(!is_valid_utf8("\x80", 1));
+
+  // a long ascii run skipped in blocks still stops at whatever follows it,
+  // wherever that is
+  for (size_t at = 0; at < 60; at++) {
+    auto text = std::string(at, 'a') + "\xC3\xA9" + std::string(40, 'b');
+    CHECK(is_valid_utf8(text.data(), text.size()));
+    text[at + 1] = 'x';
+    CHECK(!is_valid_utf8(text.data(), text.size()));
+    // a sequence cut off by the end of the text
+    CHECK(!is_valid_utf8(text.data(), at + 1));
+  }
+}
+
+void test_windows_1252() {
+  std::string text = "Caf\xE9";
+  CHECK(normalize_text(text));
+  CHECK(text == "Caf\xC3\xA9");
+
+  // the 0x80-0x9F symbols, each 3 bytes in utf-8
+  text = "\x80\x99\x93";
+  CHECK(normalize_text(text));
+  CHECK(text == "\xE2\x82\xAC\xE2\x84\xA2\xE2\x80\x9C");
+  CHECK(is_valid_utf8(text.data(), text.size()));
+
+  // a hole in windows-1252 keeps its latin-1 control code
+  text = "\x81";
+  CHECK(normalize_text(text));
+  CHECK(text == "\xC2\x81");
+
+  // an ascii prefix long enough to be skipped in blocks is kept as is
+  text = std::string(40, 'x') + "\xFC";
+  CHECK(normalize_text(text));
+  CHECK(text == std::string(40, 'x') + "\xC3\xBC");
+}
+} // namespace
+
+int main() {
+  test_ascii();
+  test_valid_utf8();
+  test_invalid_utf8();
+  test_windows_1252();
+  return check_result();
+}
@@ -0,0 +1,157 @@
+#include "check.hpp"
+#include "worker_thread.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+// how long stopping takes, for workers that listen and workers that don't
+
+namespace {
+typedef std::chrono::steady_clock steady;
+using std::chrono::milliseconds;
+
+double ms_since(steady::time_point started) {
+  return std::chrono::duration<double, std::milli>(steady::now() - started)
+      .count();
+}
+
+// a body that ignores stop requests, like a request stuck in a read
+// done is shared so the thread can still finish once the test moved on
+std::function<void(Stop_Token)> stuck(milliseconds duration,
+                                      std::shared_ptr<std::atomic<bool>> done) {
+  return [duration, done](Stop_Token) {
+    std::this_thread::sleep_for(duration);
+    *done = true;
+  };
+}
+
+void wait_for(const std::shared_ptr<std::atomic<bool>> &done) {
+  while (!*done) {
+    std::this_thread::sleep_for(milliseconds(5));
+  }
+}
+
+void test_sleep_is_cut_short() {
+  std::atomic<int> wakeups{0};
+  Worker_Thread worker;
+  worker.start([&wakeups](Stop_Token token) {
+    while (token.sleep_for(std::chrono::seconds(10))) {
+      wakeups++;
+    }
+  });
+  CHECK(worker.running());
+
+  // woken, it goes around the loop once
+  worker.wake();
+  auto started = steady::now();
+  while (wakeups == 0 && ms_since(started) < 1000) {
+    std::this_thread::sleep_for(milliseconds(1));
+  }
+  CHECK(wakeups == 1);
+  CHECK(!worker.finished());
+
+  // asked to stop, the ten second sleep ends right away
+  started = steady::now();
+  worker.request_stop();
+  CHECK(worker.join_for(milliseconds(1000)));
+  CHECK(ms_since(started) < 100);
+  CHECK(!worker.running());
+  CHECK(worker.finished());
+
+  // a second join has nothing to wait on
+  CHECK(worker.join_for(milliseconds(0)));
+}
+
+void test_join_gives_up() {
+  auto done = std::make_shared<std::atomic<bool>>(false);
+  Worker_Thread worker;
+  worker.start(stuck(milliseconds(500), done));
+
+  // returns at the timeout instead of when the body does, and lets go of
+  // the thread
+  auto started = steady::now();
+  worker.request_stop();
+  CHECK(!worker.join_for(milliseconds(50)));
+  auto waited = ms_since(started);
+  CHECK(waited >= 45 && waited < 200);
+  CHECK(!worker.running());
+  CHECK(!*done);
+
+  wait_for(done);
+}
+
+void test_destructor_doesnt_wait() {
+  auto done = std::make_shared<std::atomic<bool>>(false);
+  auto started = steady::now();
+  {
+    Worker_Thread worker;
+    worker.start(stuck(milliseconds(300), done));
+  }
+  CHECK(ms_since(started) < 100);
+
+  wait_for(done);
+}
+
+void test_group_shares_the_deadline() {
+  Worker_Group group;
+  std::shared_ptr<std::atomic<bool>> others[3];
+  for (auto &other : others) {
+    other = std::make_shared<std::atomic<bool>>(false);
+    group.start(stuck(milliseconds(400), other));
+  }
+  group.start(
+      [](Stop_Token token) { token.sleep_for(std::chrono::seconds(10)); });
+
+  // three stuck workers cost the timeout once, not three times
+  auto started = steady::now();
+  CHECK(!group.stop_all(milliseconds(100)));
+  auto waited = ms_since(started);
+  CHECK(waited >= 95 && waited < 250);
+
+  CHECK_THROWS(group.start([](Stop_Token) {}), std::runtime_error);
+
+  for (auto &other : others) {
+    wait_for(other);
+  }
+}
+
+void test_group_stops_listening_workers() {
+  Worker_Group group;
+  for (int i = 0; i < 8; i++) {
+    group.start([](Stop_Token token) {
+      while (token.sleep_for(milliseconds(1000))) {
+      }
+    });
+  }
+
+  auto started = steady::now();
+  CHECK(group.stop_all(milliseconds(1000)));
+  CHECK(ms_since(started) < 100);
+}
+
+void test_finished_workers_are_dropped() {
+  // the group joins finished workers as it goes, starting many short ones
+  // must not pile up threads
+  Worker_Group group;
+  std::atomic<int> ran{0};
+  for (int i = 0; i < 200; i++) {
+    group.start([&ran](Stop_Token) { ran++; });
+  }
+  CHECK(group.stop_all(milliseconds(1000)));
+  CHECK(ran == 200);
+}
+} // namespace
+
+int main() {
+  test_sleep_is_cut_short();
+  test_join_gives_up();
+  test_destructor_doesnt_wait();
+  test_group_shares_the_deadline();
+  test_group_stops_listening_workers();
+  test_finished_workers_are_dropped();
+  return check_result();
+}